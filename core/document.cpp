@@ -23,6 +23,7 @@
 
 // qt/kde/system includes
 #include <QtCore/QtAlgorithms>
+#include <QtCore/QBitArray>
 #include <QtCore/QDir>
 #include <QtCore/QFile>
 #include <QtCore/QFileInfo>
@@ -119,6 +120,12 @@ struct RunningSearch
     QString cachedString;
     Document::SearchType cachedType;
     Qt::CaseSensitivity cachedCaseSensitivity;
+    SearchOptions cachedOptions;
+    // matches found so far by a whole document search
+    int matchCount;
+    // the pages which may contain the text according to the generator,
+    // null if all of them have to be searched
+    QBitArray candidatePages;
     bool cachedViewportMove : 1;
     bool cachedNoDialogs : 1;
     bool isCurrentlySearching : 1;
@@ -282,10 +289,14 @@ qulonglong DocumentPrivate::calculateMemoryToFree()
     // [MEM] choose memory parameters based on configuration profile
     qulonglong clipValue = 0;
     qulonglong memoryToFree = 0;
+    // the caches of the generator count as much as our pixmaps
+    const qulonglong allocatedMemory = m_allocatedPixmapsTotalMemory + generatorCacheMemory();
 
     switch ( SettingsCore::memoryLevel() )
     {
         case SettingsCore::EnumMemoryLevel::Low:
+            // no pixmap is kept; the caches of the generator are only asked
+            // for what the pixmaps in use cannot give back
             memoryToFree = m_allocatedPixmapsTotalMemory;
             break;
 
@@ -293,15 +304,15 @@ qulonglong DocumentPrivate::calculateMemoryToFree()
         {
             qulonglong thirdTotalMemory = getTotalMemory() / 3;
             qulonglong freeMemory = getFreeMemory();
-            if (m_allocatedPixmapsTotalMemory > thirdTotalMemory) memoryToFree = m_allocatedPixmapsTotalMemory - thirdTotalMemory;
-            if (m_allocatedPixmapsTotalMemory > freeMemory) clipValue = (m_allocatedPixmapsTotalMemory - freeMemory) / 2;
+            if (allocatedMemory > thirdTotalMemory) memoryToFree = allocatedMemory - thirdTotalMemory;
+            if (allocatedMemory > freeMemory) clipValue = (allocatedMemory - freeMemory) / 2;
         }
         break;
 
         case SettingsCore::EnumMemoryLevel::Aggressive:
         {
             qulonglong freeMemory = getFreeMemory();
-            if (m_allocatedPixmapsTotalMemory > freeMemory) clipValue = (m_allocatedPixmapsTotalMemory - freeMemory) / 2;
+            if (allocatedMemory > freeMemory) clipValue = (allocatedMemory - freeMemory) / 2;
         }
         break;
         case SettingsCore::EnumMemoryLevel::Greedy:
@@ -309,7 +320,7 @@ qulonglong DocumentPrivate::calculateMemoryToFree()
             qulonglong freeSwap;
             qulonglong freeMemory = getFreeMemory( &freeSwap );
             const qulonglong memoryLimit = qMin( qMax( freeMemory, getTotalMemory()/2 ), freeMemory+freeSwap );
-            if (m_allocatedPixmapsTotalMemory > memoryLimit) clipValue = (m_allocatedPixmapsTotalMemory - memoryLimit) / 2;
+            if (allocatedMemory > memoryLimit) clipValue = (allocatedMemory - memoryLimit) / 2;
         }
         break;
     }
@@ -320,6 +331,58 @@ qulonglong DocumentPrivate::calculateMemoryToFree()
     return memoryToFree;
 }
 
+qulonglong DocumentPrivate::generatorCacheMemory() const
+{
+    qulonglong memory = 0;
+    if ( m_generator )
+    {
+        QMetaObject::invokeMethod( m_generator, "cacheMemory", Qt::DirectConnection, Q_RETURN_ARG(qulonglong, memory) );
+    }
+    return memory;
+}
+
+qulonglong DocumentPrivate::freeGeneratorCacheMemory( qulonglong memoryToFree )
+{
+    const qulonglong cacheMemory = generatorCacheMemory();
+    if ( memoryToFree == 0 || cacheMemory == 0 )
+        return memoryToFree;
+
+    // the part of memoryToFree held by the caches is theirs to free: if the
+    // generator cannot free it right now it stays accounted to the caches
+    // and is asked again at the next check, rather than evicting our pixmaps
+    const qulonglong asked = qMin( memoryToFree, cacheMemory );
+    qulonglong freed = 0;
+    QMetaObject::invokeMethod( m_generator, "freeCacheMemory", Qt::DirectConnection, Q_RETURN_ARG(qulonglong, freed), Q_ARG(qulonglong, asked) );
+    return memoryToFree - asked;
+}
+
+QBitArray DocumentPrivate::searchCandidatePages( const QString &text, SearchOptions options ) const
+{
+    QBitArray pages;
+    if ( m_generator )
+    {
+        QMetaObject::invokeMethod( m_generator, "searchCandidatePages", Qt::DirectConnection, Q_RETURN_ARG(QBitArray, pages), Q_ARG(QString, text), Q_ARG(Okular::SearchOptions, options) );
+    }
+    // be safe against generators counting the pages differently
+    if ( pages.size() != m_pagesVector.count() )
+        return QBitArray();
+    return pages;
+}
+
+void DocumentPrivate::prepareGeneratorPages( int pageNumber )
+{
+    if ( !m_generator || pageNumber < 0 )
+        return;
+
+    // the current page, and the next one which is shown right after it
+    // when reading or presenting the document
+    const int lastPage = qMin( pageNumber + 1, m_pagesVector.count() - 1 );
+    for ( int i = pageNumber; i <= lastPage; ++i )
+    {
+        QMetaObject::invokeMethod( m_generator, "preparePage", Qt::DirectConnection, Q_ARG(int, i) );
+    }
+}
+
 void DocumentPrivate::cleanupPixmapMemory()
 {
     cleanupPixmapMemory( calculateMemoryToFree() );
@@ -327,6 +390,12 @@ void DocumentPrivate::cleanupPixmapMemory()
 
 void DocumentPrivate::cleanupPixmapMemory( qulonglong memoryToFree )
 {
+    // the caches of the generator can be rebuilt, so they go before our
+    // pixmaps; on the Low profile the pixmaps go first, as none is kept anyway
+    const bool lowMemory = SettingsCore::memoryLevel() == SettingsCore::EnumMemoryLevel::Low;
+    if ( !lowMemory )
+        memoryToFree = freeGeneratorCacheMemory( memoryToFree );
+
     if ( memoryToFree > 0 )
     {
         const int currentViewportPage = (*m_viewportIterator).pageNumber;
@@ -400,6 +469,10 @@ void DocumentPrivate::cleanupPixmapMemory( qulonglong memoryToFree )
         m_allocatedPixmaps += pixmapsToKeep;
         //p--rintf("freeMemory A:[%d -%d = %d] \n", m_allocatedPixmaps.count() + pagesFreed, pagesFreed, m_allocatedPixmaps.count() );
     }
+
+    // only what the pixmaps could not give back is asked to the generator
+    if ( lowMemory )
+        freeGeneratorCacheMemory( memoryToFree );
 }
 
 /* Returns the next pixmap to evict from cache, or NULL if no suitable pixmap
@@ -912,6 +985,8 @@ bool DocumentPrivate::openDocumentInternal( const KService::Ptr& offer, bool iss
     QObject::connect( m_generator, SIGNAL(error(QString,int)), m_parent, SIGNAL(error(QString,int)) );
     QObject::connect( m_generator, SIGNAL(warning(QString,int)), m_parent, SIGNAL(warning(QString,int)) );
     QObject::connect( m_generator, SIGNAL(notice(QString,int)), m_parent, SIGNAL(notice(QString,int)) );
+    // rerender the pages whose contents the generator completed later
+    QObject::connect( m_generator, SIGNAL(pageContentsChanged(int)), m_parent, SLOT(refreshPixmaps(int)) );
 
     QApplication::setOverrideCursor( Qt::WaitCursor );
     bool openOk = false;
@@ -1122,7 +1197,7 @@ void DocumentPrivate::slotTimedMemoryCheck()
 {
     // [MEM] clean memory (for 'free mem dependant' profiles only)
     if ( SettingsCore::memoryLevel() != SettingsCore::EnumMemoryLevel::Low &&
-         m_allocatedPixmapsTotalMemory > 1024*1024 )
+         m_allocatedPixmapsTotalMemory + generatorCacheMemory() > 1024*1024 )
         cleanupPixmapMemory();
 }
 
@@ -1302,6 +1377,13 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
         m_executingPixmapRequests.push_back( request );
         m_pixmapRequestsMutex.unlock();
         m_generator->generatePixmap( request );
+
+        // generators rendering several pages at a time may take another one
+        m_pixmapRequestsMutex.lock();
+        const bool hasPixmaps = !m_pixmapRequestsStack.isEmpty();
+        m_pixmapRequestsMutex.unlock();
+        if ( hasPixmaps && m_generator && m_generator->canGeneratePixmap() )
+            QTimer::singleShot( 0, m_parent, SLOT(sendGeneratorPixmapRequest()) );
     }
     else
     {
@@ -1333,6 +1415,17 @@ void DocumentPrivate::fontReadingProgress( int page )
     }
 }
 
+void DocumentPrivate::textExportFinished()
+{
+    TextExportThread *thread = m_textExportThread;
+    m_textExportThread = 0;
+    if ( !thread )
+        return;
+
+    emit m_parent->textExportEnded( thread->succeeded() );
+    thread->deleteLater();
+}
+
 void DocumentPrivate::fontReadingGotFont( const Okular::FontInfo& font )
 {
     // TODO try to avoid duplicate fonts
@@ -1494,12 +1587,16 @@ void DocumentPrivate::doContinueDirectionMatchSearch(void *doContinueDirectionMa
     {
         // get page
         Page * page = m_pagesVector[ searchStruct->currentPage ];
-        // request search page if needed
-        if ( !page->hasTextPage() )
-            m_parent->requestTextPage( page->number() );
+        // skip the pages which cannot contain the text, without extracting it
+        if ( search->candidatePages.isNull() || search->candidatePages.testBit( page->number() ) )
+        {
+            // request search page if needed
+            if ( !page->hasTextPage() )
+                m_parent->requestTextPage( page->number() );
 
-        // if found a match on the current page, end the loop
-        searchStruct->match = page->findText( searchStruct->searchID, searchStruct->text, searchStruct->forward ? FromTop : FromBottom, searchStruct->caseSensitivity );
+            // if found a match on the current page, end the loop
+            searchStruct->match = page->findText( searchStruct->searchID, searchStruct->text, searchStruct->forward ? FromTop : FromBottom, searchStruct->caseSensitivity, 0, searchStruct->options );
+        }
 
         if ( !searchStruct->match )
         {
@@ -1572,24 +1669,67 @@ void DocumentPrivate::doProcessSearchMatch( RegularAreaRect *match, RunningSearc
     delete pagesToNotify;
 }
 
-void DocumentPrivate::doContinueAllDocumentSearch(void *pagesToNotifySet, void *pageMatchesMap, int currentPage, int searchID, const QString & text, int theCaseSensitivity, const QColor & color)
+void DocumentPrivate::doProcessPageSearchMatches( const QVector< QPair< RegularAreaRect *, QColor > > &matches, RunningSearch *search, QSet< int > *pagesToNotify, int currentPage, int searchID )
+{
+    typedef QPair<RegularAreaRect *, QColor> MatchColor;
+
+    if ( !matches.isEmpty() )
+    {
+        // highlight the matches of the page right away..
+        Page *page = m_pagesVector[ currentPage ];
+        QVector< RegularAreaRect * > areas;
+        areas.reserve( matches.count() );
+        foreach(const MatchColor &mc, matches)
+        {
+            page->d->setHighlight( searchID, mc.first, mc.second );
+            areas.append( mc.first );
+        }
+        search->highlightedPages.insert( currentPage );
+        search->matchCount += matches.count();
+        pagesToNotify->insert( currentPage );
+
+        // ..hand them to the observers..
+        foreach(DocumentObserver *observer, m_observers)
+            observer->notifySearchResults( searchID, currentPage, areas );
+        foreach(const MatchColor &mc, matches) delete mc.first;
+    }
+
+    // ..and repaint the page, also if it only lost the highlights of the previous search
+    if ( pagesToNotify->remove( currentPage ) )
+    {
+        foreach(DocumentObserver *observer, m_observers)
+            observer->notifyPageChanged( currentPage, DocumentObserver::Highlights );
+    }
+
+    if ( !matches.isEmpty() )
+        emit m_parent->searchMatchesFound( searchID, search->matchCount );
+}
+
+// The pages are searched one per event loop iteration, in the GUI thread,
+// for every search mode: the TextPages and their search state belong to the
+// pages, and they can be replaced or freed by the document at any time, so
+// they cannot be handed to another thread.
+void DocumentPrivate::doContinueAllDocumentSearch(void *pagesToNotifySet, int currentPage, int searchID, const QString & text, int theCaseSensitivity, int theOptions, const QColor & color)
 {
-    QMap< Page *, QVector<RegularAreaRect *> > *pageMatches = static_cast< QMap< Page *, QVector<RegularAreaRect *> > * >(pageMatchesMap);
+    typedef QPair<RegularAreaRect *, QColor> MatchColor;
     Qt::CaseSensitivity caseSensitivity = static_cast<Qt::CaseSensitivity>(theCaseSensitivity);
+    const SearchOptions options = SearchOptions(QFlag(theOptions));
     QSet< int > *pagesToNotify = static_cast< QSet< int > * >( pagesToNotifySet );
     RunningSearch *search = m_searches.value(searchID);
 
     if (m_searchCancelled || !search)
     {
-        typedef QVector<RegularAreaRect *> MatchesVector;
-
         QApplication::restoreOverrideCursor();
 
         if (search) search->isCurrentlySearching = false;
 
+        // the pages already searched keep their highlights, just repaint
+        // the ones that lost the highlights of the previous search
+        foreach(int pageNumber, *pagesToNotify)
+            foreach(DocumentObserver *observer, m_observers)
+                observer->notifyPageChanged( pageNumber, DocumentObserver::Highlights );
+
         emit m_parent->searchFinished( searchID, Document::SearchCancelled );
-        foreach(const MatchesVector &mv, *pageMatches) qDeleteAll(mv);
-        delete pageMatches;
         delete pagesToNotify;
         return;
     }
@@ -1600,89 +1740,62 @@ void DocumentPrivate::doContinueAllDocumentSearch(void *pagesToNotifySet, void *
         Page *page = m_pagesVector.at(currentPage);
         int pageNumber = page->number(); // redundant? is it == currentPage ?
 
+        // skip the pages which cannot contain the text
+        const bool candidate = search->candidatePages.isNull() || search->candidatePages.testBit( pageNumber );
+
         // request search page if needed
-        if ( !page->hasTextPage() )
+        if ( candidate && !page->hasTextPage() )
             m_parent->requestTextPage( pageNumber );
 
         // loop on a page adding highlights for all found items
+        QVector<MatchColor> pageMatches;
         RegularAreaRect * lastMatch = 0;
-        while ( 1 )
+        while ( candidate )
         {
             if ( lastMatch )
-                lastMatch = page->findText( searchID, text, NextResult, caseSensitivity, lastMatch );
+                lastMatch = page->findText( searchID, text, NextResult, caseSensitivity, lastMatch, options );
             else
-                lastMatch = page->findText( searchID, text, FromTop, caseSensitivity );
+                lastMatch = page->findText( searchID, text, FromTop, caseSensitivity, 0, options );
 
             if ( !lastMatch )
                 break;
 
-            // add highligh rect to the matches map
-            (*pageMatches)[page].append(lastMatch);
+            // add highligh rect to the matches of the page
+            pageMatches.append(MatchColor(lastMatch, color));
         }
         delete lastMatch;
 
-        QMetaObject::invokeMethod(m_parent, "doContinueAllDocumentSearch", Qt::QueuedConnection, Q_ARG(void *, pagesToNotifySet), Q_ARG(void *, pageMatches), Q_ARG(int, currentPage + 1), Q_ARG(int, searchID), Q_ARG(QString, text), Q_ARG(int, caseSensitivity), Q_ARG(QColor, color));
+        doProcessPageSearchMatches( pageMatches, search, pagesToNotify, currentPage, searchID );
+
+        QMetaObject::invokeMethod(m_parent, "doContinueAllDocumentSearch", Qt::QueuedConnection, Q_ARG(void *, pagesToNotifySet), Q_ARG(int, currentPage + 1), Q_ARG(int, searchID), Q_ARG(QString, text), Q_ARG(int, caseSensitivity), Q_ARG(int, options), Q_ARG(QColor, color));
     }
     else
     {
-        // reset cursor to previous shape
-        QApplication::restoreOverrideCursor();
-
-        search->isCurrentlySearching = false;
-        bool foundAMatch = pageMatches->count() != 0;
-        QMap< Page *, QVector<RegularAreaRect *> >::const_iterator it, itEnd;
-        it = pageMatches->constBegin();
-        itEnd = pageMatches->constEnd();
-        for ( ; it != itEnd; ++it)
-        {
-            foreach(RegularAreaRect *match, it.value())
-            {
-                it.key()->d->setHighlight( searchID, match, color );
-                delete match;
-            }
-            search->highlightedPages.insert( it.key()->number() );
-            pagesToNotify->insert( it.key()->number() );
-        }
-
-        foreach(DocumentObserver *observer, m_observers)
-            observer->notifySetup( m_pagesVector, 0 );
-
-        // notify observers about highlights changes
-        foreach(int pageNumber, *pagesToNotify)
-            foreach(DocumentObserver *observer, m_observers)
-                observer->notifyPageChanged( pageNumber, DocumentObserver::Highlights );
-
-        if (foundAMatch) emit m_parent->searchFinished(searchID, Document::MatchFound );
-        else emit m_parent->searchFinished( searchID, Document::NoMatchFound );
-
-        delete pageMatches;
-        delete pagesToNotify;
+        finishDocumentSearch( search, pagesToNotify, searchID );
     }
 }
 
-void DocumentPrivate::doContinueGooglesDocumentSearch(void *pagesToNotifySet, void *pageMatchesMap, int currentPage, int searchID, const QStringList & words, int theCaseSensitivity, const QColor & color, bool matchAll)
+void DocumentPrivate::doContinueGooglesDocumentSearch(void *pagesToNotifySet, int currentPage, int searchID, const QStringList & words, int theCaseSensitivity, int theOptions, const QColor & color, bool matchAll)
 {
     typedef QPair<RegularAreaRect *, QColor> MatchColor;
-    QMap< Page *, QVector<MatchColor> > *pageMatches = static_cast< QMap< Page *, QVector<MatchColor> > * >(pageMatchesMap);
     Qt::CaseSensitivity caseSensitivity = static_cast<Qt::CaseSensitivity>(theCaseSensitivity);
+    const SearchOptions options = SearchOptions(QFlag(theOptions));
     QSet< int > *pagesToNotify = static_cast< QSet< int > * >( pagesToNotifySet );
     RunningSearch *search = m_searches.value(searchID);
 
     if (m_searchCancelled || !search)
     {
-        typedef QVector<MatchColor> MatchesVector;
-
         QApplication::restoreOverrideCursor();
 
         if (search) search->isCurrentlySearching = false;
 
-        emit m_parent->searchFinished( searchID, Document::SearchCancelled );
+        // the pages already searched keep their highlights, just repaint
+        // the ones that lost the highlights of the previous search
+        foreach(int pageNumber, *pagesToNotify)
+            foreach(DocumentObserver *observer, m_observers)
+                observer->notifyPageChanged( pageNumber, DocumentObserver::Highlights );
 
-        foreach(const MatchesVector &mv, *pageMatches)
-        {
-            foreach(const MatchColor &mc, mv) delete mc.first;
-        }
-        delete pageMatches;
+        emit m_parent->searchFinished( searchID, Document::SearchCancelled );
         delete pagesToNotify;
         return;
     }
@@ -1698,14 +1811,18 @@ void DocumentPrivate::doContinueGooglesDocumentSearch(void *pagesToNotifySet, vo
         Page *page = m_pagesVector.at(currentPage);
         int pageNumber = page->number(); // redundant? is it == currentPage ?
 
+        // skip the pages which cannot contain the words
+        const bool candidate = search->candidatePages.isNull() || search->candidatePages.testBit( pageNumber );
+
         // request search page if needed
-        if ( !page->hasTextPage() )
+        if ( candidate && !page->hasTextPage() )
             m_parent->requestTextPage( pageNumber );
 
         // loop on a page adding highlights for all found items
-        bool allMatched = wordCount > 0,
+        QVector<MatchColor> pageMatches;
+        bool allMatched = candidate && wordCount > 0,
              anyMatched = false;
-        for ( int w = 0; w < wordCount; w++ )
+        for ( int w = 0; candidate && w < wordCount; w++ )
         {
             const QString &word = words[ w ];
             int newHue = baseHue - w * hueStep;
@@ -1718,15 +1835,15 @@ void DocumentPrivate::doContinueGooglesDocumentSearch(void *pagesToNotifySet, vo
             while ( 1 )
             {
                 if ( lastMatch )
-                    lastMatch = page->findText( searchID, word, NextResult, caseSensitivity, lastMatch );
+                    lastMatch = page->findText( searchID, word, NextResult, caseSensitivity, lastMatch, options );
                 else
-                    lastMatch = page->findText( searchID, word, FromTop, caseSensitivity);
+                    lastMatch = page->findText( searchID, word, FromTop, caseSensitivity, 0, options );
 
                 if ( !lastMatch )
                     break;
 
-                // add highligh rect to the matches map
-                (*pageMatches)[page].append(MatchColor(lastMatch, wordColor));
+                // add highligh rect to the matches of the page
+                pageMatches.append(MatchColor(lastMatch, wordColor));
                 wordMatched = true;
             }
             allMatched = allMatched && wordMatched;
@@ -1736,49 +1853,40 @@ void DocumentPrivate::doContinueGooglesDocumentSearch(void *pagesToNotifySet, vo
         // if not all words are present in page, remove partial highlights
         if ( !allMatched && matchAll )
         {
-            QVector<MatchColor> &matches = (*pageMatches)[page];
-            foreach(const MatchColor &mc, matches) delete mc.first;
-            pageMatches->remove(page);
+            foreach(const MatchColor &mc, pageMatches) delete mc.first;
+            pageMatches.clear();
         }
 
-        QMetaObject::invokeMethod(m_parent, "doContinueGooglesDocumentSearch", Qt::QueuedConnection, Q_ARG(void *, pagesToNotifySet), Q_ARG(void *, pageMatches), Q_ARG(int, currentPage + 1), Q_ARG(int, searchID), Q_ARG(QStringList, words), Q_ARG(int, caseSensitivity), Q_ARG(QColor, color), Q_ARG(bool, matchAll));
+        doProcessPageSearchMatches( pageMatches, search, pagesToNotify, currentPage, searchID );
+
+        QMetaObject::invokeMethod(m_parent, "doContinueGooglesDocumentSearch", Qt::QueuedConnection, Q_ARG(void *, pagesToNotifySet), Q_ARG(int, currentPage + 1), Q_ARG(int, searchID), Q_ARG(QStringList, words), Q_ARG(int, caseSensitivity), Q_ARG(int, options), Q_ARG(QColor, color), Q_ARG(bool, matchAll));
     }
     else
     {
-        // reset cursor to previous shape
-        QApplication::restoreOverrideCursor();
+        finishDocumentSearch( search, pagesToNotify, searchID );
+    }
+}
 
-        search->isCurrentlySearching = false;
-        bool foundAMatch = pageMatches->count() != 0;
-        QMap< Page *, QVector<MatchColor> >::const_iterator it, itEnd;
-        it = pageMatches->constBegin();
-        itEnd = pageMatches->constEnd();
-        for ( ; it != itEnd; ++it)
-        {
-            foreach(const MatchColor &mc, it.value())
-            {
-                it.key()->d->setHighlight( searchID, mc.first, mc.second );
-                delete mc.first;
-            }
-            search->highlightedPages.insert( it.key()->number() );
-            pagesToNotify->insert( it.key()->number() );
-        }
+void DocumentPrivate::finishDocumentSearch( RunningSearch *search, QSet< int > *pagesToNotify, int searchID )
+{
+    // reset cursor to previous shape
+    QApplication::restoreOverrideCursor();
 
-        // send page lists to update observers (since some filter on bookmarks)
-        foreach(DocumentObserver *observer, m_observers)
-            observer->notifySetup( m_pagesVector, 0 );
+    search->isCurrentlySearching = false;
 
-        // notify observers about highlights changes
-        foreach(int pageNumber, *pagesToNotify)
-            foreach(DocumentObserver *observer, m_observers)
-                observer->notifyPageChanged( pageNumber, DocumentObserver::Highlights );
+    // send page lists to update observers (since some filter on bookmarks)
+    foreach(DocumentObserver *observer, m_observers)
+        observer->notifySetup( m_pagesVector, 0 );
 
-        if (foundAMatch) emit m_parent->searchFinished( searchID, Document::MatchFound );
-        else emit m_parent->searchFinished( searchID, Document::NoMatchFound );
+    // notify observers about the highlights changes not notified yet
+    foreach(int pageNumber, *pagesToNotify)
+        foreach(DocumentObserver *observer, m_observers)
+            observer->notifyPageChanged( pageNumber, DocumentObserver::Highlights );
 
-        delete pageMatches;
-        delete pagesToNotify;
-    }
+    if (search->matchCount > 0) emit m_parent->searchFinished( searchID, Document::MatchFound );
+    else emit m_parent->searchFinished( searchID, Document::NoMatchFound );
+
+    delete pagesToNotify;
 }
 
 QVariant DocumentPrivate::documentMetaData( const QString &key, const QVariant &option ) const
@@ -2152,6 +2260,10 @@ void Document::closeDocument()
         d->m_fontThread = 0;
     }
 
+    // the export uses the generator, so it can not outlive the document;
+    // it is stopped like a cancelled one, without notifying its end
+    stopTextExport();
+
     // stop any audio playback
     AudioPlayer::instance()->stopPlaybacks();
 
@@ -2518,7 +2630,7 @@ bool Document::canExportToText() const
         return false;
 
     d->cacheExportFormats();
-    return !d->m_exportToText.isNull();
+    return !d->m_exportToText.isNull() || d->m_generator->hasFeature( Generator::TextExtraction );
 }
 
 bool Document::exportToText( const QString& fileName ) const
@@ -2527,10 +2639,48 @@ bool Document::exportToText( const QString& fileName ) const
         return false;
 
     d->cacheExportFormats();
-    if ( d->m_exportToText.isNull() )
+    if ( !d->m_exportToText.isNull() )
+        return d->m_generator->exportTo( fileName, d->m_exportToText );
+
+    // no native text export, write the text of the pages
+    if ( !d->m_generator->hasFeature( Generator::TextExtraction ) )
         return false;
 
-    return d->m_generator->exportTo( fileName, d->m_exportToText );
+    TextExportThread thread( d->m_generator, d->m_pagesVector, fileName );
+    thread.startExport( false );
+    return thread.succeeded();
+}
+
+bool Document::startTextExport( const QString& fileName )
+{
+    if ( !d->m_generator || d->m_textExportThread
+         || !d->m_generator->hasFeature( Generator::TextExtraction )
+         || !d->m_generator->hasFeature( Generator::Threaded ) )
+        return false;
+
+    // the native text export of the generator is preferred
+    d->cacheExportFormats();
+    if ( !d->m_exportToText.isNull() )
+        return false;
+
+    d->m_textExportThread = new TextExportThread( d->m_generator, d->m_pagesVector, fileName );
+    connect( d->m_textExportThread, SIGNAL(progress(int)), this, SIGNAL(textExportProgress(int)) );
+    connect( d->m_textExportThread, SIGNAL(finished()), this, SLOT(textExportFinished()) );
+
+    d->m_textExportThread->startExport( true );
+    return true;
+}
+
+void Document::stopTextExport()
+{
+    if ( !d->m_textExportThread )
+        return;
+
+    TextExportThread *thread = d->m_textExportThread;
+    d->m_textExportThread = 0;
+    disconnect( thread, 0, this, 0 );
+    // the export is waited for, as it uses the generator
+    delete thread;
 }
 
 ExportFormat::List Document::exportFormats() const
@@ -3063,6 +3213,9 @@ void Document::setViewport( const DocumentViewport & viewport, DocumentObserver
 
     const bool currentPageChanged = (oldPageNumber != currentViewportPage);
 
+    // the observers may read the data of the new current page right away
+    d->prepareGeneratorPages( currentViewportPage );
+
     // notify change to all other (different from id) observers
     foreach(DocumentObserver *o, d->m_observers)
     {
@@ -3089,6 +3242,7 @@ void Document::setPrevViewport()
     {
         // restore previous viewport and notify it to observers
         --d->m_viewportIterator;
+        d->prepareGeneratorPages( (*d->m_viewportIterator).pageNumber );
         foreachObserver( notifyViewportChanged( true ) );
     }
 }
@@ -3102,6 +3256,7 @@ void Document::setNextViewport()
     {
         // restore next viewport and notify it to observers
         ++d->m_viewportIterator;
+        d->prepareGeneratorPages( (*d->m_viewportIterator).pageNumber );
         foreachObserver( notifyViewportChanged( true ) );
     }
 }
@@ -3118,6 +3273,13 @@ void Document::setNextDocumentDestination( const QString &namedDestination )
 
 void Document::searchText( int searchID, const QString & text, bool fromStart, Qt::CaseSensitivity caseSensitivity,
                                SearchType type, bool moveViewport, const QColor & color, bool noDialogs )
+{
+    searchText( searchID, text, fromStart, caseSensitivity, type, moveViewport, color, noDialogs, NoSearchOption );
+}
+
+void Document::searchText( int searchID, const QString & text, bool fromStart, Qt::CaseSensitivity caseSensitivity,
+                               SearchType type, bool moveViewport, const QColor & color, bool noDialogs,
+                               SearchOptions options )
 {
     d->m_searchCancelled = false;
 
@@ -3149,6 +3311,7 @@ void Document::searchText( int searchID, const QString & text, bool fromStart, Q
     {
         RunningSearch * search = new RunningSearch();
         search->continueOnPage = -1;
+        search->matchCount = 0;
         searchIt = d->m_searches.insert( searchID, search );
     }
     if (d->m_lastSearchID != searchID)
@@ -3159,14 +3322,16 @@ void Document::searchText( int searchID, const QString & text, bool fromStart, Q
     RunningSearch * s = *searchIt;
 
     // update search structure
-    bool newText = text != s->cachedString;
+    bool newText = text != s->cachedString || options != s->cachedOptions;
     s->cachedString = text;
     s->cachedType = type;
     s->cachedCaseSensitivity = caseSensitivity;
+    s->cachedOptions = options;
     s->cachedViewportMove = moveViewport;
     s->cachedNoDialogs = noDialogs;
     s->cachedColor = color;
     s->isCurrentlySearching = true;
+    s->matchCount = 0;
 
     // global data for search
     QSet< int > *pagesToNotify = new QSet< int >;
@@ -3183,10 +3348,10 @@ void Document::searchText( int searchID, const QString & text, bool fromStart, Q
     // 1. ALLDOC - proces all document marking pages
     if ( type == AllDocument )
     {
-        QMap< Page *, QVector<RegularAreaRect *> > *pageMatches = new QMap< Page *, QVector<RegularAreaRect *> >;
+        s->candidatePages = d->searchCandidatePages( text, options );
 
         // search and highlight 'text' (as a solid phrase) on all pages
-        QMetaObject::invokeMethod(this, "doContinueAllDocumentSearch", Qt::QueuedConnection, Q_ARG(void *, pagesToNotify), Q_ARG(void *, pageMatches), Q_ARG(int, 0), Q_ARG(int, searchID), Q_ARG(QString, text), Q_ARG(int, caseSensitivity), Q_ARG(QColor, color));
+        QMetaObject::invokeMethod(this, "doContinueAllDocumentSearch", Qt::QueuedConnection, Q_ARG(void *, pagesToNotify), Q_ARG(int, 0), Q_ARG(int, searchID), Q_ARG(QString, text), Q_ARG(int, caseSensitivity), Q_ARG(int, options), Q_ARG(QColor, color));
     }
     // 2. NEXTMATCH - find next matching item (or start from top)
     // 3. PREVMATCH - find previous matching item (or start from bottom)
@@ -3199,15 +3364,16 @@ void Document::searchText( int searchID, const QString & text, bool fromStart, Q
         int currentPage = fromStart ? fromStartSearchPage : ((s->continueOnPage != -1) ? s->continueOnPage : viewportPage);
         Page * lastPage = fromStart ? 0 : d->m_pagesVector[ currentPage ];
         int pagesDone = 0;
+        s->candidatePages = d->searchCandidatePages( text, options );
 
         // continue checking last TextPage first (if it is the current page)
         RegularAreaRect * match = 0;
         if ( lastPage && lastPage->number() == s->continueOnPage )
         {
             if ( newText )
-                match = lastPage->findText( searchID, text, forward ? FromTop : FromBottom, caseSensitivity );
+                match = lastPage->findText( searchID, text, forward ? FromTop : FromBottom, caseSensitivity, 0, options );
             else
-                match = lastPage->findText( searchID, text, forward ? NextResult : PreviousResult, caseSensitivity, &s->continueOnMatch );
+                match = lastPage->findText( searchID, text, forward ? NextResult : PreviousResult, caseSensitivity, &s->continueOnMatch, options );
             if ( !match )
             {
                 if (forward) currentPage++;
@@ -3224,6 +3390,7 @@ void Document::searchText( int searchID, const QString & text, bool fromStart, Q
         searchStruct->searchID = searchID;
         searchStruct->text = text;
         searchStruct->caseSensitivity = caseSensitivity;
+        searchStruct->options = options;
         searchStruct->moveViewport = moveViewport;
         searchStruct->color = color;
         searchStruct->noDialogs = noDialogs;
@@ -3236,11 +3403,31 @@ void Document::searchText( int searchID, const QString & text, bool fromStart, Q
     {
         bool matchAll = type == GoogleAll;
 
-        QMap< Page *, QVector< QPair<RegularAreaRect *, QColor> > > *pageMatches = new QMap< Page *, QVector<QPair<RegularAreaRect *, QColor> > >;
         const QStringList words = text.split( ' ', QString::SkipEmptyParts );
 
+        // the pages which may contain all, or any, of the words
+        s->candidatePages = QBitArray();
+        foreach ( const QString &word, words )
+        {
+            const QBitArray pages = d->searchCandidatePages( word, options );
+            if ( pages.isNull() )
+            {
+                // any page may contain this word
+                if ( matchAll )
+                    continue;
+                s->candidatePages = QBitArray();
+                break;
+            }
+            if ( s->candidatePages.isNull() )
+                s->candidatePages = pages;
+            else if ( matchAll )
+                s->candidatePages &= pages;
+            else
+                s->candidatePages |= pages;
+        }
+
         // search and highlight every word in 'text' on all pages
-        QMetaObject::invokeMethod(this, "doContinueGooglesDocumentSearch", Qt::QueuedConnection, Q_ARG(void *, pagesToNotify), Q_ARG(void *, pageMatches), Q_ARG(int, 0), Q_ARG(int, searchID), Q_ARG(QStringList, words), Q_ARG(int, caseSensitivity), Q_ARG(QColor, color), Q_ARG(bool, matchAll));
+        QMetaObject::invokeMethod(this, "doContinueGooglesDocumentSearch", Qt::QueuedConnection, Q_ARG(void *, pagesToNotify), Q_ARG(int, 0), Q_ARG(int, searchID), Q_ARG(QStringList, words), Q_ARG(int, caseSensitivity), Q_ARG(int, options), Q_ARG(QColor, color), Q_ARG(bool, matchAll));
     }
 }
 
@@ -3259,7 +3446,7 @@ void Document::continueSearch( int searchID )
     if ( !p->isCurrentlySearching )
         searchText( searchID, p->cachedString, false, p->cachedCaseSensitivity,
                     p->cachedType, p->cachedViewportMove, p->cachedColor,
-                    p->cachedNoDialogs );
+                    p->cachedNoDialogs, p->cachedOptions );
 }
 
 void Document::continueSearch( int searchID, SearchType type )
@@ -3277,7 +3464,7 @@ void Document::continueSearch( int searchID, SearchType type )
     if ( !p->isCurrentlySearching )
         searchText( searchID, p->cachedString, false, p->cachedCaseSensitivity,
                     type, p->cachedViewportMove, p->cachedColor,
-                    p->cachedNoDialogs );
+                    p->cachedNoDialogs, p->cachedOptions );
 }
 
 void Document::resetSearch( int searchID )
@@ -4202,6 +4389,28 @@ void DocumentPrivate::setPageBoundingBox( int page, const NormalizedRect& boundi
 
 }
 
+void DocumentPrivate::pageItemsAdded( int page )
+{
+    Page * kp = m_pagesVector.value( page );
+    if ( !m_generator || !kp )
+        return;
+
+    // openDocument() could not count the annotations of the file on this page
+    if ( !m_annotationsNeedSaveAs && !m_archiveData && canAddAnnotationsNatively() )
+    {
+        foreach ( const Annotation *annotation, kp->annotations() )
+        {
+            if ( annotation->flags() & Annotation::External )
+            {
+                m_annotationsNeedSaveAs = true;
+                break;
+            }
+        }
+    }
+
+    notifyAnnotationChanges( page );
+}
+
 void DocumentPrivate::calculateMaxTextPages()
 {
     int multipliers = qMax(1, qRound(getTotalMemory() / 536870912.0)); // 512 MB
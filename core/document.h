@@ -244,6 +244,33 @@ class OKULAR_EXPORT Document : public QObject
          */
         bool exportToText( const QString& fileName ) const;
 
+        /**
+         * Starts exporting the text of the document to @p fileName in the
+         * background, page by page, without keeping the text of the whole
+         * document in memory.
+         *
+         * The progress and the end of the export are notified using the
+         * signals textExportProgress() and textExportEnded().
+         *
+         * Returns false if the export can not run in the background (for
+         * example because the generator is not threaded) or if the generator
+         * has its own text export, in which case exportToText() has to be used.
+         *
+         * Closing the document stops the export without emitting
+         * textExportEnded().
+         *
+         * @since 0.17 (KDE 4.11)
+         */
+        bool startTextExport( const QString& fileName );
+
+        /**
+         * Force the termination of the text export started by startTextExport(),
+         * if running.
+         *
+         * @since 0.17 (KDE 4.11)
+         */
+        void stopTextExport();
+
         /**
          * Returns the list of supported export formats.
          * @see ExportFormat
@@ -461,6 +488,24 @@ class OKULAR_EXPORT Document : public QObject
         void searchText( int searchID, const QString & text, bool fromStart, Qt::CaseSensitivity caseSensitivity,
                          SearchType type, bool moveViewport, const QColor & color, bool noDialogs = false );
 
+        /**
+         * Searches the given @p text in the document.
+         *
+         * @param searchID The unique id for this search request.
+         * @param fromStart Whether the search should be started at begin of the document.
+         * @param caseSensitivity Whether the search is case sensitive.
+         * @param type The type of the search. @ref SearchType
+         * @param moveViewport Whether the viewport shall be moved to the position of the matches.
+         * @param color The highlighting color of the matches.
+         * @param noDialogs Whether a search dialog shall be shown.
+         * @param options How @p text is matched against the text of the pages. @ref SearchOption
+         *
+         * @since 0.17 (KDE 4.11)
+         */
+        void searchText( int searchID, const QString & text, bool fromStart, Qt::CaseSensitivity caseSensitivity,
+                         SearchType type, bool moveViewport, const QColor & color, bool noDialogs,
+                         SearchOptions options );
+
         /**
          * Continues the search for the given @p searchID.
          */
@@ -786,11 +831,37 @@ class OKULAR_EXPORT Document : public QObject
          */
         void fontReadingEnded();
 
+        /**
+         * Reports the progress of the text export started by startTextExport().
+         *
+         * \param page is the page whose text was just written
+         *
+         * @since 0.17 (KDE 4.11)
+         */
+        void textExportProgress( int page );
+
+        /**
+         * Reports that the text export started by startTextExport() ended,
+         * and whether it could write all the text.
+         *
+         * @since 0.17 (KDE 4.11)
+         */
+        void textExportEnded( bool success );
+
         /**
          * Reports that the current search finished
          */
         void searchFinished( int id, Okular::Document::SearchStatus endStatus );
 
+        /**
+         * Reports that the whole document search with the given @p id found
+         * @p matches matches so far. It is emitted for every page with matches,
+         * while the search is still running.
+         *
+         * @since 0.17 (KDE 4.11)
+         */
+        void searchMatchesFound( int id, int matches );
+
         /**
          * This signal is emitted whenever a source reference with the given parameters has been
          * activated.
@@ -831,14 +902,15 @@ class OKULAR_EXPORT Document : public QObject
         Q_PRIVATE_SLOT( d, void rotationFinished( int page, Okular::Page *okularPage ) )
         Q_PRIVATE_SLOT( d, void fontReadingProgress( int page ) )
         Q_PRIVATE_SLOT( d, void fontReadingGotFont( const Okular::FontInfo& font ) )
+        Q_PRIVATE_SLOT( d, void textExportFinished() )
         Q_PRIVATE_SLOT( d, void slotGeneratorConfigChanged( const QString& ) )
         Q_PRIVATE_SLOT( d, void refreshPixmaps( int ) )
         Q_PRIVATE_SLOT( d, void _o_configChanged() )
 
         // search thread simulators
         Q_PRIVATE_SLOT( d, void doContinueDirectionMatchSearch(void *doContinueDirectionMatchSearchStruct) )
-        Q_PRIVATE_SLOT( d, void doContinueAllDocumentSearch(void *pagesToNotifySet, void *pageMatchesMap, int currentPage, int searchID, const QString & text, int caseSensitivity, const QColor & color) )
-        Q_PRIVATE_SLOT( d, void doContinueGooglesDocumentSearch(void *pagesToNotifySet, void *pageMatchesMap, int currentPage, int searchID, const QStringList & words, int caseSensitivity, const QColor & color, bool matchAll) )
+        Q_PRIVATE_SLOT( d, void doContinueAllDocumentSearch(void *pagesToNotifySet, int currentPage, int searchID, const QString & text, int caseSensitivity, int options, const QColor & color) )
+        Q_PRIVATE_SLOT( d, void doContinueGooglesDocumentSearch(void *pagesToNotifySet, int currentPage, int searchID, const QStringList & words, int caseSensitivity, int options, const QColor & color, bool matchAll) )
 };
 
 
@@ -62,6 +62,7 @@ struct GeneratorInfo
 namespace Okular {
 
 class FontExtractionThread;
+class TextExportThread;
 
 struct DoContinueDirectionMatchSearchStruct
 {
@@ -72,6 +73,7 @@ struct DoContinueDirectionMatchSearchStruct
     int searchID;
     QString text;
     Qt::CaseSensitivity caseSensitivity;
+    SearchOptions options;
     bool moveViewport;
     QColor color;
     bool noDialogs;
@@ -112,6 +114,11 @@ class DocumentPrivate
         QString namePaperSize(double inchesWidth, double inchesHeight) const;
         QString localizedSize(const QSizeF &size) const;
         qulonglong calculateMemoryToFree();
+        qulonglong generatorCacheMemory() const;
+        // returns the part of memoryToFree left to free from the pixmaps
+        qulonglong freeGeneratorCacheMemory( qulonglong memoryToFree );
+        QBitArray searchCandidatePages( const QString &text, SearchOptions options ) const;
+        void prepareGeneratorPages( int pageNumber );
         void cleanupPixmapMemory();
         void cleanupPixmapMemory( qulonglong memoryToFree );
         AllocatedPixmap * searchLowestPriorityPixmap( bool unloadableOnly = false, bool thenRemoveIt = false, DocumentObserver *observer = 0 /* any */ );
@@ -148,14 +155,17 @@ class DocumentPrivate
         void rotationFinished( int page, Okular::Page *okularPage );
         void fontReadingProgress( int page );
         void fontReadingGotFont( const Okular::FontInfo& font );
+        void textExportFinished();
         void slotGeneratorConfigChanged( const QString& );
         void refreshPixmaps( int );
         void _o_configChanged();
         void doContinueDirectionMatchSearch(void *doContinueDirectionMatchSearchStruct);
-        void doContinueAllDocumentSearch(void *pagesToNotifySet, void *pageMatchesMap, int currentPage, int searchID, const QString & text, int caseSensitivity, const QColor & color);
-        void doContinueGooglesDocumentSearch(void *pagesToNotifySet, void *pageMatchesMap, int currentPage, int searchID, const QStringList & words, int caseSensitivity, const QColor & color, bool matchAll);
+        void doContinueAllDocumentSearch(void *pagesToNotifySet, int currentPage, int searchID, const QString & text, int caseSensitivity, int options, const QColor & color);
+        void doContinueGooglesDocumentSearch(void *pagesToNotifySet, int currentPage, int searchID, const QStringList & words, int caseSensitivity, int options, const QColor & color, bool matchAll);
 
         void doProcessSearchMatch( RegularAreaRect *match, RunningSearch *search, QSet< int > *pagesToNotify, int currentPage, int searchID, bool moveViewport, const QColor & color );
+        void finishDocumentSearch( RunningSearch *search, QSet< int > *pagesToNotify, int searchID );
+        void doProcessPageSearchMatches( const QVector< QPair< RegularAreaRect *, QColor > > &matches, RunningSearch *search, QSet< int > *pagesToNotify, int currentPage, int searchID );
 
         // generators stuff
         /**
@@ -168,6 +178,11 @@ class DocumentPrivate
          * Sets the bounding box of the given @p page (in terms of upright orientation, i.e., Rotation0).
          */
         void setPageBoundingBox( int page, const NormalizedRect& boundingBox );
+        /**
+         * Notifies the observers that the generator added the annotations and
+         * the form fields of the given @p page after opening the document.
+         */
+        void pageItemsAdded( int page );
         /**
          * Request a particular metadata of the Document itself (ie, not something
          * depending on the document type/backend).
@@ -251,6 +266,7 @@ class DocumentPrivate
         QString m_archivedFileName;
 
         QPointer< FontExtractionThread > m_fontThread;
+        QPointer< TextExportThread > m_textExportThread;
         bool m_fontsCached;
         DocumentInfo *m_documentInfo;
         FontInfo::List m_fontsCache;
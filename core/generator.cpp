@@ -143,6 +143,11 @@ QMutex* GeneratorPrivate::threadsLock()
     return m_threadsMutex;
 }
 
+QMutex* GeneratorPrivate::textPageLock()
+{
+    return &m_textPageMutex;
+}
+
 QVariant GeneratorPrivate::metaData( const QString &, const QVariant & ) const
 {
     return QVariant();
@@ -256,7 +261,10 @@ bool Generator::canGenerateTextPage() const
 
 void Generator::generateTextPage( Page *page )
 {
+    Q_D( Generator );
+    d->textPageLock()->lock();
     TextPage *tp = textPage( page );
+    d->textPageLock()->unlock();
     page->setTextPage( tp );
     signalTextGenerationDone( page, tp );
 }
@@ -412,6 +420,13 @@ void Generator::updatePageBoundingBox( int page, const NormalizedRect & bounding
         d->m_document->setPageBoundingBox( page, boundingBox );
 }
 
+void Generator::signalPageItemsAdded( int page )
+{
+    Q_D( Generator );
+    if ( d->m_document ) // still connected to document?
+        d->m_document->pageItemsAdded( page );
+}
+
 void Generator::requestFontData(const Okular::FontInfo & /*font*/, QByteArray * /*data*/)
 {
 
@@ -422,6 +437,25 @@ const SourceReference * Generator::dynamicSourceReference( int /*pageNr*/, doubl
   return 0;
 }
 
+qulonglong Generator::cacheMemory() const
+{
+    return 0;
+}
+
+qulonglong Generator::freeCacheMemory( qulonglong /*memory*/ )
+{
+    return 0;
+}
+
+QBitArray Generator::searchCandidatePages( const QString & /*text*/, Okular::SearchOptions /*options*/ )
+{
+    return QBitArray();
+}
+
+void Generator::preparePage( int /*pageNumber*/ )
+{
+}
+
 PixmapRequest::PixmapRequest( DocumentObserver *observer, int pageNumber, int width, int height, int priority, PixmapRequestFeatures features )
   : d( new PixmapRequestPrivate )
 {
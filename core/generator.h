@@ -17,6 +17,7 @@
 #include "global.h"
 #include "pagesize.h"
 
+#include <QtCore/QBitArray>
 #include <QtCore/QList>
 #include <QtCore/QObject>
 #include <QtCore/QSharedDataPointer>
@@ -187,6 +188,7 @@ class OKULAR_EXPORT Generator : public QObject
     /// @cond PRIVATE
     friend class PixmapGenerationThread;
     friend class TextPageGenerationThread;
+    friend class TextExportThread;
     /// @endcond
 
     Q_OBJECT
@@ -408,6 +410,16 @@ class OKULAR_EXPORT Generator : public QObject
          */
         void notice( const QString &message, int duration );
 
+        /**
+         * This signal should be emitted when the contents of the page with
+         * the given @p pageNumber changed after it was rendered (for example
+         * when a part of it, rendered in the background, became ready), so
+         * that new pixmaps are requested for it.
+         *
+         * @since 0.17 (KDE 4.11)
+         */
+        void pageContentsChanged( int pageNumber );
+
     protected:
         /**
          * This method must be called when the pixmap request triggered by generatePixmap()
@@ -475,6 +487,15 @@ class OKULAR_EXPORT Generator : public QObject
          */
         void updatePageBoundingBox( int page, const NormalizedRect & boundingBox );
 
+        /**
+         * This method must be called when the annotations or the form fields
+         * of the page @p page have been added after the page has already been
+         * handed to the Document, so that all observers are notified.
+         *
+         * @since 0.17 (KDE 4.11)
+         */
+        void signalPageItemsAdded( int page );
+
     protected Q_SLOTS:
         /**
          * Gets the font data for the given font
@@ -498,6 +519,51 @@ class OKULAR_EXPORT Generator : public QObject
          */
         Okular::Generator::PrintError printError() const;
 
+        /**
+         * Returns the memory, in bytes, used by the internal caches of the
+         * generator (decoded pages, rendered images, ...), so that the
+         * document can account for it when deciding how much memory to free
+         *
+         * @since 0.17 (KDE 4.11)
+         */
+        qulonglong cacheMemory() const;
+
+        /**
+         * Asks the generator to free at least @p memory bytes from its internal
+         * caches, and returns the memory actually freed
+         *
+         * A generator that cannot free its caches right now (e.g. because a
+         * page is being rendered) can return 0: the memory stays accounted to
+         * its caches and is asked again at the next memory check, the pixmaps
+         * of the document are not freed in its place.
+         *
+         * @since 0.17 (KDE 4.11)
+         */
+        qulonglong freeCacheMemory( qulonglong memory );
+
+        /**
+         * Returns the pages which may contain @p text when searched with
+         * the given @p options, as told by an index of the document, or a
+         * null bit array if the generator has no such index
+         *
+         * The returned array has a bit for each page of the document, and the
+         * pages whose bit is not set are skipped by the search, so it has to
+         * include every page where the text could be found.
+         *
+         * @since 0.17 (KDE 4.11)
+         */
+        QBitArray searchCandidatePages( const QString &text, Okular::SearchOptions options );
+
+        /**
+         * Called when the page @p pageNumber becomes the current page, or is
+         * about to be shown, so that the generator can load the data of the
+         * page it did not load when opening the document (like its
+         * transition and its actions) before they are read
+         *
+         * @since 0.17 (KDE 4.11)
+         */
+        void preparePage( int pageNumber );
+
     protected:
         /// @cond PRIVATE
         Generator( GeneratorPrivate &dd, QObject *parent, const QVariantList &args );
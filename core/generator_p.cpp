@@ -9,10 +9,15 @@
 
 #include "generator_p.h"
 
+#include <QtCore/QFile>
+#include <QtCore/QTextStream>
+
 #include <kdebug.h>
 
 #include "fontinfo.h"
 #include "generator.h"
+#include "textpage.h"
+#include "textpage_p.h"
 #include "utils.h"
 
 using namespace Okular;
@@ -100,7 +105,14 @@ void TextPageGenerationThread::run()
     mTextPage = 0;
 
     if ( mPage )
+    {
+        QMutexLocker locker( mGenerator->d_func()->textPageLock() );
         mTextPage = mGenerator->textPage( mPage );
+    }
+
+    // correct the text order here, not in the GUI thread
+    if ( mTextPage )
+        mTextPage->d->ensureTextOrder( mPage );
 }
 
 
@@ -141,4 +153,182 @@ void FontExtractionThread::run()
     }
 }
 
+
+class TextExportThread::Extractor : public QThread
+{
+    public:
+        Extractor( TextExportThread *parent )
+            : mParent( parent )
+        {
+        }
+
+    protected:
+        virtual void run()
+        {
+            mParent->extractPages();
+        }
+
+    private:
+        TextExportThread *mParent;
+};
+
+TextExportThread::TextExportThread( Generator *generator, const QVector< Page * > &pages, const QString &fileName )
+    : mGenerator( generator ), mPages( pages ), mFileName( fileName ),
+      mNextPage( 0 ), mWrittenPages( 0 ), mWindow( 1 ), mGoOn( true ), mSuccess( false )
+{
+}
+
+TextExportThread::~TextExportThread()
+{
+    stopExport();
+    wait();
+}
+
+void TextExportThread::startExport( bool async )
+{
+    if ( async )
+    {
+        start( QThread::InheritPriority );
+    }
+    else
+    {
+        run();
+    }
+}
+
+void TextExportThread::stopExport()
+{
+    QMutexLocker locker( &mMutex );
+    mGoOn = false;
+    mPageExtracted.wakeAll();
+    mPageWritten.wakeAll();
+}
+
+bool TextExportThread::succeeded() const
+{
+    return mSuccess;
+}
+
+QString TextExportThread::extractText( int page )
+{
+    // the TextPage is only needed for its text, so it does not end up in the
+    // page, and its text order is corrected here; the generators make only
+    // one TextPage at a time, also when the text generation thread runs
+    TextPage *tp = 0;
+    {
+        QMutexLocker locker( mGenerator->d_func()->textPageLock() );
+        tp = mGenerator->textPage( mPages.at( page ) );
+    }
+    if ( tp )
+        tp->d->ensureTextOrder( mPages.at( page ) );
+    const QString text = tp ? tp->text() : QString();
+    delete tp;
+    return text;
+}
+
+void TextExportThread::extractPages()
+{
+    QMutexLocker locker( &mMutex );
+    while ( true )
+    {
+        // do not get too far ahead of the writer
+        while ( mGoOn && mNextPage < mPages.count() && mNextPage >= mWrittenPages + mWindow )
+            mPageWritten.wait( &mMutex );
+
+        if ( !mGoOn || mNextPage >= mPages.count() )
+            return;
+
+        const int page = mNextPage++;
+        locker.unlock();
+        const QString text = extractText( page );
+        locker.relock();
+
+        mTexts.insert( page, text );
+        mPageExtracted.wakeAll();
+    }
+}
+
+void TextExportThread::run()
+{
+    mSuccess = false;
+
+    // write to a temporary file, so that a cancelled or failed export
+    // does not leave a truncated file in place of the target
+    const QString partFileName = mFileName + QLatin1String( ".part" );
+    QFile f( partFileName );
+    if ( !f.open( QIODevice::WriteOnly ) )
+        return;
+
+    QTextStream ts( &f );
+
+    // the generators that are not threaded can not extract text outside
+    // of the thread running the export
+    QList< Extractor * > extractors;
+    if ( mGenerator->hasFeature( Generator::Threaded ) )
+    {
+        const int count = qBound( 1, QThread::idealThreadCount(), 4 );
+        mWindow = 2 * count;
+        for ( int i = 0; i < count; ++i )
+        {
+            Extractor *extractor = new Extractor( this );
+            extractors.append( extractor );
+            extractor->start( QThread::LowPriority );
+        }
+    }
+
+    const int count = mPages.count();
+    int i = 0;
+    for ( ; i < count; ++i )
+    {
+        QString text;
+        if ( extractors.isEmpty() )
+        {
+            if ( !mGoOn )
+                break;
+            text = extractText( i );
+        }
+        else
+        {
+            QMutexLocker locker( &mMutex );
+            while ( mGoOn && !mTexts.contains( i ) )
+                mPageExtracted.wait( &mMutex );
+            if ( !mGoOn )
+                break;
+
+            text = mTexts.take( i );
+            mWrittenPages = i + 1;
+            mPageWritten.wakeAll();
+        }
+
+        ts << text;
+        ts << QChar( '\n' );
+        emit progress( i );
+    }
+
+    // let the extractors go, and wait for the page they are working on
+    {
+        QMutexLocker locker( &mMutex );
+        mNextPage = count;
+        mPageWritten.wakeAll();
+    }
+    foreach ( Extractor *extractor, extractors )
+    {
+        extractor->wait();
+        delete extractor;
+    }
+    mTexts.clear();
+
+    ts.flush();
+    mSuccess = i == count && f.error() == QFile::NoError;
+    f.close();
+
+    if ( mSuccess )
+    {
+        QFile::remove( mFileName );
+        mSuccess = QFile::rename( partFileName, mFileName );
+    }
+    if ( !mSuccess )
+        QFile::remove( partFileName );
+}
+
 #include "generator_p.moc"
@@ -12,12 +12,15 @@
 
 #include "area.h"
 
+#include <QtCore/QMap>
+#include <QtCore/QMutex>
 #include <QtCore/QSet>
 #include <QtCore/QThread>
+#include <QtCore/QVector>
+#include <QtCore/QWaitCondition>
 #include <QtGui/QImage>
 
 class QEventLoop;
-class QMutex;
 
 namespace Okular {
 
@@ -48,6 +51,8 @@ class GeneratorPrivate
         void textpageGenerationFinished();
 
         QMutex* threadsLock();
+        // held around each call to Generator::textPage()
+        QMutex* textPageLock();
 
         virtual QVariant metaData( const QString &key, const QVariant &option ) const;
         virtual QImage image( PixmapRequest * );
@@ -60,6 +65,7 @@ class GeneratorPrivate
         TextPageGenerationThread *mTextPageGenerationThread;
         mutable QMutex *m_mutex;
         QMutex *m_threadsMutex;
+        QMutex m_textPageMutex;
         bool mPixmapReady : 1;
         bool mTextPageReady : 1;
         bool m_closing : 1;
@@ -161,6 +167,56 @@ class FontExtractionThread : public QThread
         bool mGoOn;
 };
 
+/**
+ * Writes the text of the pages to a file, in page order. The TextPages are
+ * extracted by a few worker threads (or by the writer itself if the generator
+ * is not threaded), are never stored in the pages, and at most a few pages
+ * ahead of the one being written are kept in memory.
+ */
+class TextExportThread : public QThread
+{
+    Q_OBJECT
+
+    public:
+        TextExportThread( Generator *generator, const QVector< Page * > &pages, const QString &fileName );
+        ~TextExportThread();
+
+        void startExport( bool async );
+        void stopExport();
+
+        /**
+         * Whether the whole text was written (only meaningful once finished)
+         */
+        bool succeeded() const;
+
+    Q_SIGNALS:
+        void progress( int page );
+
+    protected:
+        virtual void run();
+
+    private:
+        class Extractor;
+        friend class Extractor;
+
+        QString extractText( int page );
+        void extractPages();
+
+        Generator *mGenerator;
+        QVector< Page * > mPages;
+        QString mFileName;
+        QMutex mMutex;
+        QWaitCondition mPageExtracted;
+        QWaitCondition mPageWritten;
+        // the text of the extracted pages not written yet
+        QMap< int, QString > mTexts;
+        int mNextPage;
+        int mWrittenPages;
+        int mWindow;
+        bool mGoOn;
+        bool mSuccess;
+};
+
 }
 
 #endif
@@ -38,6 +38,19 @@ enum SearchDirection
     PreviousResult  ///< Searching for the previous result on the page, earlier result should be located so we search from the last result not from the beginning of the page.
 };
 
+/**
+ * Describes how the search text is matched against the text of the pages.
+ * @since 0.17 (KDE 4.11)
+ */
+enum SearchOption
+{
+    NoSearchOption = 0,           ///< The search text is matched as a plain substring
+    WholeWordsSearch = 1,         ///< Only matches that are not part of a longer word are found
+    RegularExpressionSearch = 2,  ///< The search text is a regular expression
+    IgnoreDiacriticsSearch = 4    ///< Accents and ligatures are ignored, e.g. "oeuvre" matches "œuvre"
+};
+Q_DECLARE_FLAGS( SearchOptions, SearchOption )
+
 /**
  * A rotation.
  */
@@ -80,4 +93,6 @@ enum ScriptType
 
 }
 
+Q_DECLARE_OPERATORS_FOR_FLAGS( Okular::SearchOptions )
+
 #endif
@@ -52,3 +52,7 @@ bool DocumentObserver::canUnloadPixmap( int ) const
 void DocumentObserver::notifyCurrentPageChanged( int, int )
 {
 }
+
+void DocumentObserver::notifySearchResults( int, int, const QVector< Okular::RegularAreaRect * > & )
+{
+}
@@ -18,6 +18,7 @@
 namespace Okular {
 
 class Page;
+class RegularAreaRect;
 
 /**
  * @short Base class for objects being notified when something changes.
@@ -111,6 +112,21 @@ class OKULAR_EXPORT DocumentObserver
          */
         virtual void notifyCurrentPageChanged( int previous, int current );
 
+        /**
+         * This method is called while a whole document search is running,
+         * every time the search found matches on a page.
+         *
+         * @param searchID The id of the search.
+         * @param page The number of the page.
+         * @param matches The areas of the matches on the page; they are owned
+         *                by the document and valid only during this call.
+         *
+         * The matches are already highlighted on the page when this is called.
+         *
+         * @since 0.17 (KDE 4.11)
+         */
+        virtual void notifySearchResults( int searchID, int page, const QVector< Okular::RegularAreaRect * > &matches );
+
     private:
         class Private;
         const Private* d;
@@ -301,12 +301,19 @@ bool Page::hasAnnotations() const
 
 RegularAreaRect * Page::findText( int id, const QString & text, SearchDirection direction,
                                   Qt::CaseSensitivity caseSensitivity, const RegularAreaRect *lastRect ) const
+{
+    return findText( id, text, direction, caseSensitivity, lastRect, NoSearchOption );
+}
+
+RegularAreaRect * Page::findText( int id, const QString & text, SearchDirection direction,
+                                  Qt::CaseSensitivity caseSensitivity, const RegularAreaRect *lastRect,
+                                  SearchOptions options ) const
 {
     RegularAreaRect* rect = 0;
     if ( text.isEmpty() || !d->m_text )
         return rect;
 
-    rect = d->m_text->findText( id, text, direction, caseSensitivity, lastRect );
+    rect = d->m_text->findText( id, text, direction, caseSensitivity, lastRect, options );
     return rect;
 }
 
@@ -543,9 +550,10 @@ void Page::setTextPage( TextPage * textPage )
     {
         d->m_text->d->m_page = d;
         /**
-         * Correct text order for before text selection
+         * Correct text order for before text selection and searching
+         * (the generation thread does it already for threaded generators)
          */
-        d->m_text->d->correctTextOrder();
+        d->m_text->d->ensureTextOrder();
     }
 }
 
@@ -706,6 +714,14 @@ void Page::setFormFields( const QLinkedList< FormField * >& fields )
     {
         (*it)->d_ptr->setDefault();
     }
+
+    // apply the values restored before the form fields were set
+    if ( !d->restoredFormFieldList.isNull() )
+    {
+        if ( !d->formfields.isEmpty() )
+            d->restoreFormFields( d->restoredFormFieldList.documentElement() );
+        d->restoredFormFieldList.clear();
+    }
 }
 
 void Page::deletePixmap( DocumentObserver *observer )
@@ -829,40 +845,51 @@ void PagePrivate::restoreLocalContents( const QDomNode & pageNode )
         // parse formList child element
         else if ( childElement.tagName() == "forms" )
         {
+            // the generator may set the form fields after opening the
+            // document, so keep the values until then
             if ( formfields.isEmpty() )
-                continue;
-
-            QHash<int, FormField*> hashedforms;
-            QLinkedList< FormField * >::const_iterator fIt = formfields.begin(), fItEnd = formfields.end();
-            for ( ; fIt != fItEnd; ++fIt )
             {
-                hashedforms[(*fIt)->id()] = (*fIt);
+                restoredFormFieldList.clear();
+                restoredFormFieldList.appendChild( restoredFormFieldList.importNode( childElement, true ) );
+                continue;
             }
 
-            // iterate over all forms
-            QDomNode formsNode = childElement.firstChild();
-            while( formsNode.isElement() )
-            {
-                // get annotation element and advance to next annot
-                QDomElement formElement = formsNode.toElement();
-                formsNode = formsNode.nextSibling();
+            restoreFormFields( childElement );
+        }
+    }
+}
 
-                if ( formElement.tagName() != "form" )
-                    continue;
+void PagePrivate::restoreFormFields( const QDomElement & formsElement )
+{
+    QHash<int, FormField*> hashedforms;
+    QLinkedList< FormField * >::const_iterator fIt = formfields.begin(), fItEnd = formfields.end();
+    for ( ; fIt != fItEnd; ++fIt )
+    {
+        hashedforms[(*fIt)->id()] = (*fIt);
+    }
 
-                bool ok = true;
-                int index = formElement.attribute( "id" ).toInt( &ok );
-                if ( !ok )
-                    continue;
+    // iterate over all forms
+    QDomNode formsNode = formsElement.firstChild();
+    while( formsNode.isElement() )
+    {
+        // get annotation element and advance to next annot
+        QDomElement formElement = formsNode.toElement();
+        formsNode = formsNode.nextSibling();
 
-                QHash<int, FormField*>::const_iterator wantedIt = hashedforms.constFind( index );
-                if ( wantedIt == hashedforms.constEnd() )
-                    continue;
+        if ( formElement.tagName() != "form" )
+            continue;
 
-                QString value = formElement.attribute( "value" );
-                (*wantedIt)->d_ptr->setValue( value );
-            }
-        }
+        bool ok = true;
+        int index = formElement.attribute( "id" ).toInt( &ok );
+        if ( !ok )
+            continue;
+
+        QHash<int, FormField*>::const_iterator wantedIt = hashedforms.constFind( index );
+        if ( wantedIt == hashedforms.constEnd() )
+            continue;
+
+        QString value = formElement.attribute( "value" );
+        (*wantedIt)->d_ptr->setValue( value );
     }
 }
 
@@ -923,6 +950,12 @@ void PagePrivate::saveLocalContents( QDomNode & parentNode, QDomDocument & docum
             pageElement.appendChild( annotListElement );
     }
 
+    // the form fields were not set yet, so save back the values restored for them
+    if ( ( what & FormFieldPageItems ) && formfields.isEmpty() && !restoredFormFieldList.isNull() )
+    {
+        pageElement.appendChild( document.importNode( restoredFormFieldList.documentElement(), true ) );
+    }
+
     // add forms info if has got any
     if ( ( what & FormFieldPageItems ) && !formfields.isEmpty() )
     {
@@ -71,6 +71,11 @@ class PagePrivate
          */
         void saveLocalContents( QDomNode & parentNode, QDomDocument & document, PageItems what = AllPageItems ) const;
 
+        /**
+         * Sets the values of the form fields from the <forms> element @p formsElement.
+         */
+        void restoreFormFields( const QDomElement & formsElement );
+
         /**
          * Rotates the image and object rects of the page to the given @p orientation.
          */
@@ -138,6 +143,7 @@ class PagePrivate
 
         bool m_isBoundingBoxKnown : 1;
         QDomDocument restoredLocalAnnotationList; // <annotationList>...</annotationList>
+        QDomDocument restoredFormFieldList; // <forms>...</forms> waiting for the form fields to be set
 };
 
 }
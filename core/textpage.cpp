@@ -11,6 +11,7 @@
 #include "textpage_p.h"
 
 #include <kdebug.h>
+#include <kglobal.h>
 
 #include "area.h"
 #include "debug_p.h"
@@ -18,9 +19,13 @@
 #include "page.h"
 #include "page_p.h"
 
+#include <algorithm>
+#include <climits>
+#include <cmath>
 #include <cstring>
 
 #include <QtAlgorithms>
+#include <QRegExp>
 #include <QVarLengthArray>
 
 using namespace Okular;
@@ -29,33 +34,197 @@ class SearchPoint
 {
     public:
         SearchPoint()
-            : offset_begin( -1 ), offset_end( -1 )
+            : offset_begin( -1 ), offset_end( -1 ), bufferKey( -1 )
         {
         }
 
-        TextList::ConstIterator it_begin;
-        TextList::ConstIterator it_end;
+        // the match, as offsets in the search buffer with key bufferKey
         int offset_begin;
         int offset_end;
+        int bufferKey;
 };
 
-/* text comparison functions */
+/*
+  Rationale behind FoldingTable:
+
+  searching while ignoring accents and ligatures means comparing the
+  characters with their diacritics stripped and their ligatures expanded.
+  Doing that per comparison is expensive, so the search buffers are folded
+  once when built, and the folding of the characters up to TableSize (all
+  the alphabetic scripts commonly found in documents) is computed only once
+  for the whole application.
+ */
+class FoldingTable
+{
+    static const int TableSize = 0x2000;
+
+    public:
+        FoldingTable()
+        {
+            for ( int i = 0; i < TableSize; ++i )
+                m_table[ i ] = computeFold( QChar( i ) );
+        }
+
+        /**
+         * Returns @p text without diacritics and with the ligatures expanded
+         */
+        QString fold( const QString &text ) const
+        {
+            QString res;
+            res.reserve( text.length() );
+            for ( int i = 0; i < text.length(); ++i )
+            {
+                const QChar c = text.at( i );
+                const QString folded = c.unicode() < TableSize ? m_table[ c.unicode() ] : computeFold( c );
+                // a null string means the character is kept as it is
+                if ( folded.isNull() )
+                    res += c;
+                else
+                    res += folded;
+            }
+            return res;
+        }
+
+    private:
+        static QString computeFold( const QChar &c )
+        {
+            switch ( c.unicode() )
+            {
+                // ligatures and letters without a canonical decomposition
+                case 0x00C6: return QLatin1String( "AE" );
+                case 0x00E6: return QLatin1String( "ae" );
+                case 0x0152: return QLatin1String( "OE" );
+                case 0x0153: return QLatin1String( "oe" );
+                case 0x00DF: return QLatin1String( "ss" );
+                case 0x1E9E: return QLatin1String( "SS" );
+                case 0x00DE: return QLatin1String( "TH" );
+                case 0x00FE: return QLatin1String( "th" );
+                case 0x00D8: return QLatin1String( "O" );
+                case 0x00F8: return QLatin1String( "o" );
+                case 0x0110: return QLatin1String( "D" );
+                case 0x0111: return QLatin1String( "d" );
+                case 0x0141: return QLatin1String( "L" );
+                case 0x0142: return QLatin1String( "l" );
+                case 0x0131: return QLatin1String( "i" );
+            }
+
+            switch ( c.category() )
+            {
+                case QChar::Mark_NonSpacing:
+                case QChar::Mark_SpacingCombining:
+                case QChar::Mark_Enclosing:
+                    // an empty (not null) string drops the character
+                    return QLatin1String( "" );
+                default:
+                    break;
+            }
+
+            if ( c.decompositionTag() == QChar::NoDecomposition )
+                return QString();
+
+            // decompose recursively, dropping the combining marks
+            QString res;
+            const QString decomposition = c.decomposition();
+            for ( int i = 0; i < decomposition.length(); ++i )
+            {
+                const QChar d = decomposition.at( i );
+                const QString folded = computeFold( d );
+                res += folded.isNull() ? QString( d ) : folded;
+            }
+            return res;
+        }
+
+        QString m_table[ TableSize ];
+};
 
-bool CaseInsensitiveCmpFn( const QStringRef & from, const QStringRef & to,
-                           int *fromLength, int *toLength )
+K_GLOBAL_STATIC( FoldingTable, s_foldingTable )
+
+/**
+ * The key of the search buffer used by a search with @p caseSensitivity and @p options
+ */
+static int searchBufferKey( Qt::CaseSensitivity caseSensitivity, SearchOptions options )
 {
-    *fromLength = from.length();
-    *toLength = to.length();
-    return from.compare( to, Qt::CaseInsensitive ) == 0;
+    // regular expressions do their own case handling, so they run on the
+    // buffer that is not case folded
+    const bool caseFolded = caseSensitivity == Qt::CaseInsensitive && !( options & RegularExpressionSearch );
+    return ( caseFolded ? 1 : 0 ) | ( ( options & IgnoreDiacriticsSearch ) ? 2 : 0 );
 }
 
-bool CaseSensitiveCmpFn( const QStringRef & from, const QStringRef & to,
-                           int *fromLength, int *toLength )
+/*
+  Rationale behind TextMatcher:
+
+  it is a Boyer-Moore-Horspool matcher working on the UTF-16 data of the
+  search buffer, in both directions. The bad character tables are indexed
+  by the low byte of the UTF-16 code units (as QStringMatcher does), so they
+  are cheap to build for every query and still give long shifts on text.
+ */
+class TextMatcher
 {
-    *fromLength = from.length();
-    *toLength = to.length();
-    return from.compare( to, Qt::CaseSensitive ) == 0;
-}
+    public:
+        explicit TextMatcher( const QString &pattern )
+            : m_pattern( pattern )
+        {
+            const int length = m_pattern.length();
+            const ushort *p = m_pattern.utf16();
+            for ( int i = 0; i < 256; ++i )
+            {
+                m_forwardSkip[ i ] = length;
+                m_backwardSkip[ i ] = length;
+            }
+            for ( int i = 0; i < length - 1; ++i )
+                m_forwardSkip[ p[ i ] & 0xff ] = length - 1 - i;
+            for ( int i = length - 1; i > 0; --i )
+                m_backwardSkip[ p[ i ] & 0xff ] = i;
+        }
+
+        /**
+         * Returns the position of the first match starting at or after @p from, or -1
+         */
+        int indexIn( const QString &text, int from ) const
+        {
+            const int length = m_pattern.length();
+            const ushort *p = m_pattern.utf16();
+            const ushort *t = text.utf16();
+            const int last = text.length() - length;
+            int pos = qMax( from, 0 );
+            while ( pos <= last )
+            {
+                int i = length - 1;
+                while ( i >= 0 && t[ pos + i ] == p[ i ] )
+                    --i;
+                if ( i < 0 )
+                    return pos;
+                pos += m_forwardSkip[ t[ pos + length - 1 ] & 0xff ];
+            }
+            return -1;
+        }
+
+        /**
+         * Returns the position of the last match ending at or before @p to, or -1
+         */
+        int lastIndexIn( const QString &text, int to ) const
+        {
+            const int length = m_pattern.length();
+            const ushort *p = m_pattern.utf16();
+            const ushort *t = text.utf16();
+            int pos = qMin( to, text.length() ) - length;
+            while ( pos >= 0 )
+            {
+                int i = 0;
+                while ( i < length && t[ pos + i ] == p[ i ] )
+                    ++i;
+                if ( i == length )
+                    return pos;
+                pos -= m_backwardSkip[ t[ pos ] & 0xff ];
+            }
+            return -1;
+        }
+
+    private:
+        QString m_pattern;
+        int m_forwardSkip[ 256 ];
+        int m_backwardSkip[ 256 ];
+};
 
 /**
  * If the horizontal arm of one rectangle fully contains the other (example below)
@@ -194,6 +363,99 @@ class TinyTextEntity
         int length;
 };
 
+/*
+  Rationale behind SpatialIndex:
+
+  selecting text and looking for the word under the mouse ask for the
+  entities at a point or inside an area many times per second while
+  dragging, so instead of checking all the entities of the page every
+  time, they are bucketed in a uniform grid over the page. Each cell
+  knows the entities overlapping it, in text order, so a query only looks
+  at the entities of the cells it touches.
+
+  The areas of the entities and of the queries are both in the
+  coordinates of the unrotated page (the rotation is applied only to the
+  returned areas), so the index does not depend on the rotation.
+ */
+class SpatialIndex
+{
+    public:
+        explicit SpatialIndex( const TextList &words )
+        {
+            // about four entities per cell for evenly distributed text
+            m_size = qBound( 1, (int)sqrt( words.count() / 4.0 ), 64 );
+            m_cells.resize( m_size * m_size );
+
+            const int count = words.count();
+            for ( int i = 0; i < count; ++i )
+            {
+                const NormalizedRect &area = words.at( i )->area;
+                const int left = cell( area.left ), right = cell( area.right );
+                const int top = cell( area.top ), bottom = cell( area.bottom );
+                for ( int y = top; y <= bottom; ++y )
+                    for ( int x = left; x <= right; ++x )
+                        m_cells[ y * m_size + x ].append( i );
+            }
+        }
+
+        /**
+         * Returns the indexes of the entities that may contain the point
+         * (@p x, @p y), in text order
+         */
+        const QVector< int > & entitiesAt( double x, double y ) const
+        {
+            return m_cells.at( cell( y ) * m_size + cell( x ) );
+        }
+
+        /**
+         * Returns the indexes of the entities that may intersect @p area,
+         * in text order and without duplicates
+         */
+        QVector< int > entitiesIn( const RegularAreaRect &area ) const
+        {
+            QVector< int > res;
+            foreach ( const NormalizedRect &rect, area )
+                addEntitiesIn( rect, res );
+            return sorted( res );
+        }
+
+        /**
+         * Returns the indexes of the entities that may intersect @p rect,
+         * in text order and without duplicates
+         */
+        QVector< int > entitiesIn( const NormalizedRect &rect ) const
+        {
+            QVector< int > res;
+            addEntitiesIn( rect, res );
+            return sorted( res );
+        }
+
+    private:
+        inline int cell( double coordinate ) const
+        {
+            return qBound( 0, (int)( coordinate * m_size ), m_size - 1 );
+        }
+
+        void addEntitiesIn( const NormalizedRect &rect, QVector< int > &res ) const
+        {
+            const int left = cell( rect.left ), right = cell( rect.right );
+            const int top = cell( rect.top ), bottom = cell( rect.bottom );
+            for ( int y = top; y <= bottom; ++y )
+                for ( int x = left; x <= right; ++x )
+                    res += m_cells.at( y * m_size + x );
+        }
+
+        static QVector< int > sorted( QVector< int > &entities )
+        {
+            qSort( entities );
+            entities.erase( std::unique( entities.begin(), entities.end() ), entities.end() );
+            return entities;
+        }
+
+        int m_size;
+        QVector< QVector< int > > m_cells;
+};
+
 
 TextEntity::TextEntity( const QString &text, NormalizedRect *area )
     : m_text( text ), m_area( area ), d( 0 )
@@ -224,13 +486,15 @@ NormalizedRect TextEntity::transformedArea(const QTransform &matrix) const
 
 
 TextPagePrivate::TextPagePrivate()
-    : m_page( 0 )
+    : m_spatialIndex( 0 ), m_page( 0 ), m_textOrderCorrected( false )
 {
 }
 
 TextPagePrivate::~TextPagePrivate()
 {
     qDeleteAll( m_searchPoints );
+    qDeleteAll( m_searchBuffers );
+    delete m_spatialIndex;
     qDeleteAll( m_words );
 }
 
@@ -261,7 +525,12 @@ TextPage::~TextPage()
 void TextPage::append( const QString &text, NormalizedRect *area )
 {
     if ( !text.isEmpty() )
+    {
         d->m_words.append( new TinyTextEntity( text.normalized(QString::NormalizationForm_KC), *area ) );
+        d->m_textOrderCorrected = false;
+        d->invalidateSearchBuffers();
+        d->invalidateSpatialIndex();
+    }
     delete area;
 }
 
@@ -289,33 +558,31 @@ typedef QList<WordWithCharacters> WordsWithCharacters;
 
 /**
  * We will divide the whole page in some regions depending on the horizontal and
- * vertical spacing among different regions. Each region will have an area and an
- * associated WordsWithCharacters in sorted order.
+ * vertical spacing among different regions. Each region will have an area and
+ * the span [begin, end) of its words in the word order shared by all the regions.
 */
 class RegionText
 {
 
 public:
     RegionText()
+        : m_begin(0), m_end(0)
     {
     };
 
-    RegionText(const WordsWithCharacters &wordsWithCharacters, const QRect &area)
-        : m_region_wordWithCharacters(wordsWithCharacters), m_area(area)
+    RegionText(int begin, int end, const QRect &area)
+        : m_begin(begin), m_end(end), m_area(area)
     {
     }
-    
-    inline QString string() const
+
+    inline int begin() const
     {
-        QString res;
-        foreach(const WordWithCharacters &word, m_region_wordWithCharacters)
-            res += word.text();
-        return res;
+        return m_begin;
     }
 
-    inline WordsWithCharacters text() const
+    inline int end() const
     {
-        return m_region_wordWithCharacters;
+        return m_end;
     }
 
     inline QRect area() const
@@ -328,13 +595,9 @@ public:
         m_area = area;
     }
 
-    inline void setText(const WordsWithCharacters &wordsWithCharacters)
-    {
-        m_region_wordWithCharacters = wordsWithCharacters;
-    }
-
 private:
-    WordsWithCharacters m_region_wordWithCharacters;
+    int m_begin;
+    int m_end;
     QRect m_area;
 };
 
@@ -545,34 +808,38 @@ RegularAreaRect * TextPage::textArea ( TextSelection * sel) const
     TextList::ConstIterator start = it, end = itEnd, tmpIt = it; //, tmpItEnd = itEnd;
     const MergeSide side = d->m_page ? (MergeSide)d->m_page->m_page->totalOrientation() : MergeRight;
 
-    NormalizedRect tmp;
+    const SpatialIndex *index = d->spatialIndex();
+
     //case 2(a)
-    for ( ; it != itEnd; ++it )
+    foreach ( int i, index->entitiesAt( startC.x, startC.y ) )
     {
-        tmp = (*it)->area;
-        if(tmp.contains(startC.x,startC.y)){
-            start = it;
-        }
-        if(tmp.contains(endC.x,endC.y)){
-            end = it;
-        }
+        if ( d->m_words.at( i )->area.contains( startC.x, startC.y ) )
+            start = tmpIt + i;
+    }
+    foreach ( int i, index->entitiesAt( endC.x, endC.y ) )
+    {
+        if ( d->m_words.at( i )->area.contains( endC.x, endC.y ) )
+            end = tmpIt + i;
     }
 
     //case 2(b)
     it = tmpIt;
     if(start == it && end == itEnd)
     {
-        for ( ; it != itEnd; ++it )
+        // is there any text reactangle within the start_end rect
+        bool found = false;
+        foreach ( int i, index->entitiesIn( start_end ) )
         {
-            // is there any text reactangle within the start_end rect
-            tmp = (*it)->area;
-            if(start_end.intersects(tmp))
+            if ( start_end.intersects( d->m_words.at( i )->area ) )
+            {
+                found = true;
                 break;
+            }
         }
 
-        // we have searched every text entities, but none is within the rectangle created by start and end
+        // none of the text entities is within the rectangle created by start and end
         // so, no selection should be done
-        if(it == itEnd)
+        if ( !found )
         {
             return ret;
         }
@@ -724,64 +991,45 @@ RegularAreaRect * TextPage::textArea ( TextSelection * sel) const
 
 RegularAreaRect* TextPage::findText( int searchID, const QString &query, SearchDirection direct,
                                      Qt::CaseSensitivity caseSensitivity, const RegularAreaRect *area )
+{
+    return findText( searchID, query, direct, caseSensitivity, area, NoSearchOption );
+}
+
+RegularAreaRect* TextPage::findText( int searchID, const QString &query, SearchDirection direct,
+                                     Qt::CaseSensitivity caseSensitivity, const RegularAreaRect *area,
+                                     SearchOptions options )
 {
     SearchDirection dir=direct;
     // invalid search request
     if ( d->m_words.isEmpty() || query.isEmpty() || ( area && area->isNull() ) )
         return 0;
-    TextList::ConstIterator start;
-    TextList::ConstIterator end;
     const QMap< int, SearchPoint* >::const_iterator sIt = d->m_searchPoints.constFind( searchID );
-    if ( sIt == d->m_searchPoints.constEnd() )
+    if ( sIt == d->m_searchPoints.constEnd() || (*sIt)->bufferKey != searchBufferKey( caseSensitivity, options ) )
     {
-        // if no previous run of this search is found, then set it to start
-        // from the beginning (respecting the search direction)
+        // if no previous run of this search is found (or it was done on
+        // another search buffer), then set it to start from the beginning
+        // (respecting the search direction)
         if ( dir == NextResult )
             dir = FromTop;
         else if ( dir == PreviousResult )
             dir = FromBottom;
     }
-    bool forward = true;
+    RegularAreaRect* ret = 0;
     switch ( dir )
     {
         case FromTop:
-            start = d->m_words.constBegin();
-            end = d->m_words.constEnd();
+            ret = d->findTextInternalForward( searchID, query, caseSensitivity, options, 0 );
             break;
         case FromBottom:
-            start = d->m_words.constEnd();
-            end = d->m_words.constBegin();
-            Q_ASSERT( start != end );
-            // we can safely go one step back, as we already checked
-            // that the list is not empty
-            --start;
-            forward = false;
+            ret = d->findTextInternalBackward( searchID, query, caseSensitivity, options, INT_MAX );
             break;
         case NextResult:
-            start = (*sIt)->it_end;
-            end = d->m_words.constEnd();
-            if ( ( start + 1 ) != end )
-                ++start;
+            ret = d->findTextInternalForward( searchID, query, caseSensitivity, options, (*sIt)->offset_end );
             break;
         case PreviousResult:
-            start = (*sIt)->it_begin;
-            end = d->m_words.constBegin();
-            if ( start != end )
-                --start;
-            forward = false;
+            ret = d->findTextInternalBackward( searchID, query, caseSensitivity, options, (*sIt)->offset_begin );
             break;
     };
-    RegularAreaRect* ret = 0;
-    const TextComparisonFunction cmpFn = caseSensitivity == Qt::CaseSensitive
-                                       ? CaseSensitiveCmpFn : CaseInsensitiveCmpFn;
-    if ( forward )
-    {
-        ret = d->findTextInternalForward( searchID, query, caseSensitivity, cmpFn, start, end );
-    }
-    else
-    {
-        ret = d->findTextInternalBackward( searchID, query, caseSensitivity, cmpFn, start, end );
-    }
     return ret;
 }
 
@@ -808,7 +1056,7 @@ static int stringLengthAdaptedWithHyphen(const QString &str, const TextList::Con
             {
                 len -= 1;
             }
-            else
+            else if ( page )
             {
                 // 2. if the next word is in a different line or not
                 const int pageWidth = page->m_page->width();
@@ -834,110 +1082,163 @@ static int stringLengthAdaptedWithHyphen(const QString &str, const TextList::Con
     return len;
 }
 
-RegularAreaRect* TextPagePrivate::findTextInternalForward( int searchID, const QString &_query,
-                                                             Qt::CaseSensitivity caseSensitivity,
-                                                             TextComparisonFunction comparer,
-                                                             const TextList::ConstIterator &start,
-                                                             const TextList::ConstIterator &end )
+/**
+ * Normalizes the query the same way the search buffer for @p caseSensitivity
+ * and @p ignoreDiacritics is built
+ */
+static QString searchQuery( const QString &query, Qt::CaseSensitivity caseSensitivity, bool ignoreDiacritics )
 {
-    const QTransform matrix = m_page ? m_page->rotationMatrix() : QTransform();
+    // normalize query search all unicode (including glyphs)
+    QString normalized = query.normalized( QString::NormalizationForm_KC );
+    if ( ignoreDiacritics )
+        normalized = s_foldingTable->fold( normalized );
+    return caseSensitivity == Qt::CaseSensitive ? normalized : normalized.toCaseFolded();
+}
 
-    RegularAreaRect* ret=new RegularAreaRect;
+const SearchBuffer * TextPagePrivate::searchBuffer( Qt::CaseSensitivity caseSensitivity, bool ignoreDiacritics )
+{
+    const int key = searchBufferKey( caseSensitivity, ignoreDiacritics ? IgnoreDiacriticsSearch : NoSearchOption );
+    SearchBuffer *&buffer = m_searchBuffers[ key ];
+    if ( buffer )
+        return buffer;
 
-    // normalize query search all unicode (including glyphs)
-    const QString query = (caseSensitivity == Qt::CaseSensitive)
-                            ? _query.normalized(QString::NormalizationForm_KC) 
-                            : _query.toLower().normalized(QString::NormalizationForm_KC);
-
-    // j is the current position in our query
-    // len is the length of the string in TextEntity
-    // queryLeft is the length of the query we have left
-    const TinyTextEntity* curEntity = 0;
-    int j=0, len=0, queryLeft=query.length();
-    int offset = 0;
-    bool haveMatch=false;
-    bool offsetMoved = false;
-    TextList::ConstIterator it = start;
-    TextList::ConstIterator it_begin;
-    for ( ; it != end; ++it )
+    buffer = new SearchBuffer;
+    buffer->key = key;
+    buffer->text.reserve( m_words.count() );
+    buffer->entities.reserve( m_words.count() );
+
+
+    int index = 0;
+    const TextList::ConstIterator itEnd = m_words.constEnd();
+    for ( TextList::ConstIterator it = m_words.constBegin(); it != itEnd; ++it, ++index )
     {
-        curEntity = *it;
-        const QString &str = curEntity->text();
-        if ( !offsetMoved && ( it == start ) )
-        {
-            if ( m_searchPoints.contains( searchID ) )
-            {
-                offset = qMax( m_searchPoints[ searchID ]->offset_end, 0 );
-            }
-            offsetMoved = true;
-        }
-        {
-            len = stringLengthAdaptedWithHyphen(str, it, end, m_page);
-            int min=qMin(queryLeft,len);
-#ifdef DEBUG_TEXTPAGE
-            kDebug(OkularDebug) << str.mid(offset,min) << ":" << _query.mid(j,min);
-#endif
-            // we have equal (or less than) area of the query left as the length of the current 
-            // entity
+        const QString str = (*it)->text();
 
-            int resStrLen = 0, resQueryLen = 0;
-            if ( !comparer( str.midRef( offset, min ), query.midRef( j, min ),
-                            &resStrLen, &resQueryLen ) )
-            {
-                    // we not have matched
-                    // this means we do not have a complete match
-                    // we need to get back to query start
-                    // and continue the search from this place
-                    haveMatch=false;
-                    ret->clear();
-#ifdef DEBUG_TEXTPAGE
-            kDebug(OkularDebug) << "\tnot matched";
-#endif
-                    j=0;
-                    offset = 0;
-                    queryLeft=query.length();
-                    it_begin = TextList::ConstIterator();
-            }
-            else
-            {
-                    // we have a match
-                    // move the current position in the query
-                    // to the position after the length of this string
-                    // we matched
-                    // subtract the length of the current entity from 
-                    // the left length of the query
+        // the hyphenation is removed here once, so that words broken
+        // at the end of a line are matched as a whole
+        const int len = stringLengthAdaptedWithHyphen( str, it, itEnd, m_page );
+        if ( len <= 0 )
+            continue;
+
+        QString part = str.left( len );
+        if ( ignoreDiacritics )
+            part = s_foldingTable->fold( part );
+        if ( caseSensitivity == Qt::CaseInsensitive )
+            part = part.toCaseFolded();
+        buffer->text += part;
+        for ( int i = 0; i < part.length(); ++i )
+            buffer->entities.append( index );
+    }
 #ifdef DEBUG_TEXTPAGE
-            kDebug(OkularDebug) << "\tmatched";
+    kDebug(OkularDebug) << "search buffer of" << buffer->text.length() << "characters for" << m_words.count() << "entities";
 #endif
-                    haveMatch=true;
-                    ret->append( curEntity->transformedArea( matrix ) );
-                    j += resStrLen;
-                    queryLeft -= resQueryLen;
-                    if ( it_begin == TextList::ConstIterator() )
-                    {
-                        it_begin = it;
-                    }
-            }
-        }
+    return buffer;
+}
+
+void TextPagePrivate::invalidateSearchBuffers()
+{
+    qDeleteAll( m_searchBuffers );
+    m_searchBuffers.clear();
+}
+
+const SpatialIndex * TextPagePrivate::spatialIndex()
+{
+    if ( !m_spatialIndex )
+        m_spatialIndex = new SpatialIndex( m_words );
+    return m_spatialIndex;
+}
+
+void TextPagePrivate::invalidateSpatialIndex()
+{
+    delete m_spatialIndex;
+    m_spatialIndex = 0;
+}
+
+RegularAreaRect * TextPagePrivate::searchMatch( int searchID, const SearchBuffer *buffer, int begin, int end )
+{
+    const QTransform matrix = m_page ? m_page->rotationMatrix() : QTransform();
 
-        if (haveMatch && queryLeft==0 && j==query.length())
+    // save or update the search point for the current searchID
+    QMap< int, SearchPoint* >::iterator sIt = m_searchPoints.find( searchID );
+    if ( sIt == m_searchPoints.end() )
+    {
+        sIt = m_searchPoints.insert( searchID, new SearchPoint );
+    }
+    SearchPoint* sp = *sIt;
+    sp->offset_begin = begin;
+    sp->offset_end = end;
+    sp->bufferKey = buffer->key;
+
+    // the entities between the first and the last matched characters,
+    // including the ones that do not appear in the buffer (hyphens)
+    RegularAreaRect* ret = new RegularAreaRect;
+    const int lastEntity = buffer->entities.at( end - 1 );
+    for ( int i = buffer->entities.at( begin ); i <= lastEntity; ++i )
+        ret->append( m_words.at( i )->transformedArea( matrix ) );
+    ret->simplify();
+    return ret;
+}
+
+/**
+ * Whether the match [@p begin, @p end) of @p text is not part of a longer word
+ */
+static bool isWholeWord( const QString &text, int begin, int end )
+{
+    if ( begin > 0 && text.at( begin - 1 ).isLetterOrNumber() && text.at( begin ).isLetterOrNumber() )
+        return false;
+    if ( end < text.length() && text.at( end ).isLetterOrNumber() && text.at( end - 1 ).isLetterOrNumber() )
+        return false;
+    return true;
+}
+
+RegularAreaRect* TextPagePrivate::findTextInternalForward( int searchID, const QString &_query,
+                                                             Qt::CaseSensitivity caseSensitivity,
+                                                             SearchOptions options, int from )
+{
+    const bool ignoreDiacritics = options & IgnoreDiacriticsSearch;
+    int pos = -1, length = 0;
+    const SearchBuffer *buffer = 0;
+    if ( options & RegularExpressionSearch )
+    {
+        buffer = searchBuffer( Qt::CaseSensitive, ignoreDiacritics );
+        const QString &text = buffer->text;
+        QRegExp rx( searchQuery( _query, Qt::CaseSensitive, ignoreDiacritics ), caseSensitivity, QRegExp::RegExp2 );
+        if ( rx.isValid() )
         {
-            // save or update the search point for the current searchID
-            QMap< int, SearchPoint* >::iterator sIt = m_searchPoints.find( searchID );
-            if ( sIt == m_searchPoints.end() )
+            for ( pos = rx.indexIn( text, from ); pos >= 0; pos = rx.indexIn( text, pos + 1 ) )
             {
-                sIt = m_searchPoints.insert( searchID, new SearchPoint );
+                // empty matches cannot be highlighted
+                length = rx.matchedLength();
+                if ( length > 0 && ( !( options & WholeWordsSearch ) || isWholeWord( text, pos, pos + length ) ) )
+                    break;
+                if ( pos + 1 > text.length() )
+                {
+                    pos = -1;
+                    break;
+                }
             }
-            SearchPoint* sp = *sIt;
-            sp->it_begin = it_begin;
-            sp->it_end = it - 1;
-            sp->offset_begin = j;
-            sp->offset_end = j + qMin( queryLeft, len );
-            ret->simplify();
-            return ret;
         }
     }
-    // end of loop - it means that we've ended the textentities
+    else
+    {
+        buffer = searchBuffer( caseSensitivity, ignoreDiacritics );
+        const QString &text = buffer->text;
+        const QString query = searchQuery( _query, caseSensitivity, ignoreDiacritics );
+        const TextMatcher matcher( query );
+        length = query.length();
+        for ( pos = matcher.indexIn( text, from ); pos >= 0; pos = matcher.indexIn( text, pos + 1 ) )
+        {
+            if ( !( options & WholeWordsSearch ) || isWholeWord( text, pos, pos + length ) )
+                break;
+        }
+    }
+#ifdef DEBUG_TEXTPAGE
+    kDebug(OkularDebug) << _query << "from" << from << "found at" << pos;
+#endif
+    if ( pos >= 0 )
+        return searchMatch( searchID, buffer, pos, pos + length );
+
+    // no match - it means that we've ended the text
     const QMap< int, SearchPoint* >::iterator sIt = m_searchPoints.find( searchID );
     if ( sIt != m_searchPoints.end() )
     {
@@ -945,114 +1246,57 @@ RegularAreaRect* TextPagePrivate::findTextInternalForward( int searchID, const Q
         m_searchPoints.erase( sIt );
         delete sp;
     }
-    delete ret;
     return 0;
 }
 
 RegularAreaRect* TextPagePrivate::findTextInternalBackward( int searchID, const QString &_query,
                                                             Qt::CaseSensitivity caseSensitivity,
-                                                            TextComparisonFunction comparer,
-                                                            const TextList::ConstIterator &start,
-                                                            const TextList::ConstIterator &loop_end )
+                                                            SearchOptions options, int to )
 {
-    const QTransform matrix = m_page ? m_page->rotationMatrix() : QTransform();
-
-    RegularAreaRect* ret=new RegularAreaRect;
-
-    // normalize query to search all unicode (including glyphs)
-    const QString query = (caseSensitivity == Qt::CaseSensitive) 
-                            ? _query.normalized(QString::NormalizationForm_KC) 
-                            : _query.toLower().normalized(QString::NormalizationForm_KC);
-
-    // j is the current position in our query
-    // len is the length of the string in TextEntity
-    // queryLeft is the length of the query we have left
-    const TinyTextEntity* curEntity = 0;
-    int j=query.length() - 1, len=0, queryLeft=query.length();
-    bool haveMatch=false;
-    bool offsetMoved = false;
-    TextList::ConstIterator it = start;
-    TextList::ConstIterator it_begin;
-    while ( true )
+    const bool ignoreDiacritics = options & IgnoreDiacriticsSearch;
+    int pos = -1, length = 0;
+    const SearchBuffer *buffer = 0;
+    if ( options & RegularExpressionSearch )
     {
-        curEntity = *it;
-        const QString &str = curEntity->text();
-        if ( !offsetMoved && ( it == start ) )
+        buffer = searchBuffer( Qt::CaseSensitive, ignoreDiacritics );
+        const QString &text = buffer->text;
+        QRegExp rx( searchQuery( _query, Qt::CaseSensitive, ignoreDiacritics ), caseSensitivity, QRegExp::RegExp2 );
+        // a regular expression match has no fixed length, so here we look for
+        // the last match starting before 'to'; negative offsets would
+        // make QRegExp count from the end of the text
+        int start = qMin( to, text.length() ) - 1;
+        while ( rx.isValid() && start >= 0 )
         {
-            offsetMoved = true;
+            pos = rx.lastIndexIn( text, start );
+            if ( pos < 0 )
+                break;
+            length = rx.matchedLength();
+            if ( length > 0 && ( !( options & WholeWordsSearch ) || isWholeWord( text, pos, pos + length ) ) )
+                break;
+            start = pos - 1;
+            pos = -1;
         }
+    }
+    else
+    {
+        buffer = searchBuffer( caseSensitivity, ignoreDiacritics );
+        const QString &text = buffer->text;
+        const QString query = searchQuery( _query, caseSensitivity, ignoreDiacritics );
+        const TextMatcher matcher( query );
+        length = query.length();
+        for ( pos = matcher.lastIndexIn( text, to ); pos >= 0; pos = matcher.lastIndexIn( text, pos + length - 1 ) )
         {
-            len = stringLengthAdaptedWithHyphen(str, it, m_words.constEnd(), m_page);
-            int min=qMin(queryLeft,len);
-#ifdef DEBUG_TEXTPAGE
-            kDebug(OkularDebug) << str.right(min) << " : " << _query.mid(j-min+1,min);
-#endif
-            // we have equal (or less than) area of the query left as the length of the current 
-            // entity
-
-            int resStrLen = 0, resQueryLen = 0;
-            // Note len is not str.length() so we can't use rightRef here
-            const int offset = len - min;
-            if ( !comparer( str.midRef(offset, min ), query.midRef( j - min + 1, min ),
-                            &resStrLen, &resQueryLen ) )
-            {
-                    // we not have matched
-                    // this means we do not have a complete match
-                    // we need to get back to query start
-                    // and continue the search from this place
-                    haveMatch=false;
-                    ret->clear();
-#ifdef DEBUG_TEXTPAGE
-                    kDebug(OkularDebug) << "\tnot matched";
-#endif
-                    j=query.length() - 1;
-                    queryLeft=query.length();
-                    it_begin = TextList::ConstIterator();
-            }
-            else
-            {
-                    // we have a match
-                    // move the current position in the query
-                    // to the position after the length of this string
-                    // we matched
-                    // subtract the length of the current entity from 
-                    // the left length of the query
+            if ( !( options & WholeWordsSearch ) || isWholeWord( text, pos, pos + length ) )
+                break;
+        }
+    }
 #ifdef DEBUG_TEXTPAGE
-                    kDebug(OkularDebug) << "\tmatched";
+    kDebug(OkularDebug) << _query << "to" << to << "found at" << pos;
 #endif
-                    haveMatch=true;
-                    ret->append( curEntity->transformedArea( matrix ) );
-                    j -= resStrLen;
-                    queryLeft -= resQueryLen;
-                    if ( it_begin == TextList::ConstIterator() )
-                    {
-                        it_begin = it;
-                    }
-            }
-        }
+    if ( pos >= 0 )
+        return searchMatch( searchID, buffer, pos, pos + length );
 
-        if (haveMatch && queryLeft==0 && j<0)
-        {
-            // save or update the search point for the current searchID
-            QMap< int, SearchPoint* >::iterator sIt = m_searchPoints.find( searchID );
-            if ( sIt == m_searchPoints.end() )
-            {
-                sIt = m_searchPoints.insert( searchID, new SearchPoint );
-            }
-            SearchPoint* sp = *sIt;
-            sp->it_begin = it;
-            sp->it_end = it_begin;
-            sp->offset_begin = j;
-            sp->offset_end = j + qMin( queryLeft, len );
-            ret->simplify();
-            return ret;
-        }
-        if ( it == loop_end )
-            break;
-        else
-            --it;
-    }
-    // end of loop - it means that we've ended the textentities
+    // no match - it means that we've ended the text
     const QMap< int, SearchPoint* >::iterator sIt = m_searchPoints.find( searchID );
     if ( sIt != m_searchPoints.end() )
     {
@@ -1060,7 +1304,6 @@ RegularAreaRect* TextPagePrivate::findTextInternalBackward( int searchID, const
         m_searchPoints.erase( sIt );
         delete sp;
     }
-    delete ret;
     return 0;
 }
 
@@ -1074,53 +1317,37 @@ QString TextPage::text(const RegularAreaRect *area, TextAreaInclusionBehaviour b
     if ( area && area->isNull() )
         return QString();
 
-    TextList::ConstIterator it = d->m_words.constBegin(), itEnd = d->m_words.constEnd();
     QString ret;
     if ( area )
     {
-        for ( ; it != itEnd; ++it )
+        foreach ( int i, d->spatialIndex()->entitiesIn( *area ) )
         {
+            const TinyTextEntity *te = d->m_words.at( i );
             if (b == AnyPixelTextAreaInclusionBehaviour)
             {
-                if ( area->intersects( (*it)->area ) )
+                if ( area->intersects( te->area ) )
                 {
-                    ret += (*it)->text();
+                    ret += te->text();
                 }
             }
             else
             {
-                NormalizedPoint center = (*it)->area.center();
+                NormalizedPoint center = te->area.center();
                 if ( area->contains( center.x, center.y ) )
                 {
-                    ret += (*it)->text();
+                    ret += te->text();
                 }
             }
         }
     }
     else
     {
-        for ( ; it != itEnd; ++it )
-            ret += (*it)->text();
+        foreach ( TinyTextEntity *te, d->m_words )
+            ret += te->text();
     }
     return ret;
 }
 
-static bool compareTinyTextEntityX(const WordWithCharacters &first, const WordWithCharacters &second)
-{
-    QRect firstArea = first.area().roundedGeometry(1000,1000);
-    QRect secondArea = second.area().roundedGeometry(1000,1000);
-
-    return firstArea.left() < secondArea.left();
-}
-
-static bool compareTinyTextEntityY(const WordWithCharacters &first, const WordWithCharacters &second)
-{
-    const QRect firstArea = first.area().roundedGeometry(1000,1000);
-    const QRect secondArea = second.area().roundedGeometry(1000,1000);
-
-    return firstArea.top() < secondArea.top();
-}
-
 /**
  * Sets a new world list. Deleting the contents of the old one
  */
@@ -1128,28 +1355,28 @@ void TextPagePrivate::setWordList(const TextList &list)
 {
     qDeleteAll(m_words);
     m_words = list;
+    // the search points are offsets in the search buffers of the old list
+    qDeleteAll(m_searchPoints);
+    m_searchPoints.clear();
+    invalidateSearchBuffers();
+    invalidateSpatialIndex();
 }
 
 /**
  * Remove all the spaces in between texts. It will make all the generators
  * same, whether they save spaces(like pdf) or not(like djvu).
  */
-static void removeSpace(TextList *words)
+static TextList removeSpace(const TextList &words)
 {
-    TextList::Iterator it = words->begin();
+    TextList res;
     const QString str(' ');
 
-    while ( it != words->end() )
+    foreach(TinyTextEntity *word, words)
     {
-        if((*it)->text() == str)
-        {
-            it = words->erase(it);
-        }
-        else
-        {
-            ++it;
-        }
+        if(word->text() != str)
+            res.append(word);
     }
+    return res;
 }
 
 /**
@@ -1268,9 +1495,77 @@ static WordsWithCharacters makeWordFromCharacters(const TextList &characters, in
 }
 
 /**
- * Create Lines from the words and sort them
+ * The words of the page being put in reading order, with their geometry in
+ * page pixels computed only once. The layout functions below work on indexes
+ * into words, so that regions and lines are just sorted spans of indexes and
+ * no WordWithCharacters is ever copied.
  */
-QList< QPair<WordsWithCharacters, QRect> > makeAndSortLines(const WordsWithCharacters &wordsTmp, int pageWidth, int pageHeight)
+struct WordLayout
+{
+    WordLayout(const WordsWithCharacters &w, int width, int height)
+        : words(w), pageWidth(width), pageHeight(height)
+    {
+        const int count = words.count();
+        roundedRects.reserve(count);
+        rects.reserve(count);
+        for(int i = 0 ; i < count ; ++i)
+        {
+            roundedRects.append(words.at(i).area().roundedGeometry(pageWidth,pageHeight));
+            rects.append(words.at(i).area().geometry(pageWidth,pageHeight));
+        }
+    }
+
+    const WordsWithCharacters &words;
+    // used to make lines and to measure the spacing
+    QVector<QRect> roundedRects;
+    // used for the projection profiles of the XY cut
+    QVector<QRect> rects;
+    const int pageWidth;
+    const int pageHeight;
+};
+
+/**
+ * A line of text: the indexes of its words sorted by x0(left), and its area
+ */
+struct TextLine
+{
+    QVector<int> words;
+    QRect area;
+};
+typedef QList<TextLine> TextLines;
+
+class CompareWordsTop
+{
+public:
+    CompareWordsTop(const QVector<QRect> &rects) : m_rects(rects) {}
+
+    inline bool operator()(int first, int second) const
+    {
+        return m_rects.at(first).top() < m_rects.at(second).top();
+    }
+
+private:
+    const QVector<QRect> &m_rects;
+};
+
+class CompareWordsLeft
+{
+public:
+    CompareWordsLeft(const QVector<QRect> &rects) : m_rects(rects) {}
+
+    inline bool operator()(int first, int second) const
+    {
+        return m_rects.at(first).left() < m_rects.at(second).left();
+    }
+
+private:
+    const QVector<QRect> &m_rects;
+};
+
+/**
+ * Create Lines from the @p count words in @p words and sort them
+ */
+static TextLines makeAndSortLines(const WordLayout &layout, const int *words, int count)
 {
     /**
      * We cannot assume that the generator will give us texts in the right order.
@@ -1282,89 +1577,80 @@ QList< QPair<WordsWithCharacters, QRect> > makeAndSortLines(const WordsWithChara
      * 2. Create textline where there is y overlap between TinyTextEntity 's
      * 3. Within each line sort the TinyTextEntity 's by x0(left)
      */
-    
-    QList< QPair<WordsWithCharacters, QRect> > lines;
 
-    /*
-     Make a new copy of the TextList in the words, so that the wordsTmp and lines do
-     not contain same pointers for all the TinyTextEntity.
-     */
-    QList<WordWithCharacters> words = wordsTmp;
+    TextLines lines;
 
     // Step 1
-    qSort(words.begin(),words.end(),compareTinyTextEntityY);
+    QVector<int> sorted(count);
+    for(int i = 0 ; i < count ; ++i)
+        sorted[i] = words[i];
+    qSort(sorted.begin(), sorted.end(), CompareWordsTop(layout.roundedRects));
 
     // Step 2
-    QList<WordWithCharacters>::Iterator it = words.begin(), itEnd = words.end();
+    /*
+     The lines that can still get words, in creation order. As the words come
+     sorted by top, a line whose bottom is above the current word cannot overlap
+     it nor any of the following ones, so it is dropped from the candidates.
+     */
+    QVector<int> activeLines;
 
     //for every non-space texts(characters/words) in the textList
-    for( ; it != itEnd ; it++)
+    foreach(int word, sorted)
     {
-        const QRect elementArea = (*it).area().roundedGeometry(pageWidth,pageHeight);
+        const QRect elementArea = layout.roundedRects.at(word);
         bool found = false;
 
-        for( int i = 0 ; i < lines.length() ; i++)
+        int active = 0;
+        for(int i = 0 ; i < activeLines.count() ; ++i)
         {
-            /* the line area which will be expanded
-               line_rects is only necessary to preserve the topmin and bottommax of all
-               the texts in the line, left and right is not necessary at all
-            */
-            QRect &lineArea = lines[i].second;
-            const int text_y1 = elementArea.top() ,
-                      text_y2 = elementArea.top() + elementArea.height() ,
-                      text_x1 = elementArea.left(),
-                      text_x2 = elementArea.left() + elementArea.width();
-            const int line_y1 = lineArea.top() ,
-                      line_y2 = lineArea.top() + lineArea.height(),
-                      line_x1 = lineArea.left(),
-                      line_x2 = lineArea.left() + lineArea.width();
+            if(lines.at(activeLines.at(i)).area.bottom() >= elementArea.top())
+                activeLines[active++] = activeLines.at(i);
+        }
+        activeLines.resize(active);
 
+        foreach(int i, activeLines)
+        {
             /*
                if the new text and the line has y overlapping parts of more than 70%,
                the text will be added to this line
              */
-            if(doesConsumeY(elementArea,lineArea,70))
+            TextLine &line = lines[i];
+            if(doesConsumeY(elementArea,line.area,70))
             {
-                WordsWithCharacters &line = lines[i].first;
-                line.append(*it);
-
-                const int newLeft = line_x1 < text_x1 ? line_x1 : text_x1;
-                const int newRight = line_x2 > text_x2 ? line_x2 : text_x2;
-                const int newTop = line_y1 < text_y1 ? line_y1 : text_y1;
-                const int newBottom = text_y2 > line_y2 ? text_y2 : line_y2;
-
-                lineArea = QRect( newLeft,newTop, newRight - newLeft, newBottom - newTop );
+                line.words.append(word);
+                line.area = line.area.united(elementArea);
                 found = true;
+                break;
             }
-
-            if(found) break;
         }
 
-        /* when we have found a new line create a new TextList containing
+        /* when we have found a new line create a new TextLine containing
            only one element and append it to the lines
          */
         if(!found)
         {
-            WordsWithCharacters tmp;
-            tmp.append((*it));
-            lines.append(QPair<WordsWithCharacters, QRect>(tmp, elementArea));
+            TextLine line;
+            line.words.append(word);
+            line.area = elementArea;
+            lines.append(line);
+            activeLines.append(lines.count() - 1);
         }
     }
 
     // Step 3
-    for(int i = 0 ; i < lines.length() ; i++)
+    for(int i = 0 ; i < lines.count() ; i++)
     {
-        WordsWithCharacters &list = lines[i].first;
-        qSort(list.begin(), list.end(), compareTinyTextEntityX);
+        QVector<int> &list = lines[i].words;
+        qSort(list.begin(), list.end(), CompareWordsLeft(layout.roundedRects));
     }
-    
+
     return lines;
 }
 
 /**
  * Calculate Statistical information from the lines we made previously
  */
-static void calculateStatisticalInformation(const QList<WordWithCharacters> &words, int pageWidth, int pageHeight, int *word_spacing, int *line_spacing, int *col_spacing)
+static void calculateStatisticalInformation(const TextLines &sortedLines, const WordLayout &layout, int *word_spacing, int *line_spacing, int *col_spacing)
 {
     /**
      * For the region, defined by line_rects and lines
@@ -1372,29 +1658,20 @@ static void calculateStatisticalInformation(const QList<WordWithCharacters> &wor
      * 2. Make character statistical analysis to differentiate between
      *   word spacing and column spacing.
      */
-    
-    /**
-     * Step 0
-     */
-    const QList< QPair<WordsWithCharacters, QRect> > sortedLines = makeAndSortLines(words, pageWidth, pageHeight);
 
     /**
      * Step 1
      */
     QMap<int,int> line_space_stat;
-    for(int i = 0 ; i < sortedLines.length(); i++)
+    for(int i = 0 ; i + 1 < sortedLines.count(); i++)
     {
-        const QRect rectUpper = sortedLines.at(i).second;
-
-        if(i+1 == sortedLines.length()) break;
-        const QRect rectLower = sortedLines.at(i+1).second;
+        const QRect rectUpper = sortedLines.at(i).area;
+        const QRect rectLower = sortedLines.at(i+1).area;
 
         int linespace = rectLower.top() - (rectUpper.top() + rectUpper.height());
         if(linespace < 0) linespace =-linespace;
 
-        if(line_space_stat.contains(linespace))
-            line_space_stat[linespace]++;
-        else line_space_stat[linespace] = 1;
+        line_space_stat[linespace]++;
     }
 
     *line_spacing = 0;
@@ -1416,88 +1693,41 @@ static void calculateStatisticalInformation(const QList<WordWithCharacters> &wor
     // We would like to use QMap instead of QHash as it will keep the keys sorted
     QMap<int,int> hor_space_stat;
     QMap<int,int> col_space_stat;
-    QList< QList<QRect> > space_rects;
-    QList<QRect> max_hor_space_rects;
 
     // Space in every line
-    for(int i = 0 ; i < sortedLines.length() ; i++)
+    foreach(const TextLine &line, sortedLines)
     {
-        const WordsWithCharacters list = sortedLines.at(i).first;
-        QList<QRect> line_space_rects;
-        int maxSpace = 0, minSpace = pageWidth;
+        int maxSpace = 0;
 
         // for every TinyTextEntity element in the line
-        WordsWithCharacters::ConstIterator it = list.begin(), itEnd = list.end();
-        QRect max_area1,max_area2;
-        QString before_max, after_max;
-
-        // for every line
-        for( ; it != itEnd ; it++ )
+        for(int i = 0 ; i + 1 < line.words.count() ; i++)
         {
-            const QRect area1 = (*it).area().roundedGeometry(pageWidth,pageHeight);
-            if( it+1 == itEnd ) break;
-
-            const QRect area2 = (*(it+1)).area().roundedGeometry(pageWidth,pageHeight);
-            int space = area2.left() - area1.right();
+            const QRect area1 = layout.roundedRects.at(line.words.at(i));
+            const QRect area2 = layout.roundedRects.at(line.words.at(i+1));
+            const int space = area2.left() - area1.right();
 
             if(space > maxSpace)
-            {
-                max_area1 = area1;
-                max_area2 = area2;
                 maxSpace = space;
-                before_max = (*it).text();
-                after_max = (*(it+1)).text();
-            }
-
-            if(space < minSpace && space != 0) minSpace = space;
 
             //if we found a real space, whose length is not zero and also less than the pageWidth
-            if(space != 0 && space != pageWidth)
+            if(space != 0 && space != layout.pageWidth)
             {
                 // increase the count of the space amount
-                if(hor_space_stat.contains(space)) hor_space_stat[space] = hor_space_stat[space]++;
-                else hor_space_stat[space] = 1;
-
-                int left,right,top,bottom;
-
-                left = area1.right();
-                right = area2.left();
-
-                top = area2.top() < area1.top() ? area2.top() : area1.top();
-                bottom = area2.bottom() > area1.bottom() ? area2.bottom() : area1.bottom();
-
-                QRect rect(left,top,right-left,bottom-top);
-                line_space_rects.append(rect);
+                hor_space_stat[space]++;
             }
         }
 
-        space_rects.append(line_space_rects);
-
-        if(hor_space_stat.contains(maxSpace))
+        // the widest space of the line is a column space candidate, not a word space
+        QMap<int,int>::iterator maxIt = hor_space_stat.find(maxSpace);
+        if(maxIt != hor_space_stat.end())
         {
-            if(hor_space_stat[maxSpace] != 1)
-                hor_space_stat[maxSpace] = hor_space_stat[maxSpace]--;
-            else hor_space_stat.remove(maxSpace);
+            if(maxIt.value() != 1)
+                --maxIt.value();
+            else hor_space_stat.erase(maxIt);
         }
 
         if(maxSpace != 0)
-        {
-            if (col_space_stat.contains(maxSpace))
-                col_space_stat[maxSpace] = col_space_stat[maxSpace]++;
-            else col_space_stat[maxSpace] = 1;
-
-            //store the max rect of each line
-            const int left = max_area1.right();
-                const int right = max_area2.left();
-            const int top = (max_area1.top() > max_area2.top()) ? max_area2.top() :
-                                                                  max_area1.top();
-            const int bottom = (max_area1.bottom() < max_area2.bottom()) ? max_area2.bottom() :
-                                                                           max_area1.bottom();
-
-            const QRect rect(left,top,right-left,bottom-top);
-            max_hor_space_rects.append(rect);
-        }
-        else max_hor_space_rects.append(QRect(0,0,0,0));
+            col_space_stat[maxSpace]++;
     }
 
     // All the between word space counts are in hor_space_stat
@@ -1518,31 +1748,50 @@ static void calculateStatisticalInformation(const QList<WordWithCharacters> &wor
     if(weighted_count)
         *word_spacing = (int) ((double)*word_spacing / (double)weighted_count + 0.5);
 
+    // the most frequent column space (the smallest one, in case of ties)
     *col_spacing = 0;
+    int col_count = 0;
     QMapIterator<int, int> iterate_col(col_space_stat);
 
     while (iterate_col.hasNext())
     {
         iterate_col.next();
-        if(iterate_col.value() > *col_spacing) *col_spacing = iterate_col.value();
+        if(iterate_col.value() > col_count)
+        {
+            col_count = iterate_col.value();
+            *col_spacing = iterate_col.key();
+        }
     }
-    *col_spacing = col_space_stat.key(*col_spacing);
 
     // if there is just one line in a region, there is no point in dividing it
-    if(sortedLines.length() == 1)
+    if(sortedLines.count() == 1)
         *word_spacing = *col_spacing;
 }
 
+/**
+ * Adds @p value to the projection profile @p proj for the pixels from @p first to
+ * @p last (both included), using @p proj as a difference array
+ */
+static inline void addToProjection(QVarLengthArray<int> &proj, int first, int last, int value)
+{
+    if(first < 0) first = 0;
+    if(last > proj.size() - 2) last = proj.size() - 2;
+    if(first > last) return;
+
+    proj[first] += value;
+    proj[last + 1] -= value;
+}
+
 /**
  * Implements the XY Cut algorithm for textpage segmentation
- * The resulting RegionTextList will contain RegionText whose WordsWithCharacters::word and
- * WordsWithCharacters::characters are reused from wordsWithCharacters (i.e. no new nor delete happens in this function)
+ * The resulting RegionTextList contains RegionText whose spans index @p order, which
+ * is reordered in place so that every region has its words in a contiguous span
  */
-static RegionTextList XYCutForBoundingBoxes(const QList<WordWithCharacters> &wordsWithCharacters, const NormalizedRect &boundingBox, int pageWidth, int pageHeight)
+static RegionTextList XYCutForBoundingBoxes(const WordLayout &layout, QVector<int> &order, const NormalizedRect &boundingBox)
 {
     RegionTextList tree;
-    QRect contentRect(boundingBox.geometry(pageWidth,pageHeight));
-    const RegionText root(wordsWithCharacters, contentRect);
+    QRect contentRect(boundingBox.geometry(layout.pageWidth,layout.pageHeight));
+    const RegionText root(0, order.count(), contentRect);
 
     // start the tree with the root, it is our only region at the start
     tree.push_back(root);
@@ -1554,25 +1803,26 @@ static RegionTextList XYCutForBoundingBoxes(const QList<WordWithCharacters> &wor
     {
         const RegionText node = tree.at(i);
         QRect regionRect = node.area();
+        const int *words = order.constData() + node.begin();
+        const int wordCount = node.end() - node.begin();
 
         /**
          * 1. calculation of projection profiles
          */
-        // allocate the size of proj profiles and initialize with 0
+        // allocate the size of proj profiles and initialize with 0,
+        // with one more slot for the difference array
         int size_proj_y = node.area().height();
         int size_proj_x = node.area().width();
         //dynamic memory allocation
-        QVarLengthArray<int> proj_on_xaxis(size_proj_x);
-        QVarLengthArray<int> proj_on_yaxis(size_proj_y);
-
-        for( int j = 0 ; j < size_proj_y ; ++j ) proj_on_yaxis[j] = 0;
-        for( int j = 0 ; j < size_proj_x ; ++j ) proj_on_xaxis[j] = 0;
+        QVarLengthArray<int> proj_on_xaxis(size_proj_x + 1);
+        QVarLengthArray<int> proj_on_yaxis(size_proj_y + 1);
 
-        const QList<WordWithCharacters> list = node.text();
+        for( int j = 0 ; j <= size_proj_y ; ++j ) proj_on_yaxis[j] = 0;
+        for( int j = 0 ; j <= size_proj_x ; ++j ) proj_on_xaxis[j] = 0;
 
         // Calculate tcx and tcy locally for each new region
         int word_spacing, line_spacing, column_spacing;
-        calculateStatisticalInformation(list, pageWidth, pageHeight, &word_spacing, &line_spacing, &column_spacing);
+        calculateStatisticalInformation(makeAndSortLines(layout, words, wordCount), layout, &word_spacing, &line_spacing, &column_spacing);
 
         const int tcx = word_spacing * 2;
         const int tcy = line_spacing * 2;
@@ -1582,26 +1832,24 @@ static RegionTextList XYCutForBoundingBoxes(const QList<WordWithCharacters> &wor
         int count;
 
         // for every text in the region
-        for(int j = 0 ; j < list.length() ; ++j )
+        for(int j = 0 ; j < wordCount ; ++j )
         {
-            TinyTextEntity *ent = list.at(j).word;
-            const QRect entRect = ent->area.geometry(pageWidth, pageHeight);
+            const QRect entRect = layout.rects.at(words[j]);
 
             // calculate vertical projection profile proj_on_xaxis1
-            for(int k = entRect.left() ; k <= entRect.left() + entRect.width() ; ++k)
-            {
-                if( ( k-regionRect.left() ) < size_proj_x && ( k-regionRect.left() ) >= 0 )
-                    proj_on_xaxis[k - regionRect.left()] += entRect.height();
-            }
+            addToProjection(proj_on_xaxis, entRect.left() - regionRect.left(),
+                            entRect.left() + entRect.width() - regionRect.left(), entRect.height());
 
             // calculate horizontal projection profile in the same way
-            for(int k = entRect.top() ; k <= entRect.top() + entRect.height() ; ++k)
-            {
-                if( ( k-regionRect.top() ) < size_proj_y && ( k-regionRect.top() ) >= 0 )
-                    proj_on_yaxis[k - regionRect.top()] += entRect.width();
-            }
+            addToProjection(proj_on_yaxis, entRect.top() - regionRect.top(),
+                            entRect.top() + entRect.height() - regionRect.top(), entRect.width());
         }
 
+        for( int j = 1 ; j < size_proj_y ; ++j )
+            proj_on_yaxis[j] += proj_on_yaxis[j-1];
+        for( int j = 1 ; j < size_proj_x ; ++j )
+            proj_on_xaxis[j] += proj_on_xaxis[j-1];
+
         for( int j = 0 ; j < size_proj_y ; ++j )
         {
             if (proj_on_yaxis[j] > maxY)
@@ -1743,90 +1991,69 @@ static RegionTextList XYCutForBoundingBoxes(const QList<WordWithCharacters> &wor
         else
         {
             // we can now update the node rectangle with the shrinked rectangle
-            RegionText tmpNode = tree.at(i);
-            tmpNode.setArea(regionRect);
-            tree.replace(i,tmpNode);
+            tree[i].setArea(regionRect);
             i++;
             continue;
         }
 
-        WordsWithCharacters list1,list2;
-
         // horizontal cut, topRect and bottomRect
-        if(cut_hor)
+        // vertical cut, leftRect and rightRect
+        const QRect &firstRect = cut_hor ? topRect : leftRect;
+        const QRect &secondRect = cut_hor ? bottomRect : rightRect;
+
+        // stable partition of the span of the node: the words of the first
+        // region go in front, the others after them
+        QVector<int> second;
+        int mid = node.begin();
+        for( int j = node.begin() ; j < node.end() ; ++j )
         {
-            for( int j = 0 ; j < list.length() ; ++j )
-            {
-                const WordWithCharacters word = list.at(j);
-                const QRect wordRect = word.area().geometry(pageWidth,pageHeight);
-
-                if(topRect.intersects(wordRect))
-                    list1.append(word);
-                else
-                    list2.append(word);
-            }
-
-            RegionText node1(list1,topRect);
-            RegionText node2(list2,bottomRect);
-
-            tree.replace(i,node1);
-            tree.insert(i+1,node2);
+            const int word = order.at(j);
+            if(firstRect.intersects(layout.rects.at(word)))
+                order[mid++] = word;
+            else
+                second.append(word);
         }
+        for( int j = 0 ; j < second.count() ; ++j )
+            order[mid + j] = second.at(j);
 
-        //vertical cut, leftRect and rightRect
-        else if(cut_ver)
-        {
-            for( int j = 0 ; j < list.length() ; ++j )
-            {
-                const WordWithCharacters word = list.at(j);
-                const QRect wordRect = word.area().geometry(pageWidth,pageHeight);
-
-                if(leftRect.intersects(wordRect))
-                    list1.append(word);
-                else 
-                    list2.append(word);
-            }
-
-            RegionText node1(list1,leftRect);
-            RegionText node2(list2,rightRect);
-
-            tree.replace(i,node1);
-            tree.insert(i+1,node2);
-        }
+        tree.replace(i,RegionText(node.begin(),mid,firstRect));
+        tree.insert(i+1,RegionText(mid,node.end(),secondRect));
     }
 
     return tree;
 }
 
 /**
- * Add spaces in between words in a line. It reuses the pointers passed in tree and might add new ones. You will need to take care of deleting them if needed
+ * Add spaces in between words in a line and break the words into characters.
+ * It reuses the characters of the words and adds new ones for the spaces; the
+ * words themselves are not part of the result.
  */
-WordsWithCharacters addNecessarySpace(RegionTextList tree, int pageWidth, int pageHeight)
+static TextList addNecessarySpace(const WordLayout &layout, const QVector<int> &order, const RegionTextList &tree)
 {
     /**
      * 1. Call makeAndSortLines before adding spaces in between words in a line
      * 2. Now add spaces between every two words in a line
      * 3. Finally, extract all the space separated texts from each region and return it
      */
+    TextList res;
 
-    // Only change the texts under RegionTexts, not the area
-    for(int j = 0 ; j < tree.length() ; j++)
+    foreach(const RegionText &region, tree)
     {
-        RegionText &tmpRegion = tree[j];
-
         // Step 01
-        QList< QPair<WordsWithCharacters, QRect> > sortedLines = makeAndSortLines(tmpRegion.text(), pageWidth, pageHeight);
+        const TextLines sortedLines = makeAndSortLines(layout, order.constData() + region.begin(), region.end() - region.begin());
 
         // Step 02
-        for(int i = 0 ; i < sortedLines.length() ; i++)
+        foreach(const TextLine &line, sortedLines)
         {
-            WordsWithCharacters &list = sortedLines[i].first;
-            for(int k = 0 ; k < list.length() ; k++ )
+            const QVector<int> &list = line.words;
+            for(int k = 0 ; k < list.count() ; k++ )
             {
-                const QRect area1 = list.at(k).area().roundedGeometry(pageWidth,pageHeight);
-                if( k+1 >= list.length() ) break;
+                // Step 03
+                res += layout.words.at(list.at(k)).characters;
+                if( k+1 >= list.count() ) break;
 
-                const QRect area2 = list.at(k+1).area().roundedGeometry(pageWidth,pageHeight);
+                const QRect area1 = layout.roundedRects.at(list.at(k));
+                const QRect area2 = layout.roundedRects.at(list.at(k+1));
                 const int space = area2.left() - area1.right();
 
                 if(space != 0)
@@ -1839,78 +2066,70 @@ WordsWithCharacters addNecessarySpace(RegionTextList tree, int pageWidth, int pa
 
                     const QString spaceStr(" ");
                     const QRect rect(QPoint(left,top),QPoint(right,bottom));
-                    const NormalizedRect entRect(rect,pageWidth,pageHeight);
-                    TinyTextEntity *ent1 = new TinyTextEntity(spaceStr, entRect);
-                    TinyTextEntity *ent2 = new TinyTextEntity(spaceStr, entRect);
-                    WordWithCharacters word(ent1, QList<TinyTextEntity*>() << ent2);
-
-                    list.insert(k+1, word);
-
-                    // Skip the space
-                    k++;
+                    const NormalizedRect entRect(rect,layout.pageWidth,layout.pageHeight);
+                    res.append(new TinyTextEntity(spaceStr, entRect));
                 }
             }
         }
-
-        WordsWithCharacters tmpList;
-        for(int i = 0 ; i < sortedLines.length() ; i++)
-        {
-            tmpList += sortedLines.at(i).first;
-        }
-        tmpRegion.setText(tmpList);
     }
 
-    // Step 03
-    WordsWithCharacters tmp;
-    for(int i = 0 ; i < tree.length() ; i++)
-    {
-        tmp += tree.at(i).text();
-    }
-    return tmp;
+    return res;
 }
 
 /**
  * Correct the textOrder, all layout recognition works here
  */
-void TextPagePrivate::correctTextOrder()
+void TextPagePrivate::correctTextOrder( const Page *page )
 {
-    const int pageWidth = m_page->m_page->width();
-    const int pageHeight = m_page->m_page->height();
-
-    TextList characters = m_words;
+    const int pageWidth = page->width();
+    const int pageHeight = page->height();
 
     /**
      * Remove spaces from the text
      */
-    removeSpace(&characters);
+    const TextList characters = removeSpace(m_words);
 
     /**
      * Construct words from characters
      */
-    const QList<WordWithCharacters> wordsWithCharacters = makeWordFromCharacters(characters, pageWidth, pageHeight);
+    const WordsWithCharacters wordsWithCharacters = makeWordFromCharacters(characters, pageWidth, pageHeight);
+    const WordLayout layout(wordsWithCharacters, pageWidth, pageHeight);
 
     /**
      * Make a XY Cut tree for segmentation of the texts
      */
-    const RegionTextList tree = XYCutForBoundingBoxes(wordsWithCharacters, m_page->m_page->boundingBox(), pageWidth, pageHeight);
+    QVector<int> order(wordsWithCharacters.count());
+    for(int i = 0 ; i < order.count() ; ++i)
+        order[i] = i;
+    const RegionTextList tree = XYCutForBoundingBoxes(layout, order, page->boundingBox());
 
     /**
-     * Add spaces to the word
+     * Add spaces to the word and break the words into characters
      */
-    const WordsWithCharacters listWithWordsAndSpaces = addNecessarySpace(tree, pageWidth, pageHeight);
+    const TextList listOfCharacters = addNecessarySpace(layout, order, tree);
 
-    /**
-     * Break the words into characters
-     */
-    TextList listOfCharacters;
-    foreach(const WordWithCharacters &word, listWithWordsAndSpaces)
-    {
+    foreach(const WordWithCharacters &word, wordsWithCharacters)
         delete word.word;
-        listOfCharacters.append(word.characters);
-    }
     setWordList(listOfCharacters);
 }
 
+void TextPagePrivate::ensureTextOrder()
+{
+    if ( m_page )
+        ensureTextOrder( m_page->m_page );
+}
+
+void TextPagePrivate::ensureTextOrder( const Page *page )
+{
+    if ( m_textOrderCorrected )
+        return;
+
+    m_textOrderCorrected = true;
+    correctTextOrder( page );
+    // built here as well, so that the const methods only read the TextPage
+    spatialIndex();
+}
+
 TextEntity::List TextPage::words(const RegularAreaRect *area, TextAreaInclusionBehaviour b) const
 {
     if ( area && area->isNull() )
@@ -1919,8 +2138,9 @@ TextEntity::List TextPage::words(const RegularAreaRect *area, TextAreaInclusionB
     TextEntity::List ret;
     if ( area )
     {
-        foreach (TinyTextEntity *te, d->m_words)
+        foreach ( int i, d->spatialIndex()->entitiesIn( *area ) )
         {
+            const TinyTextEntity *te = d->m_words.at( i );
             if (b == AnyPixelTextAreaInclusionBehaviour)
             {
                 if ( area->intersects( te->area ) )
@@ -1951,13 +2171,12 @@ TextEntity::List TextPage::words(const RegularAreaRect *area, TextAreaInclusionB
 RegularAreaRect * TextPage::wordAt( const NormalizedPoint &p, QString *word ) const
 {
     TextList::ConstIterator itBegin = d->m_words.constBegin(), itEnd = d->m_words.constEnd();
-    TextList::ConstIterator it = itBegin;
     TextList::ConstIterator posIt = itEnd;
-    for ( ; it != itEnd; ++it )
+    foreach ( int i, d->spatialIndex()->entitiesAt( p.x, p.y ) )
     {
-        if ( (*it)->area.contains( p.x, p.y ) )
+        if ( d->m_words.at( i )->area.contains( p.x, p.y ) )
         {
-            posIt = it;
+            posIt = itBegin + i;
             break;
         }
     }
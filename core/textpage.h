@@ -92,6 +92,8 @@ class OKULAR_EXPORT TextPage
     /// @cond PRIVATE
     friend class Page;
     friend class PagePrivate;
+    friend class TextExportThread;
+    friend class TextPageGenerationThread;
     /// @endcond
 
     public:
@@ -141,6 +143,24 @@ class OKULAR_EXPORT TextPage
         RegularAreaRect* findText( int id, const QString &text, SearchDirection direction,
                                    Qt::CaseSensitivity caseSensitivity, const RegularAreaRect *lastRect );
 
+        /**
+         * Returns the bounding rect of the text which matches the following criteria
+         * or 0 if the search is not successful.
+         *
+         * @param id An unique id for this search.
+         * @param text The search text.
+         * @param direction The direction of the search (@ref SearchDirection)
+         * @param caseSensitivity If Qt::CaseSensitive, the search is case sensitive; otherwise
+         *                        the search is case insensitive.
+         * @param lastRect If 0 the search starts at the beginning of the page, otherwise
+         *                 right/below the coordinates of the given rect.
+         * @param options How @p text is matched (@ref SearchOption)
+         * @since 0.17 (KDE 4.11)
+         */
+        RegularAreaRect* findText( int id, const QString &text, SearchDirection direction,
+                                   Qt::CaseSensitivity caseSensitivity, const RegularAreaRect *lastRect,
+                                   SearchOptions options );
+
         /**
          * Text extraction function.
          *
@@ -14,42 +14,89 @@
 #include <QtCore/QList>
 #include <QtCore/QMap>
 #include <QtCore/QPair>
+#include <QtCore/QVector>
 #include <QtGui/QTransform>
 
+#include "global.h"
+
 class SearchPoint;
+class SpatialIndex;
 class TinyTextEntity;
 class RegionText;
 
 namespace Okular
 {
 
+class Page;
 class PagePrivate;
 typedef QList< TinyTextEntity* > TextList;
 
-typedef bool ( *TextComparisonFunction )( const QStringRef & from, const QStringRef & to,
-                                          int *fromLength, int *toLength );
-
 /**
  * A list of RegionText. It keeps a bunch of TextList with their bounding rectangles
  */
 typedef QList<RegionText> RegionTextList;
 
+/**
+ * The text of the page as one normalized string, with the hyphenation
+ * at the end of the lines already removed, and for every character of
+ * the string the index in m_words of the TinyTextEntity it comes from.
+ * It is built once per TextPage and search mode (case folding, diacritics
+ * folding), so that the search runs on plain UTF-16 data and not entity
+ * by entity, and no folding happens at comparison time.
+ */
+struct SearchBuffer
+{
+    int key;
+    QString text;
+    QVector< int > entities;
+};
+
 class TextPagePrivate
 {
     public:
         TextPagePrivate();
         ~TextPagePrivate();
 
+        /**
+         * Searches @p query in the search buffer, for a match starting at or after @p from
+         */
         RegularAreaRect * findTextInternalForward( int searchID, const QString &query,
                                                    Qt::CaseSensitivity caseSensitivity,
-                                                   TextComparisonFunction comparer,
-                                                   const TextList::ConstIterator &start,
-                                                   const TextList::ConstIterator &end );
+                                                   SearchOptions options, int from );
+        /**
+         * Searches @p query in the search buffer, for a match ending at or before @p to
+         * (starting before @p to for regular expressions)
+         */
         RegularAreaRect * findTextInternalBackward( int searchID, const QString &query,
                                                     Qt::CaseSensitivity caseSensitivity,
-                                                    TextComparisonFunction comparer,
-                                                    const TextList::ConstIterator &start,
-                                                    const TextList::ConstIterator &end );
+                                                    SearchOptions options, int to );
+
+        /**
+         * Returns the search buffer for @p caseSensitivity, and with accents and
+         * ligatures folded if @p ignoreDiacritics, building it if needed
+         */
+        const SearchBuffer * searchBuffer( Qt::CaseSensitivity caseSensitivity, bool ignoreDiacritics );
+
+        /**
+         * Drops the search buffers, to be called whenever m_words changes
+         */
+        void invalidateSearchBuffers();
+
+        /**
+         * Returns the spatial index of m_words, building it if needed
+         */
+        const SpatialIndex * spatialIndex();
+
+        /**
+         * Drops the spatial index, to be called whenever m_words changes
+         */
+        void invalidateSpatialIndex();
+
+        /**
+         * Records the match [@p begin, @p end) of @p buffer as the search point of
+         * @p searchID and returns its area
+         */
+        RegularAreaRect * searchMatch( int searchID, const SearchBuffer *buffer, int begin, int end );
 
         /**
          * Copy a TextList to m_words, the pointers of list are adopted
@@ -60,12 +107,27 @@ class TextPagePrivate
          * Make necessary modifications in the TextList to make the text order correct, so
          * that textselection works fine
          */
-        void correctTextOrder();
+        void correctTextOrder( const Page *page );
+
+        /**
+         * Corrects the text order if it was not done yet. It is done once, by
+         * the thread which created the TextPage, before the TextPage is shared
+         */
+        void ensureTextOrder();
+
+        /**
+         * Corrects the text order if it was not done yet, laying out the text
+         * on @p page, for the TextPages that are not set on a page yet
+         */
+        void ensureTextOrder( const Page *page );
 
         // variables those can be accessed directly from TextPage
         TextList m_words;
         QMap< int, SearchPoint* > m_searchPoints;
+        QMap< int, SearchBuffer* > m_searchBuffers;
+        SpatialIndex *m_spatialIndex;
         PagePrivate *m_page;
+        bool m_textOrderCorrected;
 };
 
 }
@@ -11,7 +11,13 @@
 #include "utils.h"
 #include "utils_p.h"
 
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
 #include <QtCore/QRect>
+#include <QtCore/QStringList>
 #include <QApplication>
 #include <QDesktopWidget>
 #include <QImage>
@@ -247,6 +253,39 @@ got_bottom:
     return bbox;
 }
 
+QString Utils::fileFingerprint( const QString &fileName )
+{
+    QFile file( fileName );
+    if ( !file.open( QIODevice::ReadOnly ) )
+        return QString();
+
+    // the same content gives the same fingerprint wherever the file is, and
+    // a rewrite that keeps the size and both ends still gives a new one
+    static const qint64 chunkSize = 64 * 1024;
+    QCryptographicHash hash( QCryptographicHash::Sha1 );
+    hash.addData( QByteArray::number( file.size() ) );
+    hash.addData( QFileInfo( fileName ).lastModified().toString( Qt::ISODate ).toLatin1() );
+    hash.addData( file.read( chunkSize ) );
+    if ( file.size() > chunkSize && file.seek( qMax( chunkSize, file.size() - chunkSize ) ) )
+        hash.addData( file.read( chunkSize ) );
+    return hash.result().toHex();
+}
+
+void Utils::pruneCacheDirectory( const QString &dirName, qint64 maxSize, const QStringList &nameFilters )
+{
+    const QDir dir( dirName );
+    const QFileInfoList files = dir.entryInfoList( nameFilters, QDir::Files, QDir::Time );
+    qint64 size = 0;
+    foreach ( const QFileInfo &file, files )
+    {
+        if ( file.fileName().endsWith( QLatin1String( ".part" ) ) )
+            continue;
+        size += file.size();
+        if ( size > maxSize )
+            QFile::remove( file.absoluteFilePath() );
+    }
+}
+
 void Okular::copyQIODevice( QIODevice *from, QIODevice *to )
 {
     QByteArray buffer( 65536, '\0' );
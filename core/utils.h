@@ -15,6 +15,8 @@
 
 class QRect;
 class QImage;
+class QString;
+class QStringList;
 
 namespace Okular
 {
@@ -70,6 +72,25 @@ class OKULAR_EXPORT Utils
      * @since 0.7 (KDE 4.1)
      */
     static NormalizedRect imageBoundingBox( const QImage* image );
+
+    /**
+     * Returns a fingerprint of the file @p fileName, made of its size, its
+     * last modification time and its first and last 64 KiB, suitable to
+     * key a disk cache of the file; an empty string if the file cannot be
+     * read.
+     *
+     * @since 0.17 (KDE 4.11)
+     */
+    static QString fileFingerprint( const QString &fileName );
+
+    /**
+     * Removes the least recently written files of the directory @p dirName
+     * matching @p nameFilters (all the files if empty) above @p maxSize
+     * bytes. The ".part" files being written are left alone.
+     *
+     * @since 0.17 (KDE 4.11)
+     */
+    static void pruneCacheDirectory( const QString &dirName, qint64 maxSize, const QStringList &nameFilters );
 };
 
 }
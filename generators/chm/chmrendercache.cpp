@@ -0,0 +1,238 @@
+/***************************************************************************
+ *   Copyright (C) 2013 by Albert Astals Cid <aacid@kde.org>               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "chmrendercache.h"
+
+#include <QtCore/QDataStream>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QtConcurrentRun>
+
+#include <kdebug.h>
+#include <kstandarddirs.h>
+
+#include <core/utils.h>
+
+static const char cacheDirName[] = "okular/chm/";
+static const quint32 cacheMagic = 0x4f4b4348;
+static const quint32 cacheVersion = 1;
+
+// the images kept in memory, and the images and layout data on disk for
+// all the documents
+static const int memoryCacheSize = 32 * 1024 * 1024;
+static const qint64 diskCacheSize = 64 * 1024 * 1024;
+
+QDataStream & operator<<( QDataStream &stream, const CHMTextBox &box )
+{
+    return stream << box.text << box.rect;
+}
+
+QDataStream & operator>>( QDataStream &stream, CHMTextBox &box )
+{
+    return stream >> box.text >> box.rect;
+}
+
+QDataStream & operator<<( QDataStream &stream, const CHMPageData &page )
+{
+    stream << page.size << page.contentsKnown;
+    if ( page.contentsKnown )
+        stream << page.text << page.links << page.images;
+    return stream;
+}
+
+QDataStream & operator>>( QDataStream &stream, CHMPageData &page )
+{
+    stream >> page.size >> page.contentsKnown;
+    if ( page.contentsKnown )
+        stream >> page.text >> page.links >> page.images;
+    return stream;
+}
+
+// remove the least recently written files above the size limit
+static void pruneCache( const QString &fileName )
+{
+    Okular::Utils::pruneCacheDirectory( QFileInfo( fileName ).absolutePath(), diskCacheSize, QStringList() );
+}
+
+static void writeImage( const QImage &image, const QString &fileName )
+{
+    const QString partFileName = fileName + QLatin1String( ".part" );
+    if ( !image.save( partFileName, "PNG" ) || !QFile::rename( partFileName, fileName ) )
+    {
+        QFile::remove( partFileName );
+        return;
+    }
+
+    pruneCache( fileName );
+}
+
+CHMRenderCache::CHMRenderCache()
+    : m_dirty( false ), m_images( memoryCacheSize )
+{
+}
+
+CHMRenderCache::~CHMRenderCache()
+{
+    close();
+}
+
+void CHMRenderCache::open( const QString &fileName, const QVector< QString > &pageUrls )
+{
+    close();
+
+    m_fingerprint = Okular::Utils::fileFingerprint( fileName );
+    m_pageUrls = pageUrls;
+    m_pages.fill( CHMPageData(), pageUrls.count() );
+    if ( m_fingerprint.isEmpty() )
+        return;
+
+    QFile file( KStandardDirs::locateLocal( "cache", cacheDirName + m_fingerprint ) );
+    if ( !file.open( QIODevice::ReadOnly ) )
+        return;
+
+    QDataStream stream( &file );
+    stream.setVersion( QDataStream::Qt_4_6 );
+    quint32 magic, version;
+    stream >> magic >> version;
+    if ( magic != cacheMagic || version != cacheVersion )
+        return;
+
+    QVector< QString > urls;
+    QVector< CHMPageData > pages;
+    stream >> urls >> pages;
+    if ( stream.status() != QDataStream::Ok || urls != pageUrls || pages.count() != pageUrls.count() )
+    {
+        kDebug() << "Ignoring the invalid cache of" << fileName;
+        return;
+    }
+    m_pages = pages;
+}
+
+void CHMRenderCache::close()
+{
+    save();
+    foreach ( QFuture< void > write, m_writes )
+        write.waitForFinished();
+    m_writes.clear();
+    m_images.clear();
+    m_pages.clear();
+    m_pageUrls.clear();
+    m_fingerprint.clear();
+}
+
+void CHMRenderCache::save()
+{
+    if ( !m_dirty || m_fingerprint.isEmpty() )
+        return;
+    m_dirty = false;
+
+    const QString fileName = KStandardDirs::locateLocal( "cache", cacheDirName + m_fingerprint );
+    QFile file( fileName + QLatin1String( ".part" ) );
+    if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+        return;
+
+    QDataStream stream( &file );
+    stream.setVersion( QDataStream::Qt_4_6 );
+    stream << cacheMagic << cacheVersion << m_pageUrls << m_pages;
+    file.close();
+
+    QFile::remove( fileName );
+    if ( file.error() != QFile::NoError || !file.rename( fileName ) )
+    {
+        file.remove();
+        return;
+    }
+
+    pruneCache( fileName );
+}
+
+const CHMPageData & CHMRenderCache::page( int number ) const
+{
+    return m_pages.at( number );
+}
+
+void CHMRenderCache::setPageSize( int number, const QSize &size )
+{
+    m_pages[ number ].size = size;
+    m_dirty = true;
+}
+
+void CHMRenderCache::setPageContents( int number, const CHMPageData &contents )
+{
+    CHMPageData &page = m_pages[ number ];
+    page.contentsKnown = true;
+    page.text = contents.text;
+    page.links = contents.links;
+    page.images = contents.images;
+    m_dirty = true;
+}
+
+QImage CHMRenderCache::image( int number, const QSize &size )
+{
+    if ( m_fingerprint.isEmpty() )
+        return QImage();
+
+    const QString fileName = imageFileName( number, size );
+    if ( QImage *image = m_images.object( fileName ) )
+        return *image;
+
+    QImage image( fileName );
+    if ( image.size() != size )
+        return QImage();
+
+    m_images.insert( fileName, new QImage( image ), qMin( image.byteCount(), m_images.maxCost() ) );
+    return image;
+}
+
+bool CHMRenderCache::hasImage( int number, const QSize &size ) const
+{
+    if ( m_fingerprint.isEmpty() )
+        return false;
+
+    const QString fileName = imageFileName( number, size );
+    return m_images.contains( fileName ) || QFile::exists( fileName );
+}
+
+void CHMRenderCache::insertImage( int number, const QImage &image )
+{
+    if ( m_fingerprint.isEmpty() )
+        return;
+
+    const QString fileName = imageFileName( number, image.size() );
+    m_images.insert( fileName, new QImage( image ), qMin( image.byteCount(), m_images.maxCost() ) );
+    QList< QFuture< void > >::iterator it = m_writes.begin();
+    while ( it != m_writes.end() )
+    {
+        if ( it->isFinished() )
+            it = m_writes.erase( it );
+        else
+            ++it;
+    }
+    m_writes.append( QtConcurrent::run( writeImage, image, fileName ) );
+}
+
+qulonglong CHMRenderCache::memory() const
+{
+    return m_images.totalCost();
+}
+
+qulonglong CHMRenderCache::freeMemory( qulonglong memory )
+{
+    // lowering the maximum cost drops the least recently used images
+    const int used = m_images.totalCost();
+    m_images.setMaxCost( qMax( 0, used - (int)qMin( memory, (qulonglong)used ) ) );
+    m_images.setMaxCost( memoryCacheSize );
+    return used - m_images.totalCost();
+}
+
+QString CHMRenderCache::imageFileName( int number, const QSize &size ) const
+{
+    return KStandardDirs::locateLocal( "cache", cacheDirName ) +
+           QString( "%1-%2-%3x%4.png" ).arg( m_fingerprint ).arg( number ).arg( size.width() ).arg( size.height() );
+}
@@ -0,0 +1,132 @@
+/***************************************************************************
+ *   Copyright (C) 2013 by Albert Astals Cid <aacid@kde.org>               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef _OKULAR_GENERATOR_CHM_RENDERCACHE_H_
+#define _OKULAR_GENERATOR_CHM_RENDERCACHE_H_
+
+#include <QtCore/QCache>
+#include <QtCore/QFuture>
+#include <QtCore/QList>
+#include <QtCore/QPair>
+#include <QtCore/QRectF>
+#include <QtCore/QSize>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+#include <QtGui/QImage>
+
+/**
+ * A piece of text of a page, with its rectangle normalized to the page size.
+ */
+struct CHMTextBox
+{
+    QString text;
+    QRectF rect;
+};
+
+/**
+ * What the generator learns about a page by laying it out.
+ */
+class CHMPageData
+{
+    public:
+        CHMPageData() : contentsKnown( false ) {}
+
+        // the size of the page at 100% zoom, invalid if not known yet
+        QSize size;
+
+        // whether the fields below were filled
+        bool contentsKnown;
+        // the rectangles are normalized to the page size
+        QVector< CHMTextBox > text;
+        QVector< QPair< QString, QRectF > > links;
+        QVector< QRectF > images;
+};
+
+/**
+ * The rendered pages and the layout data of a CHM document.
+ *
+ * Laying out a page with KHTML happens in the GUI thread and takes time,
+ * so the results are kept: the layout data of all the pages and the
+ * rendered images are stored on disk, keyed by a fingerprint of the
+ * file, and the recently rendered images are also kept in memory. Both
+ * kinds of files count in the size limit of the disk cache.
+ *
+ * The cache is used from the GUI thread only; the images are written to
+ * disk in the background.
+ */
+class CHMRenderCache
+{
+    public:
+        CHMRenderCache();
+        ~CHMRenderCache();
+
+        /**
+         * Opens the cache of the file @p fileName, whose pages have the
+         * given urls, loading the layout data stored for it if any.
+         */
+        void open( const QString &fileName, const QVector< QString > &pageUrls );
+
+        /**
+         * Saves the layout data if it changed, and forgets the document.
+         */
+        void close();
+
+        /**
+         * Writes the layout data to disk if it changed.
+         */
+        void save();
+
+        /**
+         * Returns the layout data of the page @p number.
+         */
+        const CHMPageData & page( int number ) const;
+
+        void setPageSize( int number, const QSize &size );
+        void setPageContents( int number, const CHMPageData &contents );
+
+        /**
+         * Returns the image of the page @p number rendered at @p size,
+         * or a null image if it is not cached.
+         */
+        QImage image( int number, const QSize &size );
+
+        /**
+         * Returns whether the image of the page @p number rendered at
+         * @p size is cached, without loading it.
+         */
+        bool hasImage( int number, const QSize &size ) const;
+
+        /**
+         * Stores the image of the page @p number.
+         */
+        void insertImage( int number, const QImage &image );
+
+        /**
+         * The memory used by the images kept in memory, and how to free it.
+         */
+        qulonglong memory() const;
+        qulonglong freeMemory( qulonglong memory );
+
+    private:
+        Q_DISABLE_COPY( CHMRenderCache )
+
+        QString imageFileName( int number, const QSize &size ) const;
+
+        QString m_fingerprint;
+        QVector< QString > m_pageUrls;
+        QVector< CHMPageData > m_pages;
+        bool m_dirty;
+
+        // keyed by imageFileName(), the cost is the size in bytes
+        QCache< QString, QImage > m_images;
+        // the images being written to disk
+        QList< QFuture< void > > m_writes;
+};
+
+#endif
@@ -11,6 +11,7 @@
 #include "generator_chm.h"
 
 #include <QtCore/QEventLoop>
+#include <QtCore/QHash>
 #include <QtCore/QMutex>
 #include <QtGui/QPainter>
 #include <QtXml/QDomElement>
@@ -64,6 +65,35 @@ static QString absolutePath( const QString &baseUrl, const QString &path )
     return absPath;
 }
 
+static QRectF normalizedRect( const QRect &rect, int width, int height )
+{
+    const Okular::NormalizedRect r( rect, width, height );
+    return QRectF( QPointF( r.left, r.top ), QPointF( r.right, r.bottom ) );
+}
+
+static Okular::TextPage* createTextPage( const QVector<CHMTextBox> &text )
+{
+    Okular::TextPage *tp = new Okular::TextPage();
+    foreach ( const CHMTextBox &box, text )
+        tp->append( box.text, new Okular::NormalizedRect( box.rect.left(), box.rect.top(), box.rect.right(), box.rect.bottom() ) );
+    return tp;
+}
+
+static QImage paintPage( KHTMLPart *part, const QSize &size )
+{
+    QImage image( size, QImage::Format_ARGB32 );
+    image.fill( qRgb( 255, 255, 255 ) );
+
+    QPainter p( &image );
+    QRect r( QPoint( 0, 0 ), size );
+
+    bool moreToPaint;
+    part->paint( &p, r, 0, &moreToPaint );
+
+    p.end();
+    return image;
+}
+
 CHMGenerator::CHMGenerator( QObject *parent, const QVariantList &args )
     : Okular::Generator( parent, args )
 {
@@ -74,11 +104,20 @@ CHMGenerator::CHMGenerator( QObject *parent, const QVariantList &args )
     m_docInfo=0;
     m_pixmapRequestZoom=1;
     m_request = 0;
+
+    m_prefetchGen = 0;
+    m_prefetchScale = 1;
+    m_prefetchPage = -1;
+    // leave some time to the requests following the last one
+    m_prefetchTimer.setSingleShot( true );
+    m_prefetchTimer.setInterval( 100 );
+    connect( &m_prefetchTimer, SIGNAL(timeout()), this, SLOT(prefetchNextPage()) );
 }
 
 CHMGenerator::~CHMGenerator()
 {
     delete m_syncGen;
+    delete m_prefetchGen;
 }
 
 bool CHMGenerator::loadDocument( const QString & fileName, QVector< Okular::Page * > & pagesVector )
@@ -138,8 +177,8 @@ bool CHMGenerator::loadDocument( const QString & fileName, QVector< Okular::Page
     }
 
     pagesVector.resize(m_pageUrl.count());
-    m_textpageAddedList.fill(false, pagesVector.count());
     m_rectsGenerated.fill(false, pagesVector.count());
+    m_cache.open(fileName, m_pageUrl);
 
     if (!m_syncGen)
     {
@@ -147,16 +186,30 @@ bool CHMGenerator::loadDocument( const QString & fileName, QVector< Okular::Page
     }
     disconnect( m_syncGen, 0, this, 0 );
 
+    // laying out every page takes long, so the sizes are cached
     for (int i = 0; i < m_pageUrl.count(); ++i)
     {
-        preparePageForSyncOperation(100, m_pageUrl.at(i));
-        pagesVector[ i ] = new Okular::Page (i, m_syncGen->view()->contentsWidth(),
-            m_syncGen->view()->contentsHeight(), Okular::Rotation0 );
+        QSize size = m_cache.page(i).size;
+        if (!size.isValid())
+        {
+            preparePageForSyncOperation(100, m_pageUrl.at(i));
+            size = QSize(m_syncGen->view()->contentsWidth(), m_syncGen->view()->contentsHeight());
+            m_cache.setPageSize(i, size);
+        }
+        pagesVector[ i ] = new Okular::Page (i, size.width(), size.height(), Okular::Rotation0 );
     }
+    m_cache.save();
 
     connect( m_syncGen, SIGNAL(completed()), this, SLOT(slotCompleted()) );
     connect( m_syncGen, SIGNAL(canceled(QString)), this, SLOT(slotCompleted()) );
 
+    if (!m_prefetchGen)
+    {
+        m_prefetchGen = new KHTMLPart();
+        connect( m_prefetchGen, SIGNAL(completed()), this, SLOT(slotPrefetchCompleted()) );
+        connect( m_prefetchGen, SIGNAL(canceled(QString)), this, SLOT(slotPrefetchCompleted()) );
+    }
+
     return true;
 }
 
@@ -167,7 +220,10 @@ bool CHMGenerator::doCloseDocument()
     m_docInfo=0;
     delete m_file;
     m_file=0;
-    m_textpageAddedList.clear();
+    m_prefetchTimer.stop();
+    m_prefetchQueue.clear();
+    cancelPrefetch();
+    m_cache.close();
     m_rectsGenerated.clear();
     m_urlPage.clear();
     m_pageUrl.clear();
@@ -183,7 +239,6 @@ bool CHMGenerator::doCloseDocument()
 void CHMGenerator::preparePageForSyncOperation( int zoom , const QString & url)
 {
     KUrl pAddress= QString("ms-its:" + m_fileName + "::" + url);
-    m_chmUrl = url;
     m_syncGen->setZoomFactor(zoom);
     m_syncGen->openUrl(pAddress);
     m_syncGen->view()->layout();
@@ -201,37 +256,116 @@ void CHMGenerator::slotCompleted()
     if ( !m_request )
         return;
 
-    QImage image( m_request->width(), m_request->height(), QImage::Format_ARGB32 );
-    image.fill( qRgb( 255, 255, 255 ) );
-
-    QPainter p( &image );
-    QRect r( 0, 0, m_request->width(), m_request->height() );
-
-    bool moreToPaint;
-    m_syncGen->paint( &p, r, 0, &moreToPaint );
-
-    p.end();
+    const QImage image = paintPage( m_syncGen, QSize( m_request->width(), m_request->height() ) );
 
     if ( m_pixmapRequestZoom > 1 )
         m_pixmapRequestZoom = 1;
 
-    if ( !m_textpageAddedList.at( m_request->pageNumber() ) ) {
-        additionalRequestData();
-        m_textpageAddedList[ m_request->pageNumber() ] = true;
-    }
+    const int pageNumber = m_request->pageNumber();
+    if ( !m_cache.page( pageNumber ).contentsKnown )
+        extractPageContents( m_syncGen, pageNumber );
+    m_cache.insertImage( pageNumber, image );
 
     m_syncGen->closeUrl();
-    m_chmUrl = QString();
 
     userMutex()->unlock();
 
     Okular::PixmapRequest *req = m_request;
     m_request = 0;
 
-    if ( !req->page()->isBoundingBoxKnown() )
-        updatePageBoundingBox( req->page()->number(), Okular::Utils::imageBoundingBox( &image ) );
-    req->page()->setPixmap( req->observer(), new QPixmap( QPixmap::fromImage( image ) ) );
-    signalPixmapRequestDone( req );
+    // the pages following a page shown are likely to be asked next,
+    // thumbnails are not worth it
+    if ( req->width() >= 300 )
+    {
+        m_prefetchQueue.clear();
+        for ( int i = pageNumber + 1; i <= pageNumber + 2 && i < m_pageUrl.count(); ++i )
+            m_prefetchQueue.append( i );
+        m_prefetchScale = req->width() / req->page()->width();
+    }
+    if ( !m_prefetchQueue.isEmpty() )
+        m_prefetchTimer.start();
+
+    pixmapRequestDone( req, image );
+}
+
+void CHMGenerator::pixmapRequestDone( Okular::PixmapRequest *request, const QImage &image )
+{
+    applyPageContents( request->page() );
+
+    if ( !request->page()->isBoundingBoxKnown() )
+        updatePageBoundingBox( request->page()->number(), Okular::Utils::imageBoundingBox( &image ) );
+    request->page()->setPixmap( request->observer(), new QPixmap( QPixmap::fromImage( image ) ) );
+    signalPixmapRequestDone( request );
+}
+
+void CHMGenerator::prefetchNextPage()
+{
+    // the requests have priority, slotCompleted() starts again
+    if ( m_request || m_prefetchPage >= 0 || !m_prefetchGen )
+        return;
+
+    while ( !m_prefetchQueue.isEmpty() )
+    {
+        const int pageNumber = m_prefetchQueue.takeFirst();
+        const QSize pageSize = m_cache.page( pageNumber ).size;
+        const int width = qRound( m_prefetchScale * pageSize.width() );
+        if ( width <= 0 )
+            continue;
+
+        // the size the page view asks for, at the same scale
+        const QSize size( width, (int)( (double)pageSize.height() / pageSize.width() * width ) );
+        if ( m_cache.page( pageNumber ).contentsKnown && m_cache.hasImage( pageNumber, size ) )
+            continue;
+
+        m_prefetchPage = pageNumber;
+        m_prefetchSize = size;
+        openPage( m_prefetchGen, pageNumber, zoomFactor( pageSize, size.width(), size.height() ), size.width(), size.height() );
+        return;
+    }
+}
+
+void CHMGenerator::slotPrefetchCompleted()
+{
+    if ( m_prefetchPage < 0 )
+        return;
+
+    const int pageNumber = m_prefetchPage;
+    m_prefetchPage = -1;
+
+    const QImage image = paintPage( m_prefetchGen, m_prefetchSize );
+    if ( !m_cache.page( pageNumber ).contentsKnown )
+        extractPageContents( m_prefetchGen, pageNumber );
+    m_cache.insertImage( pageNumber, image );
+
+    m_prefetchGen->closeUrl();
+
+    if ( !m_prefetchQueue.isEmpty() )
+        m_prefetchTimer.start();
+}
+
+void CHMGenerator::cancelPrefetch()
+{
+    if ( m_prefetchPage < 0 )
+        return;
+
+    m_prefetchPage = -1;
+    m_prefetchGen->closeUrl();
+}
+
+int CHMGenerator::zoomFactor( const QSizeF &pageSize, int width, int height ) const
+{
+    return qRound( qMax( static_cast<double>(width)/pageSize.width()
+        , static_cast<double>(height)/pageSize.height()
+        ) ) * 100;
+}
+
+void CHMGenerator::openPage( KHTMLPart *part, int pageNumber, int zoom, int width, int height )
+{
+    KUrl pAddress= QString("ms-its:" + m_fileName + "::" + m_pageUrl[pageNumber]);
+    part->setZoomFactor(zoom);
+    part->view()->resize(width,height);
+    // will emit openURL without problems
+    part->openUrl ( pAddress );
 }
 
 const Okular::DocumentInfo * CHMGenerator::generateDocumentInfo() 
@@ -251,6 +385,50 @@ const Okular::DocumentSynopsis * CHMGenerator::generateDocumentSynopsis()
     return &m_docSyn;
 }
 
+qulonglong CHMGenerator::cacheMemory() const
+{
+    return m_cache.memory();
+}
+
+qulonglong CHMGenerator::freeCacheMemory( qulonglong memory )
+{
+    return m_cache.freeMemory( memory );
+}
+
+QBitArray CHMGenerator::searchCandidatePages( const QString &text, Okular::SearchOptions options )
+{
+    // the index can only tell which pages contain some plain words
+    if ( !m_file || ( options & Okular::RegularExpressionSearch ) )
+        return QBitArray();
+
+    QStringList found, indexed;
+    if ( !m_file->findTopicsContaining( text, &found, &indexed ) )
+        return QBitArray();
+
+    // the urls of the index and of the archive may differ in case
+    QHash<QString, int> urlPage;
+    for ( int i = 0; i < m_pageUrl.count(); ++i )
+        urlPage.insert( m_pageUrl.at( i ).toLower(), i );
+
+    // the pages missing from the index have to be searched anyway
+    QBitArray pages( m_pageUrl.count(), true );
+    foreach ( const QString &url, indexed )
+    {
+        const int pos = url.indexOf( '#' );
+        const int page = urlPage.value( ( pos == -1 ? url : url.left( pos ) ).toLower(), -1 );
+        if ( page != -1 )
+            pages.clearBit( page );
+    }
+    foreach ( const QString &url, found )
+    {
+        const int pos = url.indexOf( '#' );
+        const int page = urlPage.value( ( pos == -1 ? url : url.left( pos ) ).toLower(), -1 );
+        if ( page != -1 )
+            pages.setBit( page );
+    }
+    return pages;
+}
+
 bool CHMGenerator::canGeneratePixmap () const
 {
     bool isLocked = true;
@@ -264,6 +442,21 @@ bool CHMGenerator::canGeneratePixmap () const
 
 void CHMGenerator::generatePixmap( Okular::PixmapRequest * request ) 
 {
+    // the pages rendered before, or prefetched, need no layout
+    const int pageNumber = request->pageNumber();
+    if ( m_cache.page( pageNumber ).contentsKnown )
+    {
+        const QImage image = m_cache.image( pageNumber, QSize( request->width(), request->height() ) );
+        if ( !image.isNull() )
+        {
+            pixmapRequestDone( request, image );
+            return;
+        }
+    }
+
+    // the page asked has priority over the prefetched ones
+    cancelPrefetch();
+
     int requestWidth = request->width();
     int requestHeight = request->height();
     if (requestWidth<300)
@@ -274,32 +467,22 @@ void CHMGenerator::generatePixmap( Okular::PixmapRequest * request )
     }
 
     userMutex()->lock();
-    QString url= m_pageUrl[request->pageNumber()];
-    int zoom = qRound( qMax( static_cast<double>(requestWidth)/static_cast<double>(request->page()->width())
-        , static_cast<double>(requestHeight)/static_cast<double>(request->page()->height())
-        ) ) * 100;
+    int zoom = zoomFactor( QSizeF( request->page()->width(), request->page()->height() ), requestWidth, requestHeight );
 
-    KUrl pAddress= QString("ms-its:" + m_fileName + "::" + url);
-    m_chmUrl = url;
-    m_syncGen->setZoomFactor(zoom);
-    m_syncGen->view()->resize(requestWidth,requestHeight);
     m_request=request;
-    // will emit openURL without problems
-    m_syncGen->openUrl ( pAddress );
+    openPage( m_syncGen, pageNumber, zoom, requestWidth, requestHeight );
 }
 
 
-void CHMGenerator::recursiveExploreNodes(DOM::Node node,Okular::TextPage *tp)
+void CHMGenerator::recursiveExploreNodes(DOM::Node node, int vWidth, int vHeight, QVector<CHMTextBox> *text)
 {
     if (node.nodeType() == DOM::Node::TEXT_NODE && !node.getRect().isNull())
     {
         QString nodeText=node.nodeValue().string();
         QRect r=node.getRect();
-        int vWidth=m_syncGen->view()->width();
-        int vHeight=m_syncGen->view()->height();
-        Okular::NormalizedRect *nodeNormRect;
 #define NOEXP
 #ifndef NOEXP
+        Okular::NormalizedRect *nodeNormRect;
         int x,y,height;
         int x_next,y_next,height_next;
         int nodeTextLength = nodeText.length();
@@ -333,113 +516,127 @@ void CHMGenerator::recursiveExploreNodes(DOM::Node node,Okular::TextPage *tp)
             }
         }
 #else
-        nodeNormRect=new Okular::NormalizedRect (r,vWidth,vHeight);
-        tp->append(nodeText,nodeNormRect/*,0*/);
+        CHMTextBox box;
+        box.text = nodeText;
+        box.rect = normalizedRect(r,vWidth,vHeight);
+        text->append(box);
 #endif
     }
     DOM::Node child = node.firstChild();
     while ( !child.isNull() )
     {
-        recursiveExploreNodes(child,tp);
+        recursiveExploreNodes(child,vWidth,vHeight,text);
         child = child.nextSibling();
     }
 }
 
-void CHMGenerator::additionalRequestData() 
+void CHMGenerator::extractPageContents( KHTMLPart *part, int pageNumber )
 {
-    Okular::Page * page=m_request->page();
-    const bool genObjectRects = !m_rectsGenerated.at( m_request->page()->number() );
-    const bool genTextPage = !m_request->page()->hasTextPage() && genObjectRects;
-
-    if (genObjectRects || genTextPage )
+    CHMPageData contents;
+    DOM::HTMLDocument domDoc=part->htmlDocument();
+    int xScale=part->view()->width();
+    int yScale=part->view()->height();
+    // getting links
+    DOM::HTMLCollection coll=domDoc.links();
+    DOM::Node n;
+    if (! coll.isNull() )
     {
-        DOM::HTMLDocument domDoc=m_syncGen->htmlDocument();
-        // only generate object info when generating a full page not a thumbnail
-        if ( genObjectRects )
+        int size=coll.length();
+        for(int i=0;i<size;i++)
         {
-            QLinkedList< Okular::ObjectRect * > objRects;
-            int xScale=m_syncGen->view()->width();
-            int yScale=m_syncGen->view()->height();
-            // getting links
-            DOM::HTMLCollection coll=domDoc.links();
-            DOM::Node n;
-            QRect r;
-            if (! coll.isNull() )
+            n=coll.item(i);
+            if ( !n.isNull() )
             {
-                int size=coll.length();
-                for(int i=0;i<size;i++)
-                {
-                    n=coll.item(i);
-                    if ( !n.isNull() )
-                    {
-                        QString url = n.attributes().getNamedItem("href").nodeValue().string();
-                        r=n.getRect();
-                        // there is no way for us to support javascript properly
-                        if (url.startsWith("JavaScript:"), Qt::CaseInsensitive)
-                            continue;
-                        else if (url.contains (":"))
-                        {
-                            objRects.push_back(
-                                new Okular::ObjectRect ( Okular::NormalizedRect(r,xScale,yScale),
-                                false,
-                                Okular::ObjectRect::Action,
-                                new Okular::BrowseAction ( url )));
-                        }
-                        else
-                        {
-                            Okular::DocumentViewport viewport( metaData( "NamedViewport", absolutePath( m_chmUrl, url ) ).toString() );
-                            objRects.push_back(
-                                new Okular::ObjectRect ( Okular::NormalizedRect(r,xScale,yScale),
-                                false,
-                                Okular::ObjectRect::Action,
-                                new Okular::GotoAction ( QString::null, viewport)));	//krazy:exclude=nullstrassign for old broken gcc
-                        }
-                    }
-                }
+                QString url = n.attributes().getNamedItem("href").nodeValue().string();
+                // there is no way for us to support javascript properly
+                if (url.startsWith("JavaScript:", Qt::CaseInsensitive))
+                    continue;
+                contents.links.append( qMakePair( url, normalizedRect(n.getRect(),xScale,yScale) ) );
             }
+        }
+    }
+
+    // getting images
+    coll=domDoc.images();
+    if (! coll.isNull() )
+    {
+        int size=coll.length();
+        for(int i=0;i<size;i++)
+        {
+            n=coll.item(i);
+            if ( !n.isNull() )
+                contents.images.append( normalizedRect(n.getRect(),xScale,yScale) );
+        }
+    }
+
+    recursiveExploreNodes(domDoc,xScale,yScale,&contents.text);
+    m_cache.setPageContents( pageNumber, contents );
+}
+
+void CHMGenerator::applyPageContents( Okular::Page *page )
+{
+    const int pageNumber = page->number();
+    const CHMPageData &contents = m_cache.page( pageNumber );
+    if ( !contents.contentsKnown )
+        return;
 
-            // getting images
-            coll=domDoc.images();
-            if (! coll.isNull() )
+    if ( !m_rectsGenerated.at( pageNumber ) )
+    {
+        QLinkedList< Okular::ObjectRect * > objRects;
+        typedef QPair< QString, QRectF > Link;
+        foreach ( const Link &link, contents.links )
+        {
+            const QString &url = link.first;
+            const Okular::NormalizedRect r( link.second.left(), link.second.top(), link.second.right(), link.second.bottom() );
+            if (url.contains (":"))
             {
-                int size=coll.length();
-                for(int i=0;i<size;i++)
-                {
-                    n=coll.item(i);
-                    if ( !n.isNull() )
-                    {
-                        objRects.push_back(
-                                new Okular::ObjectRect ( Okular::NormalizedRect(n.getRect(),xScale,yScale),
-                                false,
-                                Okular::ObjectRect::Image,
-                                0));
-                    }
-                }
+                objRects.push_back(
+                    new Okular::ObjectRect ( r,
+                    false,
+                    Okular::ObjectRect::Action,
+                    new Okular::BrowseAction ( url )));
+            }
+            else
+            {
+                Okular::DocumentViewport viewport( metaData( "NamedViewport", absolutePath( m_pageUrl.at( pageNumber ), url ) ).toString() );
+                objRects.push_back(
+                    new Okular::ObjectRect ( r,
+                    false,
+                    Okular::ObjectRect::Action,
+                    new Okular::GotoAction ( QString::null, viewport)));	//krazy:exclude=nullstrassign for old broken gcc
             }
-            m_request->page()->setObjectRects( objRects );
-            m_rectsGenerated[ m_request->page()->number() ] = true;
         }
 
-        if ( genTextPage )
+        foreach ( const QRectF &image, contents.images )
         {
-            Okular::TextPage *tp=new Okular::TextPage();
-            recursiveExploreNodes(domDoc,tp);
-            page->setTextPage (tp);
+            objRects.push_back(
+                    new Okular::ObjectRect ( Okular::NormalizedRect( image.left(), image.top(), image.right(), image.bottom() ),
+                    false,
+                    Okular::ObjectRect::Image,
+                    0));
         }
+        page->setObjectRects( objRects );
+        m_rectsGenerated[ pageNumber ] = true;
     }
+
+    if ( !page->hasTextPage() )
+        page->setTextPage( createTextPage( contents.text ) );
 }
 
 Okular::TextPage* CHMGenerator::textPage( Okular::Page * page )
 {
-    userMutex()->lock();
-    const int zoom = 100;
-    m_syncGen->view()->resize(page->width(), page->height());
-    
-    preparePageForSyncOperation(zoom, m_pageUrl[page->number()]);
-    Okular::TextPage *tp=new Okular::TextPage();
-    recursiveExploreNodes( m_syncGen->htmlDocument(), tp);
-    userMutex()->unlock();
-    return tp;
+    // the text of the pages laid out before is cached
+    if ( !m_cache.page( page->number() ).contentsKnown )
+    {
+        userMutex()->lock();
+        const int zoom = 100;
+        m_syncGen->view()->resize(page->width(), page->height());
+
+        preparePageForSyncOperation(zoom, m_pageUrl[page->number()]);
+        extractPageContents( m_syncGen, page->number() );
+        userMutex()->unlock();
+    }
+    return createTextPage( m_cache.page( page->number() ).text );
 }
 
 QVariant CHMGenerator::metaData( const QString &key, const QVariant &option ) const
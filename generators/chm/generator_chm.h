@@ -15,8 +15,11 @@
 #include <core/generator.h>
 
 #include "lib/libchmfile.h"
+#include "chmrendercache.h"
 
 #include <qbitarray.h>
+#include <qsize.h>
+#include <qtimer.h>
 
 class KHTMLPart;
 
@@ -51,22 +54,50 @@ class CHMGenerator : public Okular::Generator
         bool doCloseDocument();
         Okular::TextPage* textPage( Okular::Page *page );
 
+    protected slots:
+        qulonglong cacheMemory() const;
+        qulonglong freeCacheMemory( qulonglong memory );
+        QBitArray searchCandidatePages( const QString &text, Okular::SearchOptions options );
+
+    private slots:
+        // lay out and render the next page of m_prefetchQueue, if idle
+        void prefetchNextPage();
+        void slotPrefetchCompleted();
+
     private:
-        void additionalRequestData();
-        void recursiveExploreNodes( DOM::Node node, Okular::TextPage *tp );
+        void pixmapRequestDone( Okular::PixmapRequest *request, const QImage &image );
+        // store the text, links and images of the page laid out in part
+        void extractPageContents( KHTMLPart *part, int pageNumber );
+        // give the page its object rects and text page from the cache
+        void applyPageContents( Okular::Page *page );
+        void recursiveExploreNodes( DOM::Node node, int width, int height, QVector<CHMTextBox> *text );
         void preparePageForSyncOperation( int zoom , const QString &url );
+        int zoomFactor( const QSizeF &pageSize, int width, int height ) const;
+        void openPage( KHTMLPart *part, int pageNumber, int zoom, int width, int height );
+        void cancelPrefetch();
         QMap<QString, int> m_urlPage;
         QVector<QString> m_pageUrl;
         Okular::DocumentSynopsis m_docSyn;
         LCHMFile* m_file;
         KHTMLPart *m_syncGen;
         QString m_fileName;
-        QString m_chmUrl;
         Okular::PixmapRequest* m_request;
         int m_pixmapRequestZoom;
         Okular::DocumentInfo* m_docInfo;
-        QBitArray m_textpageAddedList;
         QBitArray m_rectsGenerated;
+
+        // the rendered pages and layout data, kept across sessions
+        CHMRenderCache m_cache;
+
+        // renders the pages following the last requested one while the
+        // generator is idle, so that they are cached when asked
+        KHTMLPart *m_prefetchGen;
+        QList<int> m_prefetchQueue;
+        // the scale of the last request, and the size of m_prefetchPage
+        double m_prefetchScale;
+        QSize m_prefetchSize;
+        int m_prefetchPage;
+        QTimer m_prefetchTimer;
 };
 
 #endif
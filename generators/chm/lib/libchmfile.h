@@ -261,6 +261,20 @@ class LCHMFile
 		 * \ingroup search
 		 */
 		bool	searchQuery ( const QString& query, QStringList * results, unsigned int limit = 100 );
+
+		/*!
+		 * \brief Finds the topics which may contain a text, using the search index.
+		 * \param text The text to look for.
+		 * \param results An array to store the URLs of the indexed topics which may contain the text.
+		 * \param indexed An array to store the URLs of all the indexed topics. The topics which are
+		 *        not in the index may contain the text as well.
+		 * \return true if the search index could be used for this text; false otherwise.
+		 *
+		 * Unlike searchQuery(), this looks for parts of the indexed words, ignoring case and accents,
+		 * so that the results include every indexed topic where a plain text search could match.
+		 * \ingroup search
+		 */
+		bool	findTopicsContaining ( const QString& text, QStringList * results, QStringList * indexed );
 		
 		//! Access to implementation
 		LCHMFileImpl * impl()	{ return m_impl; }
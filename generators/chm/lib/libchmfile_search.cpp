@@ -287,3 +287,44 @@ bool LCHMFile::searchQuery( const QString& inquery, QStringList * searchresults,
 	m_impl->getSearchResults( results, searchresults, limit );
 	return true;
 }
+
+
+bool LCHMFile::findTopicsContaining( const QString& text, QStringList * results, QStringList * indexed )
+{
+	// The index stores the words lowercase and without accents, and how it splits the text
+	// into words is not known. Only look for the runs of plain latin letters, which are parts
+	// of the indexed words whatever the text around them is.
+	QList<QByteArray> words;
+	QByteArray word;
+	
+	for ( int i = 0; i <= text.length(); i++ )
+	{
+		ushort ch = i < text.length() ? text[i].toLower().unicode() : 0;
+		
+		if ( ch >= 'a' && ch <= 'z' )
+			word.append( (char) ch );
+		else if ( !word.isEmpty() )
+		{
+			if ( !words.contains( word ) )
+				words.push_back( word );
+			
+			word.clear();
+		}
+	}
+	
+	QBitArray topics;
+	
+	if ( !m_impl->searchTopicsContaining( words, &topics ) )
+		return false;
+	
+	results->clear();
+	
+	for ( int i = 0; i < topics.size(); i++ )
+	{
+		if ( topics.testBit( i ) )
+			results->push_back( m_impl->m_topicUrls[i] );
+	}
+	
+	*indexed = m_impl->m_topicUrls;
+	return true;
+}
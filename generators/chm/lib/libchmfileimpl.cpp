@@ -27,6 +27,7 @@
 #include <QApplication>
 #include <QByteArray>
 #include <QPixmap>
+#include <QSet>
 #include <QVector>
 
 #include "chm_lib.h"
@@ -63,6 +64,9 @@ LCHMFileImpl::LCHMFileImpl( )
 	m_textCodecForSpecialFiles = 0;
 	m_detectedLCID = 0;
 	m_currentEncoding = 0;
+	m_searchIndexLoaded = false;
+	m_searchIndexValid = false;
+	m_searchTopicsCache.setMaxCost( 64 );
 }
 
 
@@ -147,6 +151,13 @@ void LCHMFileImpl::closeAll( )
 	m_home.clear();
 	m_topicsFile.clear();
 	m_indexFile.clear();
+
+	m_url2topics.clear();
+	m_topicUrls.clear();
+	m_searchIndexLoaded = false;
+	m_searchIndexValid = false;
+	m_searchIndexWords.clear();
+	m_searchTopicsCache.clear();
 	
 	m_entityDecodeMap.clear();
 	m_textCodec = 0;
@@ -679,6 +690,171 @@ inline bool LCHMFileImpl::ProcessWLC (uint64_t wlc_count, uint64_t wlc_size,
 }
 
 
+bool LCHMFileImpl::loadSearchIndexWords()
+{
+	if ( m_searchIndexLoaded )
+		return m_searchIndexValid;
+
+	m_searchIndexLoaded = true;
+
+	if ( !m_searchAvailable )
+		return false;
+
+	unsigned char header[FTS_HEADER_LEN];
+
+	if ( RetrieveObject (&m_chmFIftiMain, header, 0, FTS_HEADER_LEN) == 0 )
+		return false;
+
+	for ( int i = 0; i < 3; i++ )
+	{
+		m_searchIndexScales[i] = header[0x1E + i * 2];
+		m_searchIndexRoots[i] = header[0x1F + i * 2];
+
+		// Same limitation as searchWord()
+		if ( m_searchIndexScales[i] != 2 )
+			return false;
+	}
+
+	unsigned char* cursor32 = header + 0x14;
+	uint32_t node_offset = UINT32ARRAY(cursor32);
+
+	cursor32 = header + 0x2e;
+	uint32_t node_len = UINT32ARRAY(cursor32);
+
+	unsigned char* cursor16 = header + 0x18;
+	uint16_t tree_depth = UINT16ARRAY(cursor16);
+
+	// An empty text is before any word, so this is the first leaf node
+	node_offset = GetLeafNodeOffset (QString(), node_offset, node_len, tree_depth);
+
+	QVector<unsigned char> buffer(node_len);
+	QByteArray word;
+	QSet<uint32_t> visited;
+
+	// The leaf nodes are chained, each starting with the offset of the next one
+	while ( node_offset && !visited.contains (node_offset) )
+	{
+		visited.insert (node_offset);
+
+		if ( RetrieveObject (&m_chmFIftiMain, buffer.data(), node_offset, node_len) == 0 )
+		{
+			m_searchIndexWords.clear();
+			return false;
+		}
+
+		cursor16 = buffer.data() + 6;
+		uint16_t free_space = UINT16ARRAY(cursor16);
+
+		uint32_t i = sizeof(uint32_t) + sizeof(uint16_t) + sizeof(uint16_t);
+
+		while ( i < node_len - free_space )
+		{
+			unsigned char word_len = *(buffer.data() + i);
+			unsigned char pos = *(buffer.data() + i + 1);
+
+			if ( word_len == 0 )
+				break;
+
+			word = word.left (pos) + QByteArray ((const char*) buffer.data() + i + 2, word_len - 1);
+			i += 2 + word_len;
+
+			LCHMSearchIndexWord entry;
+			entry.word = word;
+
+			size_t encsz;
+			entry.wlc_count = be_encint (buffer.data() + i, encsz);
+			i += encsz;
+
+			cursor32 = buffer.data() + i;
+			entry.wlc_offset = UINT32ARRAY(cursor32);
+
+			i += sizeof(uint32_t) + sizeof(uint16_t);
+			entry.wlc_size = be_encint (buffer.data() + i, encsz);
+			i += encsz;
+
+			m_searchIndexWords.push_back (entry);
+		}
+
+		cursor32 = buffer.data();
+		node_offset = UINT32ARRAY(cursor32);
+	}
+
+	m_searchIndexValid = true;
+	return true;
+}
+
+
+bool LCHMFileImpl::getSearchIndexWordTopics( const LCHMSearchIndexWord& word, QBitArray * topics )
+{
+	int wlc_bit = 7;
+	uint64_t index = 0, count;
+	size_t length, off = 0;
+	QVector<unsigned char> buffer (word.wlc_size);
+
+	if ( RetrieveObject (&m_chmFIftiMain, buffer.data(), word.wlc_offset, word.wlc_size) == 0 )
+		return false;
+
+	// Same decoding as ProcessWLC(), without resolving the topics
+	for ( uint64_t i = 0; i < word.wlc_count; ++i )
+	{
+		if ( wlc_bit != 7 )
+		{
+			++off;
+			wlc_bit = 7;
+		}
+
+		index += sr_int (buffer.data() + off, &wlc_bit, m_searchIndexScales[0], m_searchIndexRoots[0], length);
+		off += length;
+
+		if ( index < (uint64_t) topics->size() )
+			topics->setBit (index);
+
+		count = sr_int (buffer.data() + off, &wlc_bit, m_searchIndexScales[1], m_searchIndexRoots[1], length);
+		off += length;
+
+		for ( uint64_t j = 0; j < count; ++j )
+		{
+			sr_int (buffer.data() + off, &wlc_bit, m_searchIndexScales[2], m_searchIndexRoots[2], length);
+			off += length;
+		}
+	}
+
+	return true;
+}
+
+
+bool LCHMFileImpl::searchTopicsContaining( const QList<QByteArray>& words, QBitArray * topics )
+{
+	if ( words.isEmpty() || !loadSearchIndexWords() )
+		return false;
+
+	*topics = QBitArray (m_topicUrls.size(), true);
+
+	foreach ( const QByteArray& word, words )
+	{
+		if ( QBitArray * cached = m_searchTopicsCache.object (word) )
+		{
+			*topics &= *cached;
+			continue;
+		}
+
+		QBitArray found (m_topicUrls.size());
+
+		for ( int i = 0; i < m_searchIndexWords.size(); i++ )
+		{
+			if ( m_searchIndexWords[i].word.contains (word)
+			&& !getSearchIndexWordTopics (m_searchIndexWords[i], &found) )
+				return false;
+		}
+
+		*topics &= found;
+		m_searchTopicsCache.insert (word, new QBitArray (found));
+	}
+
+	return true;
+}
+
+
 bool LCHMFileImpl::getInfoFromWindows()
 {
 #define WIN_HEADER_LEN 0x08
@@ -1267,6 +1443,7 @@ void LCHMFileImpl::fillTopicsUrlMap()
 		off_url = get_int32_le( (uint32_t *)( urltbl.data() + off_url + 8) ) + 8;
 
 		QString url = LCHMUrlFactory::makeURLabsoluteIfNeeded( (const char*) urlstr.data() + off_url );
+		m_topicUrls.push_back( url );
 
 		if ( off_title < (uint32_t)strings.size() )
 			m_url2topics[url] = encodeWithCurrentCodec ( (const char*) strings.data() + off_title );
@@ -29,6 +29,9 @@
 #include "libchmfile.h"
 #include "libchmtocimage.h"
 
+#include <QBitArray>
+#include <QCache>
+#include <QList>
 #include <QPixmap>
 
 //! Keeps the intermediate search result
@@ -46,6 +49,16 @@ class LCHMSearchProgressResult
 //! An array to keeps the intermediate search results
 typedef QVector<LCHMSearchProgressResult>	LCHMSearchProgressResults;
 
+//! A word of the search index, and where its locations are stored
+class LCHMSearchIndexWord
+{
+	public:
+		QByteArray				word;
+		uint64_t				wlc_count;
+		uint64_t				wlc_size;
+		uint32_t				wlc_offset;
+};
+
 
 //! CHM files processor; the implementation
 class LCHMFileImpl
@@ -92,6 +105,14 @@ class LCHMFileImpl
 		  				 LCHMSearchProgressResults& results, 
 		                 bool phrase_search );
 
+		/*!
+		 * \brief Finds the topics having indexed words which contain all the given words.
+		 * \param words The words to look for, lowercase and without accents.
+		 * \param topics Will hold a bit for each topic of m_topicUrls, set for the found topics.
+		 * \return true if the search index could be read, false otherwise.
+		*/
+		bool searchTopicsContaining( const QList<QByteArray>& words, QBitArray * topics );
+
 		/*!
 		 *  \brief Finalize the search, resolve the matches, the and generate the results array.
 		 * 	\param tempres Temporary search results from SearchWord.
@@ -156,6 +177,12 @@ class LCHMFileImpl
 						LCHMSearchProgressResults& results,
 						bool phrase_search );
 
+		//! Helper. Reads all the words of the $FIftiMain index once, walking its leaf nodes.
+		bool loadSearchIndexWords();
+
+		//! Helper. Sets the bits of the topics where the indexed word is found.
+		bool getSearchIndexWordTopics( const LCHMSearchIndexWord& word, QBitArray * topics );
+
 		//! Looks up as much information as possible from #WINDOWS/#STRINGS.
 		bool getInfoFromWindows();
 
@@ -296,5 +323,22 @@ class LCHMFileImpl
 		
 		//! Map url->topic
 		QMap< QString, QString >	m_url2topics;
+
+		//! The URLs of the topics of /#TOPICS, in order
+		QStringList	m_topicUrls;
+
+		//! TRUE if loadSearchIndexWords() was called, and the members below are valid if it succeeded
+		bool		m_searchIndexLoaded;
+		bool		m_searchIndexValid;
+
+		//! The scale and root sizes of the document index, word count and location codes of $FIftiMain
+		unsigned char	m_searchIndexScales[3];
+		unsigned char	m_searchIndexRoots[3];
+
+		//! All the words of $FIftiMain, in order
+		QVector<LCHMSearchIndexWord>	m_searchIndexWords;
+
+		//! The topics found by searchTopicsContaining() for the recently searched words
+		QCache<QByteArray, QBitArray>	m_searchTopicsCache;
 };
 #endif
@@ -9,22 +9,33 @@
 
 #include "document.h"
 
+#include <QtCore/QDataStream>
+#include <QtCore/QDateTime>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QHash>
 #include <QtCore/QScopedPointer>
+#include <QtCore/QtConcurrentMap>
 #include <QtGui/QImage>
 #include <QtGui/QImageReader>
 
 #include <klocale.h>
 #include <kmimetype.h>
+#include <kstandarddirs.h>
 #include <kzip.h>
 #include <ktar.h>
 
 #include <memory>
 
 #include <core/page.h>
+#include <core/utils.h>
 
 #include "unrar.h"
 #include "directory.h"
 #include "qnatsort.h"
+#ifdef HAVE_LIBARCHIVE
+#include "rararchive.h"
+#endif
 
 using namespace ComicBook;
 
@@ -40,9 +51,65 @@ static void imagesInArchive( const QString &prefix, const KArchiveDirectory* dir
     }
 }
 
+/**
+ * Returns the size of the image in the device, or an invalid size
+ * if the device does not contain an image.
+ */
+static QSize imageSize( QIODevice *dev )
+{
+    if ( !dev )
+        return QSize();
+
+    QImageReader reader( dev );
+    if ( !reader.canRead() )
+        return QSize();
+
+    QSize size = reader.size();
+    if ( !size.isValid() ) {
+        // the format does not tell the size without decoding the image
+        size = reader.read().size();
+    }
+    return size;
+}
+
+namespace {
+
+/**
+ * Probes the size of the images of a directory or of an extracted
+ * rar archive; they are plain files, so it can run in many threads.
+ */
+class ImageSizeProber
+{
+    public:
+        typedef QSize result_type;
+
+        ImageSizeProber( const Directory *directory, const Unrar *unrar )
+            : mDirectory( directory ), mUnrar( unrar )
+        {
+        }
+
+        QSize operator()( const QString &file ) const
+        {
+            QScopedPointer< QIODevice > dev( mDirectory ? mDirectory->createDevice( file ) : mUnrar->createDevice( file ) );
+            return imageSize( dev.data() );
+        }
+
+    private:
+        const Directory *mDirectory;
+        const Unrar *mUnrar;
+};
+
+}
+
+static const quint32 pageIndexMagic = 0x4f4b4349; // "OKCI"
+static const quint32 pageIndexVersion = 1;
+static const char pageIndexDirName[] = "okular/comicbook/";
+// the indexes of all the documents
+static const qint64 pageIndexCacheSize = 4 * 1024 * 1024;
+
 
 Document::Document()
-    : mDirectory( 0 ), mUnrar( 0 ), mArchive( 0 )
+    : mDirectory( 0 ), mUnrar( 0 ), mRarArchive( 0 ), mArchive( 0 )
 {
 }
 
@@ -54,6 +121,8 @@ bool Document::open( const QString &fileName )
 {
     close();
 
+    mFileName = fileName;
+
     const KMimeType::Ptr mime = KMimeType::findByFileContent( fileName );
 
     /**
@@ -76,8 +145,27 @@ bool Document::open( const QString &fileName )
             return false;
         }
     } else if ( mime->is( "application/x-cbr" ) || mime->name() == "application/x-rar" ) {
+#ifdef HAVE_LIBARCHIVE
+        /**
+         * We have a rar archive, read in process when libarchive can
+         */
+        mRarArchive = new RarArchive();
+
+        if ( mRarArchive->open( fileName ) ) {
+            mEntries = mRarArchive->list();
+            return true;
+        }
+
+        // e.g. RAR5 archives with an older libarchive, try unrar then
+        delete mRarArchive;
+        mRarArchive = 0;
+#endif
         if ( !Unrar::isAvailable() ) {
+#ifdef HAVE_LIBARCHIVE
+            mLastErrorString = i18n( "Cannot open document, the rar archive could not be read." );
+#else
             mLastErrorString = i18n( "Cannot open document, unrar was not found." );
+#endif
             return false;
         }
 
@@ -122,7 +210,7 @@ void Document::close()
 {
     mLastErrorString.clear();
 
-    if ( !( mArchive || mUnrar || mDirectory ) )
+    if ( !( mArchive || mUnrar || mRarArchive || mDirectory ) )
         return;
 
     delete mArchive;
@@ -131,8 +219,13 @@ void Document::close()
     mDirectory = 0;
     delete mUnrar;
     mUnrar = 0;
+#ifdef HAVE_LIBARCHIVE
+    delete mRarArchive;
+#endif
+    mRarArchive = 0;
     mPageMap.clear();
     mEntries.clear();
+    mFileName.clear();
 }
 
 bool Document::processArchive() {
@@ -161,39 +254,132 @@ bool Document::processArchive() {
 void Document::pages( QVector<Okular::Page*> * pagesVector )
 {
     qSort( mEntries.begin(), mEntries.end(), caseSensitiveNaturalOrderLessThen );
-    QScopedPointer< QIODevice > dev;
+
+    // the sizes of the images of an archive already opened are known
+    QVector<QSize> sizes;
+    const QString indexFileName = pageIndexFileName();
+    if ( !loadPageIndex( indexFileName, &sizes ) ) {
+        sizes = entrySizes();
+        savePageIndex( indexFileName, sizes );
+    }
 
     int count = 0;
     pagesVector->clear();
     pagesVector->resize( mEntries.size() );
-    QImageReader reader;
-    foreach(const QString &file, mEntries) {
-        if ( mArchive ) {
-            const KArchiveFile *entry = static_cast<const KArchiveFile*>( mArchiveDir->entry( file ) );
-            if ( entry ) {
-                dev.reset( entry->createDevice() );
-            }
-        } else if ( mDirectory ) {
-            dev.reset( mDirectory->createDevice( file ) );
-        } else {
-            dev.reset( mUnrar->createDevice( file ) );
+    for ( int i = 0; i < mEntries.count(); ++i ) {
+        const QSize &pageSize = sizes.at( i );
+        if ( pageSize.isValid() ) {
+            pagesVector->replace( count, new Okular::Page( count, pageSize.width(), pageSize.height(), Okular::Rotation0 ) );
+            mPageMap.append( mEntries.at( i ) );
+            count++;
         }
+    }
+    pagesVector->resize( count );
+}
 
-        if ( ! dev.isNull() ) {
-            reader.setDevice( dev.data() );
-            if ( reader.canRead() )
-            {
-                QSize pageSize = reader.size();
-                if ( !pageSize.isValid() ) {
-                    pageSize = reader.read().size();
-                }
-                pagesVector->replace( count, new Okular::Page( count, pageSize.width(), pageSize.height(), Okular::Rotation0 ) );
-                mPageMap.append(file);
-                count++;
-            }
+QVector<QSize> Document::entrySizes() const
+{
+    if ( mDirectory || mUnrar ) {
+        // reading the image headers is mostly waiting for the disk, and
+        // the images without the size in the header have to be decoded
+        return QtConcurrent::blockingMapped< QVector<QSize> >( mEntries, ImageSizeProber( mDirectory, mUnrar ) );
+    }
+
+    QVector<QSize> sizes;
+    sizes.reserve( mEntries.count() );
+
+#ifdef HAVE_LIBARCHIVE
+    if ( mRarArchive ) {
+        // the rar archive is read forward, so go through it in its order
+        QHash<QString, QSize> archiveSizes;
+        foreach ( const QString &file, mRarArchive->list() ) {
+            QScopedPointer< QIODevice > dev( mRarArchive->createDevice( file ) );
+            archiveSizes.insert( file, imageSize( dev.data() ) );
+        }
+        foreach ( const QString &file, mEntries ) {
+            sizes.append( archiveSizes.value( file ) );
         }
+        return sizes;
     }
-    pagesVector->resize( count );
+#endif
+
+    // the entries of a KArchive share the device of the archive,
+    // so they can be read only one at a time
+    foreach ( const QString &file, mEntries ) {
+        const KArchiveFile *entry = static_cast<const KArchiveFile*>( mArchiveDir->entry( file ) );
+        QScopedPointer< QIODevice > dev( entry ? entry->createDevice() : 0 );
+        sizes.append( imageSize( dev.data() ) );
+    }
+    return sizes;
+}
+
+QString Document::pageIndexFileName() const
+{
+    // the directories can change at any time, while the archives are
+    // rewritten as a whole
+    if ( mDirectory || mFileName.isEmpty() )
+        return QString();
+
+    const QString fingerprint = Okular::Utils::fileFingerprint( mFileName );
+    if ( fingerprint.isEmpty() )
+        return QString();
+
+    return KStandardDirs::locateLocal( "cache", pageIndexDirName ) + fingerprint + ".index";
+}
+
+bool Document::loadPageIndex( const QString &indexFileName, QVector<QSize> *sizes ) const
+{
+    if ( indexFileName.isEmpty() )
+        return false;
+
+    QFile file( indexFileName );
+    if ( !file.open( QIODevice::ReadOnly ) )
+        return false;
+
+    QDataStream stream( &file );
+    stream.setVersion( QDataStream::Qt_4_6 );
+    quint32 magic, version;
+    QDateTime modified;
+    QStringList entries;
+    stream >> magic >> version;
+    if ( magic != pageIndexMagic || version != pageIndexVersion )
+        return false;
+
+    stream >> modified >> entries >> *sizes;
+    if ( stream.status() != QDataStream::Ok ||
+         modified != QFileInfo( mFileName ).lastModified() ||
+         entries != mEntries || sizes->count() != mEntries.count() ) {
+        sizes->clear();
+        return false;
+    }
+
+    return true;
+}
+
+void Document::savePageIndex( const QString &indexFileName, const QVector<QSize> &sizes ) const
+{
+    if ( indexFileName.isEmpty() )
+        return;
+
+    QFile file( indexFileName + QLatin1String( ".part" ) );
+    if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+        return;
+
+    QDataStream stream( &file );
+    stream.setVersion( QDataStream::Qt_4_6 );
+    stream << pageIndexMagic << pageIndexVersion
+           << QFileInfo( mFileName ).lastModified() << mEntries << sizes;
+    file.close();
+
+    QFile::remove( indexFileName );
+    if ( file.error() != QFile::NoError || !file.rename( indexFileName ) ) {
+        file.remove();
+        return;
+    }
+
+    // remove the least recently written indexes above the size limit
+    Okular::Utils::pruneCacheDirectory( QFileInfo( indexFileName ).absolutePath(), pageIndexCacheSize,
+                                        QStringList() << QLatin1String( "*.index" ) );
 }
 
 QStringList Document::pageTitles() const
@@ -209,6 +395,12 @@ QImage Document::pageImage( int page ) const
             return QImage::fromData( entry->data() );
     } else if ( mDirectory ) {
         return QImage( mPageMap[ page ] );
+#ifdef HAVE_LIBARCHIVE
+    } else if ( mRarArchive ) {
+        // get the next pages ready while this one is shown
+        mRarArchive->prefetch( QStringList() << mPageMap.value( page + 1 ) << mPageMap.value( page + 2 ) );
+        return QImage::fromData( mRarArchive->contentOf( mPageMap[ page ] ) );
+#endif
     } else {
         return QImage::fromData( mUnrar->contentOf( mPageMap[ page ] ) );
     }
@@ -216,6 +408,45 @@ QImage Document::pageImage( int page ) const
     return QImage();
 }
 
+QImage Document::pageImage( int page, const QSize &scaledSize ) const
+{
+#ifdef HAVE_LIBARCHIVE
+    if ( mRarArchive ) {
+        // get the next pages ready while this one is shown
+        mRarArchive->prefetch( QStringList() << mPageMap.value( page + 1 ) << mPageMap.value( page + 2 ) );
+    }
+#endif
+
+    QScopedPointer< QIODevice > dev( createPageDevice( page ) );
+    if ( dev.isNull() )
+        return QImage();
+
+    QImageReader reader( dev.data() );
+    if ( reader.supportsOption( QImageIOHandler::ScaledSize ) )
+        reader.setScaledSize( scaledSize );
+    return reader.read();
+}
+
+QIODevice* Document::createPageDevice( int page ) const
+{
+    const QString file = mPageMap.value( page );
+    if ( file.isEmpty() )
+        return 0;
+
+    if ( mArchive ) {
+        const KArchiveFile *entry = static_cast<const KArchiveFile*>( mArchiveDir->entry( file ) );
+        return entry ? entry->createDevice() : 0;
+    } else if ( mDirectory ) {
+        return mDirectory->createDevice( file );
+#ifdef HAVE_LIBARCHIVE
+    } else if ( mRarArchive ) {
+        return mRarArchive->createDevice( file );
+#endif
+    }
+
+    return mUnrar->createDevice( file );
+}
+
 QString Document::lastErrorString() const
 {
     return mLastErrorString;
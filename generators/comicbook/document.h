@@ -10,13 +10,16 @@
 #ifndef COMICBOOK_DOCUMENT_H
 #define COMICBOOK_DOCUMENT_H
 
+#include <QtCore/QSize>
 #include <QtCore/QStringList>
+#include <QtCore/QVector>
 
 class KArchiveDirectory;
 class KArchive;
 class QImage;
-class QSize;
+class QIODevice;
 class Unrar;
+class RarArchive;
 class Directory;
 
 namespace Okular {
@@ -39,14 +42,27 @@ class Document
 
         QImage pageImage( int page ) const;
 
+        /**
+         * Returns the image of the @p page, decoded directly at the
+         * @p scaledSize if the image format allows it.
+         */
+        QImage pageImage( int page, const QSize &scaledSize ) const;
+
         QString lastErrorString() const;
 
     private:
         bool processArchive();
+        QIODevice* createPageDevice( int page ) const;
+        QVector<QSize> entrySizes() const;
+        QString pageIndexFileName() const;
+        bool loadPageIndex( const QString &indexFileName, QVector<QSize> *sizes ) const;
+        void savePageIndex( const QString &indexFileName, const QVector<QSize> &sizes ) const;
 
+        QString mFileName;
         QStringList mPageMap;
         Directory *mDirectory;
         Unrar *mUnrar;
+        RarArchive *mRarArchive;
         KArchive *mArchive;
         KArchiveDirectory *mArchiveDir;
         QString mLastErrorString;
@@ -38,7 +38,7 @@ static KAboutData createAboutData()
 OKULAR_EXPORT_PLUGIN( ComicBookGenerator, createAboutData() )
 
 ComicBookGenerator::ComicBookGenerator( QObject *parent, const QVariantList &args )
-    : Generator( parent, args )
+    : Generator( parent, args ), mLastPage( -1 )
 {
     setFeature( Threaded );
     setFeature( PrintNative );
@@ -66,6 +66,8 @@ bool ComicBookGenerator::loadDocument( const QString & fileName, QVector<Okular:
 bool ComicBookGenerator::doCloseDocument()
 {
     mDocument.close();
+    mLastPage = -1;
+    mLastImage = QImage();
 
     return true;
 }
@@ -75,7 +77,20 @@ QImage ComicBookGenerator::image( Okular::PixmapRequest * request )
     int width = request->width();
     int height = request->height();
 
-    QImage image = mDocument.pageImage( request->pageNumber() );
+    // the last decoded image of the page is good for the requests up to
+    // its size and down to its half
+    QImage image;
+    if ( mLastPage == request->pageNumber() && mLastImage.width() >= width &&
+         mLastImage.height() >= height && mLastImage.width() <= 2 * width ) {
+        image = mLastImage;
+    } else {
+        image = mDocument.pageImage( request->pageNumber(), QSize( width, height ) );
+        mLastPage = request->pageNumber();
+        mLastImage = image;
+    }
+
+    if ( image.size() == QSize( width, height ) )
+        return image;
 
     return image.scaled( width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
 }
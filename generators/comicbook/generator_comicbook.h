@@ -12,6 +12,8 @@
 
 #include <core/generator.h>
 
+#include <QtGui/QImage>
+
 #include "document.h"
 
 class ComicBookGenerator : public Okular::Generator
@@ -34,6 +36,9 @@ class ComicBookGenerator : public Okular::Generator
 
     private:
       ComicBook::Document mDocument;
+      // the last decoded page, reused for the requests of a similar size
+      int mLastPage;
+      QImage mLastImage;
 };
 
 #endif
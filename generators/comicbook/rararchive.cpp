@@ -0,0 +1,235 @@
+/***************************************************************************
+ *   Copyright (C) 2013 by Albert Astals Cid <aacid@kde.org>               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "rararchive.h"
+
+#include <QtCore/QBuffer>
+#include <QtCore/QFile>
+#include <QtCore/QtConcurrentRun>
+
+#include <kdebug.h>
+
+#include <archive.h>
+#include <archive_entry.h>
+
+// the number of extracted files kept in memory
+static const int cacheSize = 4;
+
+static void freeReader( struct archive *reader )
+{
+#if ARCHIVE_VERSION_NUMBER < 3000000
+    archive_read_finish( reader );
+#else
+    archive_read_free( reader );
+#endif
+}
+
+RarArchive::RarArchive()
+    : mReader( 0 ), mPosition( 0 ), mPrefetching( false )
+{
+}
+
+RarArchive::~RarArchive()
+{
+    mCacheMutex.lock();
+    mPendingPrefetch.clear();
+    mCacheMutex.unlock();
+    mPrefetchFuture.waitForFinished();
+
+    closeReader();
+}
+
+bool RarArchive::open( const QString &fileName )
+{
+    QMutexLocker locker( &mReadMutex );
+    closeReader();
+    mFileName = fileName;
+    mEntries.clear();
+
+    if ( !openReader() )
+        return false;
+
+    // build the index of the files once
+    struct archive_entry *entry;
+    int ret;
+    while ( ( ret = archive_read_next_header( mReader, &entry ) ) == ARCHIVE_OK )
+    {
+        if ( archive_entry_filetype( entry ) == AE_IFREG )
+            mEntries.append( QString::fromLocal8Bit( archive_entry_pathname( entry ) ) );
+        else
+            mEntries.append( QString() );
+        archive_read_data_skip( mReader );
+    }
+
+    const bool ok = ret == ARCHIVE_EOF;
+    if ( !ok )
+        kDebug() << "Error while reading" << fileName << ":" << archive_error_string( mReader );
+
+    closeReader();
+    return ok;
+}
+
+QStringList RarArchive::list() const
+{
+    QStringList files;
+    foreach ( const QString &entry, mEntries )
+    {
+        if ( !entry.isEmpty() )
+            files.append( entry );
+    }
+    return files;
+}
+
+QByteArray RarArchive::contentOf( const QString &fileName )
+{
+    QByteArray data = cachedContentOf( fileName );
+    if ( !data.isNull() )
+        return data;
+
+    const int index = mEntries.indexOf( fileName );
+    if ( fileName.isEmpty() || index < 0 )
+        return QByteArray();
+
+    QMutexLocker locker( &mReadMutex );
+    // it may have been extracted while waiting
+    data = cachedContentOf( fileName );
+    if ( !data.isNull() )
+        return data;
+
+    data = extract( index );
+
+    QMutexLocker cacheLocker( &mCacheMutex );
+    if ( mCache.count() >= cacheSize )
+        mCache.removeLast();
+    mCache.prepend( qMakePair( fileName, data ) );
+    return data;
+}
+
+QIODevice* RarArchive::createDevice( const QString &fileName )
+{
+    QBuffer *buffer = new QBuffer();
+    buffer->setData( contentOf( fileName ) );
+    buffer->open( QIODevice::ReadOnly );
+    return buffer;
+}
+
+void RarArchive::prefetch( const QStringList &fileNames )
+{
+    QMutexLocker locker( &mCacheMutex );
+    foreach ( const QString &fileName, fileNames )
+    {
+        if ( !fileName.isEmpty() && !mPendingPrefetch.contains( fileName ) )
+            mPendingPrefetch.append( fileName );
+    }
+
+    if ( !mPrefetching && !mPendingPrefetch.isEmpty() )
+    {
+        mPrefetching = true;
+        mPrefetchFuture = QtConcurrent::run( this, &RarArchive::runPrefetch );
+    }
+}
+
+bool RarArchive::openReader()
+{
+    mReader = archive_read_new();
+    archive_read_support_format_rar( mReader );
+    if ( archive_read_open_filename( mReader, QFile::encodeName( mFileName ), 10240 ) != ARCHIVE_OK )
+    {
+        kDebug() << "Cannot open" << mFileName << ":" << archive_error_string( mReader );
+        closeReader();
+        return false;
+    }
+
+    mPosition = 0;
+    return true;
+}
+
+void RarArchive::closeReader()
+{
+    if ( mReader )
+    {
+        freeReader( mReader );
+        mReader = 0;
+    }
+    mPosition = 0;
+}
+
+QByteArray RarArchive::extract( int index )
+{
+    // libarchive reads only forward, so going back needs to start again
+    if ( !mReader || index < mPosition )
+    {
+        closeReader();
+        if ( !openReader() )
+            return QByteArray();
+    }
+
+    struct archive_entry *entry;
+    while ( archive_read_next_header( mReader, &entry ) == ARCHIVE_OK )
+    {
+        const int position = mPosition++;
+        if ( position < index )
+        {
+            archive_read_data_skip( mReader );
+            continue;
+        }
+
+        QByteArray data;
+        if ( archive_entry_size_is_set( entry ) )
+            data.reserve( archive_entry_size( entry ) );
+
+        char buffer[ 16384 ];
+        ssize_t size;
+        while ( ( size = archive_read_data( mReader, buffer, sizeof( buffer ) ) ) > 0 )
+            data.append( buffer, size );
+
+        if ( size < 0 )
+        {
+            kDebug() << "Error while extracting from" << mFileName << ":" << archive_error_string( mReader );
+            closeReader();
+            return QByteArray();
+        }
+        return data;
+    }
+
+    closeReader();
+    return QByteArray();
+}
+
+QByteArray RarArchive::cachedContentOf( const QString &fileName )
+{
+    QMutexLocker locker( &mCacheMutex );
+    for ( int i = 0; i < mCache.count(); ++i )
+    {
+        if ( mCache.at( i ).first == fileName )
+        {
+            mCache.move( i, 0 );
+            return mCache.first().second;
+        }
+    }
+    return QByteArray();
+}
+
+void RarArchive::runPrefetch()
+{
+    forever
+    {
+        mCacheMutex.lock();
+        if ( mPendingPrefetch.isEmpty() )
+        {
+            mPrefetching = false;
+            mCacheMutex.unlock();
+            return;
+        }
+        const QString fileName = mPendingPrefetch.takeFirst();
+        mCacheMutex.unlock();
+
+        contentOf( fileName );
+    }
+}
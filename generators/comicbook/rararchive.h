@@ -0,0 +1,100 @@
+/***************************************************************************
+ *   Copyright (C) 2013 by Albert Astals Cid <aacid@kde.org>               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef RARARCHIVE_H
+#define RARARCHIVE_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QFuture>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QPair>
+#include <QtCore/QStringList>
+
+class QIODevice;
+struct archive;
+
+/**
+ * Reads the files of a rar archive in process, using libarchive.
+ *
+ * The list of the files is read once when opening the archive. The
+ * archive is read forward from the last extracted file when possible,
+ * and reopened only to go back, so reading the pages in order does not
+ * read the archive again. A few files are kept in memory, and the files
+ * asked to prefetch() are extracted in a separate thread.
+ *
+ * All the methods can be called from any thread.
+ */
+class RarArchive
+{
+    public:
+        /**
+         * Creates a new rar archive object.
+         */
+        RarArchive();
+
+        /**
+         * Destroys the rar archive object.
+         */
+        ~RarArchive();
+
+        /**
+         * Opens given rar archive.
+         */
+        bool open( const QString &fileName );
+
+        /**
+         * Returns the list of files from the archive.
+         */
+        QStringList list() const;
+
+        /**
+         * Returns the content of the file with the given name.
+         */
+        QByteArray contentOf( const QString &fileName );
+
+        /**
+         * Returns a new device for reading the file with the given name.
+         */
+        QIODevice* createDevice( const QString &fileName );
+
+        /**
+         * Extracts the files with the given names in the background, so
+         * that they are ready when asked.
+         */
+        void prefetch( const QStringList &fileNames );
+
+    private:
+        Q_DISABLE_COPY( RarArchive )
+
+        bool openReader();
+        void closeReader();
+        QByteArray extract( int index );
+        QByteArray cachedContentOf( const QString &fileName );
+        void runPrefetch();
+
+        QString mFileName;
+        QStringList mEntries;
+
+        // guards the libarchive reader
+        QMutex mReadMutex;
+        struct archive *mReader;
+        // the index of the next header of mReader
+        int mPosition;
+
+        // guards the cache and the prefetch queue
+        QMutex mCacheMutex;
+        // most recently used first
+        QList< QPair< QString, QByteArray > > mCache;
+        QStringList mPendingPrefetch;
+        bool mPrefetching;
+        QFuture<void> mPrefetchFuture;
+};
+
+#endif
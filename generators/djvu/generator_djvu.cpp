@@ -88,6 +88,7 @@ DjVuGenerator::DjVuGenerator( QObject *parent, const QVariantList &args )
 {
     setFeature( TextExtraction );
     setFeature( Threaded );
+    setFeature( TiledRendering );
     setFeature( PrintPostscript );
     if ( Okular::FilePrinter::ps2pdfAvailable() )
         setFeature( PrintToFile );
@@ -118,6 +119,7 @@ bool DjVuGenerator::doCloseDocument()
 {
     userMutex()->lock();
     m_djvu->closeFile();
+    updateCacheMemory();
     userMutex()->unlock();
 
     delete m_docInfo;
@@ -131,11 +133,44 @@ bool DjVuGenerator::doCloseDocument()
 QImage DjVuGenerator::image( Okular::PixmapRequest *request )
 {
     userMutex()->lock();
-    QImage img = m_djvu->image( request->pageNumber(), request->width(), request->height(), request->page()->rotation() );
+    QImage img;
+    if ( request->isTile() )
+    {
+        const QRect rect = request->normalizedRect().geometry( request->width(), request->height() );
+        img = m_djvu->image( request->pageNumber(), request->width(), request->height(), request->page()->rotation(), rect );
+    }
+    else
+    {
+        img = m_djvu->image( request->pageNumber(), request->width(), request->height(), request->page()->rotation() );
+    }
+    updateCacheMemory();
     userMutex()->unlock();
     return img;
 }
 
+qulonglong DjVuGenerator::cacheMemory() const
+{
+    return (qulonglong)(int)m_cacheMemory * 1024;
+}
+
+qulonglong DjVuGenerator::freeCacheMemory( qulonglong memory )
+{
+    // do not wait for a page being rendered: report nothing freed, the
+    // document asks again at its next memory check
+    if ( !userMutex()->tryLock() )
+        return 0;
+
+    const qulonglong freed = m_djvu->freeCacheMemory( memory );
+    updateCacheMemory();
+    userMutex()->unlock();
+    return freed;
+}
+
+void DjVuGenerator::updateCacheMemory()
+{
+    m_cacheMemory = (int)( m_djvu->cacheMemory() / 1024 );
+}
+
 const Okular::DocumentInfo * DjVuGenerator::generateDocumentInfo()
 {
     if ( m_docInfo )
@@ -12,6 +12,7 @@
 
 #include <core/generator.h>
 
+#include <qatomic.h>
 #include <qvector.h>
 
 #include "kdjvu.h"
@@ -44,12 +45,21 @@ class DjVuGenerator : public Okular::Generator
         QImage image( Okular::PixmapRequest *request );
         Okular::TextPage* textPage( Okular::Page *page );
 
+    protected slots:
+        qulonglong cacheMemory() const;
+        qulonglong freeCacheMemory( qulonglong memory );
+
     private:
         void loadPages( QVector<Okular::Page*> & pagesVector, int rotation );
         Okular::ObjectRect* convertKDjVuLink( int page, KDjVu::Link * link ) const;
         Okular::Annotation* convertKDjVuAnnotation( int w, int h, KDjVu::Annotation * ann ) const;
+        // to be called with the user mutex locked
+        void updateCacheMemory();
 
         KDjVu *m_djvu;
+        // the memory used by the caches of m_djvu, in KiB, so that it can be
+        // read without waiting for the rendering thread
+        QAtomicInt m_cacheMemory;
 
         Okular::DocumentInfo *m_docInfo;
         Okular::DocumentSynopsis *m_docSyn;
@@ -151,6 +151,11 @@ class ImageCacheItem
         ImageCacheItem( int p, int w, int h, const QImage& i )
           : page( p ), width( w ), height( h ), img( i ) { }
 
+        qulonglong memory() const
+        {
+            return (qulonglong)img.bytesPerLine() * img.height();
+        }
+
         int page;
         int width;
         int height;
@@ -430,12 +435,23 @@ class KDjVu::Private
     public:
         Private()
           : m_djvu_cxt( 0 ), m_djvu_document( 0 ), m_format( 0 ), m_docBookmarks( 0 ),
+            m_pagesCacheMemory( 0 ), m_imgCacheMemory( 0 ), m_cacheBudget( 64 * 1024 * 1024 ),
             m_cacheEnabled( true )
         {
         }
 
+        ddjvu_page_t * decodedPage( int page );
+        qulonglong decodedPageMemory( int page ) const;
+        void releaseDecodedPage( int page );
+        void insertImage( ImageCacheItem *item );
+        void removeImage( int index );
+        qulonglong freeCacheMemory( qulonglong memory, int pageToKeep = -1 );
+        void trimCaches( int pageToKeep );
+
         QImage generateImageTile( ddjvu_page_t *djvupage, int& res,
-            int width, int row, int xdelta, int height, int col, int ydelta );
+            int width, int height, const QRect &rect );
+        QImage generateImageRegion( ddjvu_page_t *djvupage, int& res,
+            int width, int height, const QRect &region );
 
         void readBookmarks();
         void fillBookmarksRecurse( QDomDocument& maindoc, QDomNode& curnode,
@@ -451,8 +467,15 @@ class KDjVu::Private
 
         QVector<KDjVu::Page*> m_pages;
         QVector<ddjvu_page_t *> m_pages_cache;
+        // the decoded pages, most recently used first
+        QList<int> m_pagesCacheOrder;
+        qulonglong m_pagesCacheMemory;
 
+        // most recently used first
         QList<ImageCacheItem*> mImgCache;
+        qulonglong m_imgCacheMemory;
+
+        qulonglong m_cacheBudget;
 
         QHash<QString, QVariant> m_metaData;
         QDomDocument * m_docBookmarks;
@@ -466,14 +489,98 @@ class KDjVu::Private
 
 unsigned int KDjVu::Private::s_formatmask[4] = { 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000 };
 
+ddjvu_page_t * KDjVu::Private::decodedPage( int page )
+{
+    if ( !m_pages_cache.at( page ) )
+    {
+        ddjvu_page_t *newpage = ddjvu_page_create_by_pageno( m_djvu_document, page );
+        // wait for the new page to be loaded
+        ddjvu_status_t sts;
+        while ( ( sts = ddjvu_page_decoding_status( newpage ) ) < DDJVU_JOB_OK )
+            handle_ddjvu_messages( m_djvu_cxt, true );
+        m_pages_cache[page] = newpage;
+        m_pagesCacheMemory += decodedPageMemory( page );
+    }
+    else
+    {
+        m_pagesCacheOrder.removeOne( page );
+    }
+    m_pagesCacheOrder.prepend( page );
+    return m_pages_cache.at( page );
+}
+
+qulonglong KDjVu::Private::decodedPageMemory( int page ) const
+{
+    // ddjvuapi does not tell how much memory a decoded page takes, so guess
+    // it: the mask takes a bit per pixel, and the wavelet coefficients of
+    // the background take six bytes per pixel, usually at a third of the
+    // resolution of the page
+    const KDjVu::Page *p = m_pages.at( page );
+    const qulonglong pixels = (qulonglong)p->width() * p->height();
+    return pixels / 8 + pixels / 9 * 6;
+}
+
+void KDjVu::Private::releaseDecodedPage( int page )
+{
+    ddjvu_page_release( m_pages_cache.at( page ) );
+    m_pages_cache[page] = 0;
+    m_pagesCacheOrder.removeOne( page );
+    m_pagesCacheMemory -= decodedPageMemory( page );
+}
+
+void KDjVu::Private::insertImage( ImageCacheItem *item )
+{
+    mImgCache.push_front( item );
+    m_imgCacheMemory += item->memory();
+}
+
+void KDjVu::Private::removeImage( int index )
+{
+    ImageCacheItem *item = mImgCache.takeAt( index );
+    m_imgCacheMemory -= item->memory();
+    delete item;
+}
+
+qulonglong KDjVu::Private::freeCacheMemory( qulonglong memory, int pageToKeep )
+{
+    const qulonglong before = m_pagesCacheMemory + m_imgCacheMemory;
+    qulonglong freed = 0;
+
+    // the rendered images first, they are the cheapest to get again
+    while ( freed < memory && !mImgCache.isEmpty() )
+    {
+        removeImage( mImgCache.count() - 1 );
+        freed = before - ( m_pagesCacheMemory + m_imgCacheMemory );
+    }
+
+    for ( int i = m_pagesCacheOrder.count() - 1; i >= 0 && freed < memory; --i )
+    {
+        const int page = m_pagesCacheOrder.at( i );
+        if ( page == pageToKeep )
+            continue;
+
+        releaseDecodedPage( page );
+        freed = before - ( m_pagesCacheMemory + m_imgCacheMemory );
+    }
+
+    return freed;
+}
+
+void KDjVu::Private::trimCaches( int pageToKeep )
+{
+    const qulonglong used = m_pagesCacheMemory + m_imgCacheMemory;
+    if ( used > m_cacheBudget )
+        freeCacheMemory( used - m_cacheBudget, pageToKeep );
+}
+
 QImage KDjVu::Private::generateImageTile( ddjvu_page_t *djvupage, int& res,
-    int width, int row, int xdelta, int height, int col, int ydelta )
+    int width, int height, const QRect &rect )
 {
     ddjvu_rect_t renderrect;
-    renderrect.x = row * xdelta;
-    renderrect.y = col * ydelta;
-    int realwidth = qMin( width - renderrect.x, xdelta );
-    int realheight = qMin( height - renderrect.y, ydelta );
+    renderrect.x = rect.x();
+    renderrect.y = rect.y();
+    int realwidth = rect.width();
+    int realheight = rect.height();
     renderrect.w = realwidth;
     renderrect.h = realheight;
 #ifdef KDJVU_DEBUG
@@ -502,6 +609,45 @@ QImage KDjVu::Private::generateImageTile( ddjvu_page_t *djvupage, int& res,
     return res_img;
 }
 
+QImage KDjVu::Private::generateImageRegion( ddjvu_page_t *djvupage, int& res,
+    int width, int height, const QRect &region )
+{
+    // ddjvu_page_render needs a buffer as big as the rendered rect, so big
+    // regions are rendered in pieces
+    static const int xdelta = 1500;
+    static const int ydelta = 1500;
+
+    if ( region.width() <= xdelta && region.height() <= ydelta )
+    {
+        // only one part -- render at once with no need to auxiliary image
+        return generateImageTile( djvupage, res, width, height, region );
+    }
+
+    // more than one part -- need to render piece-by-piece and to compose
+    // the results
+    QImage newimg( region.width(), region.height(), QImage::Format_RGB32 );
+    QPainter p;
+    p.begin( &newimg );
+    res = 10000;
+    for ( int y = region.top(); y <= region.bottom(); y += ydelta )
+    {
+        for ( int x = region.left(); x <= region.right(); x += xdelta )
+        {
+            const QRect part = QRect( x, y, xdelta, ydelta ) & region;
+            int tmpres = 0;
+            QImage tempp = generateImageTile( djvupage, tmpres, width, height, part );
+            if ( tmpres )
+            {
+                p.drawImage( part.topLeft() - region.topLeft(), tempp );
+            }
+            res = qMin( tmpres, res );
+        }
+    }
+    p.end();
+
+    return newimg;
+}
+
 void KDjVu::Private::readBookmarks()
 {
     if ( !m_djvu_document )
@@ -758,9 +904,12 @@ void KDjVu::closeFile()
     for ( ; it != itEnd; ++it )
         ddjvu_page_release( *it );
     d->m_pages_cache.clear();
+    d->m_pagesCacheOrder.clear();
+    d->m_pagesCacheMemory = 0;
     // clearing the image cache
     qDeleteAll( d->mImgCache );
     d->mImgCache.clear();
+    d->m_imgCacheMemory = 0;
     // clearing the old metadata
     d->m_metaData.clear();
     // cleaing the page names mapping
@@ -909,39 +1058,22 @@ QImage KDjVu::image( int page, int width, int height, int rotation )
 {
     if ( d->m_cacheEnabled )
     {
-    bool found = false;
-    QList<ImageCacheItem*>::Iterator it = d->mImgCache.begin(), itEnd = d->mImgCache.end();
-    for ( ; ( it != itEnd ) && !found; ++it )
+    for ( int i = 0; i < d->mImgCache.count(); ++i )
     {
-        ImageCacheItem* cur = *it;
+        ImageCacheItem* cur = d->mImgCache.at( i );
         if ( ( cur->page == page ) &&
              ( rotation % 2 == 0
                ? cur->width == width && cur->height == height
                : cur->width == height && cur->height == width ) )
-            found = true;
-    }
-    if ( found )
-    {
-        // taking the element and pushing to the top of the list
-        --it;
-        ImageCacheItem* cur2 = *it;
-        d->mImgCache.erase( it );
-        d->mImgCache.push_front( cur2 );
-
-        return cur2->img;
+        {
+            // taking the element and pushing to the top of the list
+            d->mImgCache.move( i, 0 );
+            return cur->img;
+        }
     }
     }
 
-    if ( !d->m_pages_cache.at( page ) )
-    {
-        ddjvu_page_t *newpage = ddjvu_page_create_by_pageno( d->m_djvu_document, page );
-        // wait for the new page to be loaded
-        ddjvu_status_t sts;
-        while ( ( sts = ddjvu_page_decoding_status( newpage ) ) < DDJVU_JOB_OK )
-            handle_ddjvu_messages( d->m_djvu_cxt, true );
-        d->m_pages_cache[page] = newpage;
-    }
-    ddjvu_page_t *djvupage = d->m_pages_cache[page];
+    ddjvu_page_t *djvupage = d->decodedPage( page );
 
 /*
     if ( ddjvu_page_get_rotation( djvupage ) != flipRotation( rotation ) )
@@ -952,76 +1084,38 @@ QImage KDjVu::image( int page, int width, int height, int rotation )
     }
 */
 
-    static const int xdelta = 1500;
-    static const int ydelta = 1500;
-
-    int xparts = width / xdelta + 1;
-    int yparts = height / ydelta + 1;
-
-    QImage newimg;
-
-    int res = 10000;
-    if ( ( xparts == 1 ) && ( yparts == 1 ) )
-    {
-         // only one part -- render at once with no need to auxiliary image
-         newimg = d->generateImageTile( djvupage, res,
-                 width, 0, xdelta, height, 0, ydelta );
-    }
-    else
-    {
-        // more than one part -- need to render piece-by-piece and to compose
-        // the results
-        newimg = QImage( width, height, QImage::Format_RGB32 );
-        QPainter p;
-        p.begin( &newimg );
-        int parts = xparts * yparts;
-        for ( int i = 0; i < parts; ++i )
-        {
-            int row = i % xparts;
-            int col = i / xparts;
-            int tmpres = 0;
-            QImage tempp = d->generateImageTile( djvupage, tmpres,
-                    width, row, xdelta, height, col, ydelta );
-            if ( tmpres )
-            {
-                p.drawImage( row * xdelta, col * ydelta, tempp );
-            }
-            res = qMin( tmpres, res );
-        }
-        p.end();
-    }
+    int res = 0;
+    QImage newimg = d->generateImageRegion( djvupage, res, width, height, QRect( 0, 0, width, height ) );
 
     if ( res && d->m_cacheEnabled )
     {
-        // delete all the cached pixmaps for the current page with a size that
-        // differs no more than 35% of the new pixmap size
-        int imgsize = newimg.width() * newimg.height();
-        if ( imgsize > 0 )
-        {
-            for( int i = 0; i < d->mImgCache.count(); )
-            {
-                ImageCacheItem* cur = d->mImgCache.at(i);
-                if ( ( cur->page == page ) &&
-                     ( abs( cur->img.width() * cur->img.height() - imgsize ) < imgsize * 0.35 ) )
-                {
-                    d->mImgCache.removeAt( i );
-                    delete cur;
-                }
-                else
-                    ++i;
-            }
-        }
-
-        // the image cache has too many elements, remove the last
-        if ( d->mImgCache.size() >= 10 )
-        {
-            delete d->mImgCache.last();
-            d->mImgCache.removeLast();
-        }
         ImageCacheItem* ich = new ImageCacheItem( page, width, height, newimg );
-        d->mImgCache.push_front( ich );
+        d->insertImage( ich );
     }
 
+    // the least recently used images and pages go away if over budget
+    d->trimCaches( page );
+
+    return newimg;
+}
+
+QImage KDjVu::image( int page, int width, int height, int rotation, const QRect &region )
+{
+    const QRect rect = region & QRect( 0, 0, width, height );
+    if ( rect == QRect( 0, 0, width, height ) )
+        return image( page, width, height, rotation );
+
+    if ( rect.isEmpty() )
+        return QImage();
+
+    ddjvu_page_t *djvupage = d->decodedPage( page );
+
+    // the regions are not cached, as they are hardly requested twice
+    int res = 0;
+    QImage newimg = d->generateImageRegion( djvupage, res, width, height, rect );
+
+    d->trimCaches( page );
+
     return newimg;
 }
 
@@ -1141,9 +1235,31 @@ void KDjVu::setCacheEnabled( bool enable )
     {
         qDeleteAll( d->mImgCache );
         d->mImgCache.clear();
+        d->m_imgCacheMemory = 0;
     }
 }
 
+void KDjVu::setCacheBudget( qulonglong memory )
+{
+    d->m_cacheBudget = memory;
+    d->trimCaches( -1 );
+}
+
+qulonglong KDjVu::cacheBudget() const
+{
+    return d->m_cacheBudget;
+}
+
+qulonglong KDjVu::cacheMemory() const
+{
+    return d->m_pagesCacheMemory + d->m_imgCacheMemory;
+}
+
+qulonglong KDjVu::freeCacheMemory( qulonglong memory )
+{
+    return d->freeCacheMemory( memory );
+}
+
 bool KDjVu::isCacheEnabled() const
 {
     return d->m_cacheEnabled;
@@ -257,6 +257,14 @@ class KDjVu
          */
         QImage image( int page, int width, int height, int rotation );
 
+        /**
+         * Render only the \p region of the specified \p page scaled to
+         * \p width x \p height, with the specified \p rotation.
+         * The region is in the coordinates of the scaled page; the rendered
+         * regions are not cached.
+         */
+        QImage image( int page, int width, int height, int rotation, const QRect &region );
+
         /**
          * Export the currently open document as PostScript file \p fileName.
          * \returns whether the exporting was successful
@@ -284,6 +292,28 @@ class KDjVu
          */
         bool isCacheEnabled() const;
 
+        /**
+         * Set the maximum \p memory, in bytes, used by the decoded pages and
+         * by the rendered pages cache together.
+         */
+        void setCacheBudget( qulonglong memory );
+        /**
+         * \returns the maximum memory used by the caches
+         */
+        qulonglong cacheBudget() const;
+
+        /**
+         * \returns the memory, in bytes, currently used by the decoded pages
+         * and by the rendered pages cache
+         */
+        qulonglong cacheMemory() const;
+        /**
+         * Free at least \p memory bytes from the caches, starting from the least
+         * recently used rendered pages and decoded pages.
+         * \returns the memory actually freed
+         */
+        qulonglong freeCacheMemory( qulonglong memory );
+
         /**
          * Return the page number of the page whose title is \p name.
          */
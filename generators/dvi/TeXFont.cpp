@@ -2,7 +2,32 @@
 #include <config.h>
 
 #include "TeXFont.h"
+#include "fontpool.h"
 
 
 TeXFont::~TeXFont()
-{}
+{
+  parent->font_pool->glyphs.removeFont(this);
+}
+
+
+bool TeXFont::renderGlyph(quint16 ch, double resolution, const QColor& color, glyph *g)
+{
+  if (ch >= TeXFontDefinition::max_num_of_chars_in_font)
+    return false;
+
+  fontPool *pool = parent->font_pool;
+  double fontResolution = resolution * parent->enlargement;
+  if (pool->glyphs.find(this, ch, fontResolution, color, g))
+    return true;
+
+  // The glyph table of the font holds the characters of one
+  // resolution at a time, and PK fonts read their bitmaps from a
+  // shared file.
+  QMutexLocker locker(&pool->mutex);
+  if (parent->displayResolution_in_dpi != fontResolution)
+    parent->setDisplayResolution(fontResolution);
+  *g = *getGlyph(ch, true, color);
+  pool->glyphs.insert(this, ch, fontResolution, g);
+  return true;
+}
@@ -31,6 +31,16 @@ class TeXFont {
 
   virtual glyph* getGlyph(quint16 character, bool generateCharacterPixmap=false, const QColor& color=Qt::black) = 0;
 
+  /** Sets in @p g the character @p ch, shrunken to the display
+      resolution @p resolution in the given @p color, with its offsets
+      and its advance. The character comes from the glyph cache of the
+      font pool, or is generated by getGlyph() under the lock of the
+      font pool, so several pages can be rendered at the same time.
+      Returns false if @p ch is out of the range of the font. */
+  bool renderGlyph(quint16 ch, double resolution, const QColor& color, glyph *g);
+
+ public:
+
   // Checksum of the font. Used e.g. by PK fonts. This field is filled
   // in by the constructor, or set to 0.0, if the font format does not
   // contain checksums.
@@ -53,7 +53,7 @@ TeXFontDefinition::TeXFontDefinition(const QString &nfontname, double _displayRe
   // By default, this font contains only empty characters. After the
   // font has been loaded, this function pointer will be replaced by
   // another one.
-  set_char_p  = &dviRenderer::set_empty_char;
+  set_char_p  = &dviRenderContext::set_empty_char;
 }
 
 
@@ -110,7 +110,7 @@ void TeXFontDefinition::fontNameReceiver(const QString& fname)
       filename = filename_test;
   }
 
-  set_char_p = &dviRenderer::set_char;
+  set_char_p = &dviRenderContext::set_char;
   int magic      = two(file);
 
   if (fname.endsWith("pk"))
@@ -118,7 +118,7 @@ void TeXFontDefinition::fontNameReceiver(const QString& fname)
       fclose(file);
       file = 0;
       font = new TeXFont_PK(this);
-      set_char_p = &dviRenderer::set_char;
+      set_char_p = &dviRenderContext::set_char;
       if ((checksum != 0) && (checksum != font->checksum))
         kWarning(kvs::dvi) << i18n("Checksum mismatch for font file %1", filename) ;
       fontType = TEX_PK;
@@ -128,7 +128,7 @@ void TeXFontDefinition::fontNameReceiver(const QString& fname)
   if (fname.endsWith(".vf"))
     if (magic == VF_MAGIC) {
       read_VF_index();
-      set_char_p = &dviRenderer::set_vf_char;
+      set_char_p = &dviRenderContext::set_vf_char;
       fontType = TEX_VIRTUAL;
       return;
     }
@@ -137,7 +137,7 @@ void TeXFontDefinition::fontNameReceiver(const QString& fname)
       fclose(file);
       file = 0;
       font = new TeXFont_TFM(this);
-      set_char_p = &dviRenderer::set_char;
+      set_char_p = &dviRenderContext::set_char;
       fontType = TEX_FONTMETRIC;
       return;
   }
@@ -162,7 +162,7 @@ void TeXFontDefinition::fontNameReceiver(const QString& fname)
     font = new TeXFont_PFB(this);
   }
 
-  set_char_p = &dviRenderer::set_char;
+  set_char_p = &dviRenderContext::set_char;
   fontType = FREETYPE;
   return;
 #else
@@ -196,7 +196,7 @@ void TeXFontDefinition::reset()
 
   filename.clear();
   flags      = TeXFontDefinition::FONT_IN_USE;
-  set_char_p = &dviRenderer::set_empty_char;
+  set_char_p = &dviRenderContext::set_empty_char;
 }
 
 
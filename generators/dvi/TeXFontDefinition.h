@@ -21,10 +21,10 @@
 #include <cstdio>
 #include <stdio.h>
 
-class dviRenderer;
+class dviRenderContext;
 class TeXFont;
 
-typedef void (dviRenderer::*set_char_proc)(unsigned int, unsigned int);
+typedef void (dviRenderContext::*set_char_proc)(unsigned int, unsigned int);
 
 
 // Per character information for virtual fonts
@@ -54,20 +54,12 @@ dviRenderer::dviRenderer(bool useFontHinting)
     embedPS_progress(0),
     embedPS_numOfProgressedFiles(0),
     shrinkfactor(3),
-    source_href(0),
-    HTML_href(0),
     editorCommand(""),
     PostScriptOutPutString(0),
     PS_interface(new ghostscript_interface),
     _postscript(true),
-    line_boundary_encountered(false),
-    word_boundary_encountered(false),
     current_page(0),
-    penWidth_in_mInch(0),
-    number_of_elements_in_path(0),
-    currentlyDrawnPage(0),
-    m_eventLoop(0),
-    foreGroundPainter(0)
+    m_eventLoop(0)
 {
 #ifdef DEBUG_DVIRENDERER
   //kDebug(kvs::dvi) << "dviRenderer( parent=" << par << " )";
@@ -77,6 +69,7 @@ dviRenderer::dviRenderer(bool useFontHinting)
 //  connect( &clearStatusBarTimer, SIGNAL(timeout()), this, SLOT(clearStatusBar()) );
   // pass status bar messages through
 //  connect(PS_interface, SIGNAL(setStatusBarText(QString)), this, SIGNAL(setStatusBarText(QString)) );
+  connect(PS_interface, SIGNAL(graphicsReady(int)), this, SIGNAL(graphicsReady(int)), Qt::QueuedConnection);
 }
 
 
@@ -116,6 +109,12 @@ void dviRenderer::showInfo()
 
 
 void dviRenderer::drawPage(RenderedDocumentPagePixmap* page)
+{
+  drawPage(page, _postscript);
+}
+
+
+void dviRenderer::drawPage(RenderedDocumentPagePixmap* page, bool postscript)
 {
 #ifdef DEBUG_DVIRENDERER
   //kDebug(kvs::dvi) << "dviRenderer::drawPage(documentPage *) called, page number " << page->pageNumber;
@@ -132,9 +131,6 @@ void dviRenderer::drawPage(RenderedDocumentPagePixmap* page)
     return;
   }
 
-  QMutexLocker locker(&mutex);
-
-
   if ( dviFile == 0 ) {
     kError(kvs::dvi) << "dviRenderer::drawPage(documentPage *) called, but no dviFile class allocated." << endl;
     page->clear();
@@ -151,35 +147,14 @@ void dviRenderer::drawPage(RenderedDocumentPagePixmap* page)
     return;
   }
 
-  double resolution = page->resolution;
-
-  if (resolution != resolutionInDPI)
-    setResolution(resolution);
- 
-  currentlyDrawnPage     = page;
-  shrinkfactor           = 1200/resolutionInDPI;
-  current_page           = page->pageNumber-1;
-
-
-  // Reset colors
-  colorStack.clear();
-  globalColor = Qt::black;
-
   int pageWidth = page->width;
   int pageHeight = page->height;
  
   QImage img(pageWidth, pageHeight, QImage::Format_RGB32);
-  foreGroundPainter = new QPainter(&img);
-  if (foreGroundPainter != 0) {
-    errorMsg.clear();
-    draw_page();
-    delete foreGroundPainter;
-    foreGroundPainter = 0;
-  }
-  else
-  {
-    kDebug(kvs::dvi) << "painter creation failed.";
-  } 
+  QPainter painter(&img);
+  dviRenderContext context(this, page, &painter, postscript);
+  context.draw_page();
+  painter.end();
   page->img = img;
 //page->setImage(img);
  
@@ -227,19 +202,17 @@ void dviRenderer::drawPage(RenderedDocumentPagePixmap* page)
 
 #if 0
   page->isEmpty = false;
-  if (errorMsg.isEmpty() != true) {
+  if (context.errorMsg.isEmpty() != true) {
     KMessageBox::detailedError(parentWidget,
                                i18n("<qt><strong>File corruption</strong> Okular could not interpret your DVI file. This is "
                                     "most commonly caused by a corrupted file.</qt>"),
-                               errorMsg, i18n("DVI File Error"));
-    errorMsg.clear();
-    currentlyDrawnPage = 0;
+                               context.errorMsg, i18n("DVI File Error"));
     return;
   }
 
   // Tell the user (once) if the DVI file contains source specials
   // ... we don't want our great feature to go unnoticed.
-  RenderedDviPagePixmap* currentDVIPage = dynamic_cast<RenderedDviPagePixmap*>(currentlyDrawnPage);
+  RenderedDviPagePixmap* currentDVIPage = dynamic_cast<RenderedDviPagePixmap*>(page);
   if (currentDVIPage)
   {
     if ((dviFile->sourceSpecialMarker == true) && (currentDVIPage->sourceHyperLinkList.size() > 0)) {
@@ -251,19 +224,13 @@ void dviRenderer::drawPage(RenderedDocumentPagePixmap* page)
     }
   }
 #endif
-  currentlyDrawnPage = 0;
 }
 
 
 void dviRenderer::getText(RenderedDocumentPagePixmap* page)
 {
-  bool postscriptBackup = _postscript;
-  // Disable postscript-specials temporarely to speed up text extraction.
-  _postscript = false;
-
-  drawPage(page);
-
-  _postscript = postscriptBackup;
+  // Disable postscript-specials to speed up text extraction.
+  drawPage(page, false);
 }
 
 /*
@@ -34,12 +34,14 @@
 class Anchor;
 class DocumentWidget;
 class dvifile;
+class dviRenderContext;
 class dviRenderer;
 class ghostscript_interface;
 //class infoDialog;
 class QEventLoop;
 class KProgressDialog;
 class PreBookmark;
+class QPainter;
 class TeXFontDefinition;
 
 extern const int MFResolutions[];
@@ -74,7 +76,7 @@ struct framedata {
 
 /* this information is saved when using virtual fonts */
 
-typedef void (dviRenderer::*set_char_proc)(unsigned int, unsigned int);
+typedef void (dviRenderContext::*set_char_proc)(unsigned int, unsigned int);
 typedef void (dviRenderer::*parseSpecials)(char *, quint8 *);
 
 struct drawinf {
@@ -87,6 +89,101 @@ struct drawinf {
 };
 
 
+/** The state of the DVI interpreter while it draws one page
+
+    The position, the color stack, the hyperlink being drawn, the
+    painter, the resolution and the shrunken characters used so far
+    belong to one call of dviRenderer::drawPage(), so that several
+    pages can be drawn at the same time. The renderer, the font pool
+    and its glyph cache are shared by all the contexts. */
+
+class dviRenderContext : public bigEndianByteReader
+{
+public:
+  dviRenderContext(dviRenderer *renderer, RenderedDocumentPagePixmap *page, QPainter *painter, bool postscript);
+  ~dviRenderContext();
+
+  void          draw_page();
+  void          draw_part(double current_dimconv, bool is_vfmacro);
+  void          set_vf_char(unsigned int cmd, unsigned int ch);
+  void          set_char(unsigned int cmd, unsigned int ch);
+  void          set_empty_char(unsigned int cmd, unsigned int ch);
+  void          set_no_char(unsigned int cmd, unsigned int ch);
+
+  QString       errorMsg;
+
+private:
+  /** Returns the character @p ch of the current font, shrunken to the
+      resolution of the page in the current color. */
+  glyph        *shrunkenGlyph(unsigned int ch);
+
+  void          applicationDoSpecial(char * cp);
+  void          color_special(const QString& msg);
+  void          html_href_special(const QString& msg);
+  void          html_anchor_end();
+
+  /** Methods which handle certain special commands. */
+  void epsf_special(const QString& cp);
+  void source_special(const QString& cp);
+
+  /** TPIC specials */
+  void TPIC_setPen_special(const QString& cp);
+  void TPIC_addPath_special(const QString& cp);
+  void TPIC_flushPath_special();
+
+  dviRenderer  *renderer;
+  dvifile      *dviFile;
+
+  double        resolutionInDPI;
+
+  /** Shrink factor. Units are not quite clear */
+  double        shrinkfactor;
+
+  unsigned int  current_page;
+
+  /** true, if the PostScript graphics should be drawn */
+  bool          _postscript;
+
+  // If not NULL, the text currently drawn represents a source
+  // hyperlink to the (relative) URL given in the string;
+  QString          *source_href;
+
+  // If not NULL, the text currently drawn represents a hyperlink to
+  // the (relative) URL given in the string;
+  QString          *HTML_href;
+
+  /** Stack for register compounds, used for the DVI-commands PUSH/POP
+      as explained in section 2.5 and 2.6.2 of the DVI driver standard,
+      Level 0, published by the TUG DVI driver standards committee. */
+  QStack<framedata> stack;
+
+  /** A stack where color are stored, according to the documentation of
+      DVIPS */
+  QStack<QColor> colorStack;
+
+  /** The global color is to be used when the color stack is empty */
+  QColor              globalColor;
+
+  /** This flag is used when rendering a dvi-page. It is set to "true"
+      when any dvi-command other than "set" or "put" series of commands
+      is encountered. This is considered to mark the end of a word. */
+  bool              line_boundary_encountered;
+  bool              word_boundary_encountered;
+
+  /** Data required for handling TPIC specials */
+  float       penWidth_in_mInch;
+  QPolygon TPIC_path;
+  quint16    number_of_elements_in_path;
+
+  drawinf currinf;
+  RenderedDocumentPagePixmap* currentlyDrawnPage;
+  QPainter* foreGroundPainter;
+
+  /** The shrunken characters drawn on this page so far */
+  QHash<glyphCacheKey, glyph> glyphs;
+};
+
+
 
 class dviRenderer : public QObject /*: public DocumentRenderer*/, bigEndianByteReader
 {
@@ -137,19 +234,9 @@ public:
 
   // These should not be public... only for the moment
   void          read_postamble();
-  void          draw_part(double current_dimconv, bool is_vfmacro);
-  void          set_vf_char(unsigned int cmd, unsigned int ch);
-  void          set_char(unsigned int cmd, unsigned int ch);
-  void          set_empty_char(unsigned int cmd, unsigned int ch);
-  void          set_no_char(unsigned int cmd, unsigned int ch);
-  void          applicationDoSpecial(char * cp);
 
   void          special(long nbytes);
   void          printErrorMsgForSpecials(const QString& msg);
-  void          color_special(const QString& msg);
-  void          html_href_special(const QString& msg);
-  void          html_anchor_end();
-  void          draw_page();
   void          export_finished(const DVIExport*);
 //void          editor_finished(const DVISourceEditor*);
 
@@ -166,6 +253,8 @@ public slots:
       in dviRenderer::mouseMoveEvent(), see the explanation there. */
   void          clearStatusBar();
 
+  /** Draws the page, and can be called from several threads at the
+      same time. */
   virtual void  drawPage(RenderedDocumentPagePixmap* page);
   virtual void  getText(RenderedDocumentPagePixmap* page);
 
@@ -175,6 +264,11 @@ public slots:
 
   const QVector<DVI_SourceFileAnchor>& sourceAnchors() { return sourceHyperLinkAnchors; }
 
+signals:
+  /** Emitted when the PostScript graphics of the page (a PageNumber),
+      rendered in the background, are ready to be drawn. */
+  void          graphicsReady(int page);
+
 private slots:
   /** This method shows a dialog that tells the user that source
       information is present, and gives the opportunity to open the
@@ -184,6 +278,7 @@ private slots:
 private:
   friend class DVIExportToPS;
   friend class DVIExport;
+  friend class dviRenderContext;
 //  friend class DVISourceEditor;
 
   /** URL to the DVI file
@@ -198,7 +293,7 @@ private:
 
   /** This map contains the colors which are known by name. This field
       is initialized in the method parseColorSpecification() as soon as
-      it is needed. */
+      it is needed, under the mutex. */
   QMap<QString, QColor> namedColors;
 
   /** This method locates special PDF characters in a string and
@@ -211,6 +306,12 @@ private:
   fontPool      font_pool;
   //infoDialog    *info;
 
+  /** Draws the page, with or without its PostScript graphics. */
+  void          drawPage(RenderedDocumentPagePixmap* page, bool postscript);
+
+  /** The resolution, the position and the page of the prescan, which
+      reads the whole document when it is loaded or exported. The pages
+      are drawn with a dviRenderContext. */
   double        resolutionInDPI;
 
   // @@@ explanation
@@ -243,15 +344,6 @@ private:
 
   QString       errorMsg;
 
-  /** Methods which handle certain special commands. */
-  void epsf_special(const QString& cp);
-  void source_special(const QString& cp);
-
-  /** TPIC specials */
-  void TPIC_setPen_special(const QString& cp);
-  void TPIC_addPath_special(const QString& cp);
-  void TPIC_flushPath_special();
-
   /** This timer is used to delay clearing of the statusbar. Clearing
       the statusbar is delayed to avoid awful flickering when the
       mouse moves over a block of text that contains source
@@ -264,14 +356,6 @@ private:
   // with PostScriptOutPutString != NULL
   QVector<DVI_SourceFileAnchor>  sourceHyperLinkAnchors;
 
-  // If not NULL, the text currently drawn represents a source
-  // hyperlink to the (relative) URL given in the string;
-  QString          *source_href;
-
-  // If not NULL, the text currently drawn represents a hyperlink to
-  // the (relative) URL given in the string;
-  QString          *HTML_href;
-
   QString           editorCommand;
 
   /** Stack for register compounds, used for the DVI-commands PUSH/POP
@@ -279,13 +363,6 @@ private:
       Level 0, published by the TUG DVI driver standards committee. */
   QStack<framedata> stack;
 
-  /** A stack where color are stored, according to the documentation of
-      DVIPS */
-  QStack<QColor> colorStack;
-
-  /** The global color is to be used when the color stack is empty */
-  QColor              globalColor;
-
   /** If PostScriptOutPutFile is non-zero, then no rendering takes
       place. Instead, the PostScript code which is generated by the
       \special-commands is written to the PostScriptString */
@@ -297,21 +374,9 @@ private:
       drawn. */
   bool               _postscript;
 
-  /** This flag is used when rendering a dvi-page. It is set to "true"
-      when any dvi-command other than "set" or "put" series of commands
-      is encountered. This is considered to mark the end of a word. */
-  bool              line_boundary_encountered;
-  bool              word_boundary_encountered;
-
   unsigned int           current_page;
 
-  /** Data required for handling TPIC specials */
-  float       penWidth_in_mInch;
-  QPolygon TPIC_path;
-  quint16    number_of_elements_in_path;
-
   drawinf currinf;
-  RenderedDocumentPagePixmap* currentlyDrawnPage;
   QMap<const DVIExport*, KSharedPtr<DVIExport> > all_exports_;
   //KSharedPtr<DVISourceEditor> editor_;
 
@@ -341,8 +406,6 @@ private:
   QWidget* parentWidget;
 
   QEventLoop* m_eventLoop;
-
-  QPainter* foreGroundPainter;
 };
 
 #endif
@@ -71,19 +71,62 @@
 
 
 
+dviRenderContext::dviRenderContext(dviRenderer *_renderer, RenderedDocumentPagePixmap *page, QPainter *painter, bool postscript)
+  : renderer(_renderer),
+    dviFile(_renderer->dviFile),
+    resolutionInDPI(page->resolution),
+    shrinkfactor(1200/page->resolution),
+    current_page(page->pageNumber-1),
+    _postscript(postscript),
+    source_href(0),
+    HTML_href(0),
+    globalColor(Qt::black),
+    line_boundary_encountered(false),
+    word_boundary_encountered(false),
+    penWidth_in_mInch(0),
+    number_of_elements_in_path(0),
+    currentlyDrawnPage(page),
+    foreGroundPainter(painter)
+{
+}
+
+
+dviRenderContext::~dviRenderContext()
+{
+  delete HTML_href;
+  delete source_href;
+}
+
+
+glyph *dviRenderContext::shrunkenGlyph(unsigned int ch)
+{
+  TeXFont *font = (TeXFont *)(currinf.fontp->font);
+  const QColor &color = colorStack.isEmpty() ? globalColor : colorStack.top();
+
+  // Look the character up in the glyph table of the page first, so
+  // that the glyph cache and the font pool, which are shared with the
+  // other pages being drawn, are asked once per character only.
+  glyphCacheKey key = glyphCache::key(font, ch, resolutionInDPI, color);
+  QHash<glyphCacheKey, glyph>::iterator it = glyphs.find(key);
+  if (it == glyphs.end()) {
+    glyph g;
+    if (!font->renderGlyph(ch, resolutionInDPI, color, &g))
+      return 0;
+    it = glyphs.insert(key, g);
+  }
+  return &it.value();
+}
+
+
 /** Routine to print characters.  */
 
-void dviRenderer::set_char(unsigned int cmd, unsigned int ch)
+void dviRenderContext::set_char(unsigned int cmd, unsigned int ch)
 {
 #ifdef DEBUG_RENDER
   kDebug(kvs::dvi) << "set_char #" << ch;
 #endif
 
-  glyph *g;
-  if (colorStack.isEmpty())
-    g = ((TeXFont *)(currinf.fontp->font))->getGlyph(ch, true, globalColor);
-  else
-    g = ((TeXFont *)(currinf.fontp->font))->getGlyph(ch, true, colorStack.top());
+  glyph *g = shrunkenGlyph(ch);
   if (g == NULL)
     return;
 
@@ -197,15 +240,15 @@ void dviRenderer::set_char(unsigned int cmd, unsigned int ch)
   line_boundary_encountered = false;
 }
 
-void dviRenderer::set_empty_char(unsigned int, unsigned int)
+void dviRenderContext::set_empty_char(unsigned int, unsigned int)
 {
   return;
 }
 
-void dviRenderer::set_vf_char(unsigned int cmd, unsigned int ch)
+void dviRenderContext::set_vf_char(unsigned int cmd, unsigned int ch)
 {
 #ifdef DEBUG_RENDER
-  kDebug(kvs::dvi) << "dviRenderer::set_vf_char( cmd=" << cmd << ", ch=" << ch << " )";
+  kDebug(kvs::dvi) << "dviRenderContext::set_vf_char( cmd=" << cmd << ", ch=" << ch << " )";
 #endif
 
   static unsigned char   c;
@@ -243,10 +286,10 @@ void dviRenderer::set_vf_char(unsigned int cmd, unsigned int ch)
 }
 
 
-void dviRenderer::set_no_char(unsigned int cmd, unsigned int ch)
+void dviRenderContext::set_no_char(unsigned int cmd, unsigned int ch)
 {
 #ifdef DEBUG_RENDER
-  kDebug(kvs::dvi) << "dviRenderer::set_no_char( cmd=" << cmd << ", ch =" << ch << " )" ;
+  kDebug(kvs::dvi) << "dviRenderContext::set_no_char( cmd=" << cmd << ", ch =" << ch << " )" ;
 #endif
 
   if (currinf._virtual) {
@@ -263,7 +306,7 @@ void dviRenderer::set_no_char(unsigned int cmd, unsigned int ch)
 }
 
 
-void dviRenderer::draw_part(double current_dimconv, bool is_vfmacro)
+void dviRenderContext::draw_part(double current_dimconv, bool is_vfmacro)
 {
 #ifdef DEBUG_RENDER
   kDebug(kvs::dvi) << "draw_part";
@@ -273,7 +316,7 @@ void dviRenderer::draw_part(double current_dimconv, bool is_vfmacro)
   quint8 ch;
 
   currinf.fontp        = NULL;
-  currinf.set_char_p   = &dviRenderer::set_no_char;
+  currinf.set_char_p   = &dviRenderContext::set_no_char;
 
   int last_space_index = 0;
   bool space_encountered = false;
@@ -619,7 +662,7 @@ void dviRenderer::draw_part(double current_dimconv, bool is_vfmacro)
 }
 
 
-void dviRenderer::draw_page()
+void dviRenderContext::draw_page()
 {
   // Reset a couple of variables
   HTML_href         = 0;
@@ -656,7 +699,7 @@ void dviRenderer::draw_page()
   if (!accessibilityBackground)
   {
 #endif
-    foreGroundPainter->fillRect( foreGroundPainter->viewport(), PS_interface->getBackgroundColor(current_page) );
+    foreGroundPainter->fillRect( foreGroundPainter->viewport(), renderer->PS_interface->getBackgroundColor(current_page) );
 #if 0
   }
   else
@@ -675,13 +718,13 @@ void dviRenderer::draw_page()
     {
       // Flag permanent is set to false because otherwise we would not be able to restore
       // the original background color.
-      PS_interface->setBackgroundColor(current_page, accessibilityBackgroundColor, false);
+      renderer->PS_interface->setBackgroundColor(current_page, accessibilityBackgroundColor, false);
     }
     else
 #endif
-      PS_interface->restoreBackgroundColor(current_page);
+      renderer->PS_interface->restoreBackgroundColor(current_page);
 
-    PS_interface->graphics(current_page, resolutionInDPI, dviFile->getMagnification(), foreGroundPainter);
+    renderer->PS_interface->graphics(current_page, resolutionInDPI, dviFile->getMagnification(), foreGroundPainter);
   }
 
   // Now really write the text
@@ -602,16 +602,16 @@ void dviRenderer::prescan_setChar(unsigned int ch)
   if (fontp == NULL)
     return;
 
-  if (currinf.set_char_p == &dviRenderer::set_char) {
-    glyph *g = ((TeXFont *)(currinf.fontp->font))->getGlyph(ch, true, globalColor);
-    if (g == NULL)
+  if (currinf.set_char_p == &dviRenderContext::set_char) {
+    glyph g;
+    if (!((TeXFont *)(currinf.fontp->font))->renderGlyph(ch, resolutionInDPI, Qt::black, &g))
       return;
     currinf.data.dvi_h += (int)(currinf.fontp->scaled_size_in_DVI_units * dviFile->getCmPerDVIunit() *
-                                (1200.0 / 2.54)/16.0 * g->dvi_advance_in_units_of_design_size_by_2e20 + 0.5);
+                                (1200.0 / 2.54)/16.0 * g.dvi_advance_in_units_of_design_size_by_2e20 + 0.5);
     return;
   }
 
-  if (currinf.set_char_p == &dviRenderer::set_vf_char) {
+  if (currinf.set_char_p == &dviRenderContext::set_vf_char) {
     macro *m = &currinf.fontp->macrotable[ch];
     if (m->pos == NULL)
       return;
@@ -638,7 +638,7 @@ void dviRenderer::prescan(parseSpecials specialParser)
   stack.clear();
 
   currinf.fontp        = NULL;
-  currinf.set_char_p   = &dviRenderer::set_no_char;
+  currinf.set_char_p   = &dviRenderContext::set_no_char;
 
   for (;;) {
     ch = readUINT8();
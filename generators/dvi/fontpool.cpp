@@ -13,8 +13,12 @@
 
 #include <klocale.h>
 #include <kmessagebox.h>
+#include <kstandarddirs.h>
 
 #include <QApplication>
+#include <QDataStream>
+#include <QFile>
+#include <QFileInfo>
 #include <QPainter>
 
 #include <cmath>
@@ -34,8 +38,12 @@ QTime fontPoolTimer;
 bool fontPoolTimerFlag;
 #endif
 
+// the memory for the shrunken characters, in bytes
+static const int maxGlyphCacheCost = 16 * 1024 * 1024;
+
 fontPool::fontPool(bool useFontHinting)
-  :  progress("fontgen",  // Chapter in the documentation for help.
+  :  glyphs(maxGlyphCacheCost),
+     progress("fontgen",  // Chapter in the documentation for help.
               i18n("Okular is currently generating bitmap fonts..."),
               i18n("Aborts the font generation. Do not do this."),
               i18n("Okular is currently generating bitmap fonts which are needed to display your document. "
@@ -53,6 +61,7 @@ fontPool::fontPool(bool useFontHinting)
   displayResolution_in_dpi = 100.0; // A not-too-bad-default
   useFontHints             = useFontHinting;
   CMperDVIunit             = 0;
+  fontFileCacheLoaded      = false;
   extraSearchPath.clear();
 
 #ifdef HAVE_FREETYPE
@@ -120,6 +129,8 @@ fontPool::~fontPool()
 
 void fontPool::setParameters( bool _useFontHints )
 {
+  QMutexLocker locker(&mutex);
+
   // Check if glyphs need to be cleared
   if (_useFontHints != useFontHints) {
     double displayResolution = displayResolution_in_dpi;
@@ -128,6 +139,7 @@ void fontPool::setParameters( bool _useFontHints )
       TeXFontDefinition *fontp = *it_fontp;
       fontp->setDisplayResolution(displayResolution * fontp->enlargement);
     }
+    glyphs.clear();
   }
 
   useFontHints = _useFontHints;
@@ -195,6 +207,9 @@ void fontPool::locateFonts()
 {
   kpsewhichOutput.clear();
 
+  // The fonts located for a previous document need no kpsewhich run.
+  locateFontsFromCache();
+
   // First, we try and find those fonts which exist on disk
   // already. If virtual fonts are found, they will add new fonts to
   // the list of fonts whose font files need to be located, so that we
@@ -216,6 +231,8 @@ void fontPool::locateFonts()
   if (!areFontsLocated())
     locateFonts(false, true);
 
+  updateFontFileCache();
+
   // If still not all fonts are found, we give up. We mark all fonts
   // as 'located', so that we won't look for them any more, and
   // present an error message to the user.
@@ -376,6 +393,139 @@ void fontPool::locateFonts(bool makePK, bool locateTFMonly, bool *virtualFontsFo
 }
 
 
+// The file of the cache, and its format
+static const char fontFileCacheName[] = "okular/dvi/fontfiles";
+static const quint32 fontFileCacheMagic = 0x4f4b4446;
+static const quint32 fontFileCacheVersion = 1;
+
+
+QString fontPool::fontFileCacheKey(const TeXFontDefinition *fontp, const QString &directory)
+{
+  // the files are located for PK fonts at 1200 dpi, as in locateFonts(bool, bool, bool *)
+  const QString key = QString("%1 1200 %2").arg(fontp->fontname).arg(fontp->enlargement);
+  return directory.isEmpty() ? key : key + ' ' + directory;
+}
+
+
+void fontPool::loadFontFileCache()
+{
+  if (fontFileCacheLoaded)
+    return;
+  fontFileCacheLoaded = true;
+
+  QFile file(KStandardDirs::locateLocal("cache", fontFileCacheName));
+  if (!file.open(QIODevice::ReadOnly))
+    return;
+
+  QDataStream stream(&file);
+  stream.setVersion(QDataStream::Qt_4_6);
+  quint32 magic, version;
+  stream >> magic >> version;
+  if (magic != fontFileCacheMagic || version != fontFileCacheVersion)
+    return;
+
+  stream >> fontFileCache;
+  if (stream.status() != QDataStream::Ok)
+    fontFileCache.clear();
+}
+
+
+void fontPool::locateFontsFromCache()
+{
+  loadFontFileCache();
+  if (fontFileCache.isEmpty())
+    return;
+
+  const QString directory = extraSearchPath.isEmpty() ? QString() : QFileInfo(extraSearchPath).absoluteFilePath();
+  QList<TeXFontDefinition*>::iterator it_fontp = fontList.begin();
+  while (it_fontp != fontList.end()) {
+    TeXFontDefinition *fontp = *it_fontp;
+    ++it_fontp;
+    if (fontp->isLocated() || !fontp->filename.isEmpty())
+      continue;
+
+    // A font found in the directory of the document is cached for
+    // that directory only.
+    QString key = fontFileCacheKey(fontp, directory);
+    QHash<QString, QPair<QString, QDateTime> >::const_iterator cached = fontFileCache.constFind(key);
+    if (directory.isEmpty() || cached == fontFileCache.constEnd()) {
+      key = fontFileCacheKey(fontp);
+      cached = fontFileCache.constFind(key);
+      if (cached == fontFileCache.constEnd())
+        continue;
+    }
+
+    const QString fname = cached.value().first;
+    const QFileInfo info(fname);
+    if (!info.exists() || info.lastModified() != cached.value().second) {
+      fontFileCache.remove(key);
+      continue;
+    }
+
+    // kpsewhich looks in the directory of the document first, which
+    // may hold a file of the same name as the cached one.
+    if (!directory.isEmpty() && info.absolutePath() != directory &&
+        QFile::exists(directory + '/' + info.fileName()))
+      continue;
+
+#ifdef DEBUG_FONTPOOL
+    kDebug(kvs::dvi) << "Associated " << fontp->fontname << " to " << fname << " from the cache";
+#endif
+    fontp->fontNameReceiver(fname);
+    fontp->flags |= TeXFontDefinition::FONT_KPSE_NAME;
+    if (fname.endsWith(".vf")) {
+      // The virtual font inserted its fonts into the fontList, start
+      // over to look for them too.
+      it_fontp = fontList.begin();
+    }
+  }
+}
+
+
+void fontPool::updateFontFileCache()
+{
+  bool changed = false;
+
+  const QString directory = extraSearchPath.isEmpty() ? QString() : QFileInfo(extraSearchPath).absoluteFilePath();
+  QList<TeXFontDefinition*>::const_iterator cit_fontp = fontList.constBegin();
+  for (; cit_fontp != fontList.constEnd(); ++cit_fontp) {
+    TeXFontDefinition *fontp = *cit_fontp;
+    if (fontp->filename.isEmpty() || fontp->filename.endsWith(".tfm"))
+      continue;
+
+    const QFileInfo info(fontp->filename);
+    if (!info.exists())
+      continue;
+
+    const QPair<QString, QDateTime> entry(info.absoluteFilePath(), info.lastModified());
+    const QString key = fontFileCacheKey(fontp, info.absolutePath() == directory ? directory : QString());
+    if (fontFileCache.value(key) != entry) {
+      fontFileCache.insert(key, entry);
+      changed = true;
+    }
+  }
+
+  if (!changed)
+    return;
+
+  // Write next to the cache and rename when complete, so that another
+  // instance never reads a partial file.
+  const QString fileName = KStandardDirs::locateLocal("cache", fontFileCacheName);
+  QFile file(QString("%1.%2.part").arg(fileName).arg(QCoreApplication::applicationPid()));
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    return;
+
+  QDataStream stream(&file);
+  stream.setVersion(QDataStream::Qt_4_6);
+  stream << fontFileCacheMagic << fontFileCacheVersion << fontFileCache;
+  file.close();
+
+  QFile::remove(fileName);
+  if (stream.status() != QDataStream::Ok || file.error() != QFile::NoError || !file.rename(fileName))
+    file.remove();
+}
+
+
 void fontPool::setCMperDVIunit( double _CMperDVI )
 {
 #ifdef DEBUG_FONTPOOL
@@ -385,6 +535,7 @@ void fontPool::setCMperDVIunit( double _CMperDVI )
   if (CMperDVIunit == _CMperDVI)
     return;
 
+  QMutexLocker locker(&mutex);
   CMperDVIunit = _CMperDVI;
 
   QList<TeXFontDefinition*>::iterator it_fontp = fontList.begin();
@@ -412,6 +563,7 @@ void fontPool::setDisplayResolution( double _displayResolution_in_dpi )
     return;
   }
 
+  QMutexLocker locker(&mutex);
   displayResolution_in_dpi = _displayResolution_in_dpi;
   double displayResolution = displayResolution_in_dpi;
 
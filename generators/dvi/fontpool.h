@@ -10,10 +10,14 @@
 #include "fontEncodingPool.h"
 #include "fontMap.h"
 #include "fontprogress.h"
+#include "glyph.h"
 #include "TeXFontDefinition.h"
 
+#include <QDateTime>
+#include <QHash>
 #include <QList>
 #include <QObject>
+#include <QPair>
 #include <QProcess>
 
 #ifdef HAVE_FREETYPE
@@ -123,6 +127,14 @@ public:
       drawing routines for the different setups. */
   bool QPixmapSupportsAlpha;
 
+  /** The shrunken characters of all the fonts, at all the resolutions
+      used so far. */
+  glyphCache glyphs;
+
+  /** Guards the display resolution and the glyph tables of the fonts,
+      which are shared by the pages rendered at the same time. */
+  QMutex mutex;
+
 signals:
   /** Passed through to the top-level kpart. */
   void setStatusBarText( const QString& );
@@ -171,6 +183,31 @@ private:
   // virtual font is found, the variable remains untouched.
   void locateFonts(bool makePK, bool locateTFMonly, bool *virtualFontsFound=0);
 
+  /** Members used for the persistent cache of the font files */
+
+  // Associates the fonts that are not located yet with the files found
+  // for them before, for this or another document, if these files
+  // still exist and were not modified since. This way, kpsewhich runs
+  // only for the fonts never seen before.
+  void locateFontsFromCache();
+
+  // Adds the files of the fonts located by kpsewhich to the cache, and
+  // writes it to the disk if anything changed. The TFM files, which
+  // are only a last resort, are not kept.
+  void updateFontFileCache();
+
+  // Returns the key of a font in the cache. The fonts found in the
+  // directory of the document are kept under a key with that directory.
+  static QString fontFileCacheKey(const TeXFontDefinition *fontp, const QString &directory = QString());
+
+  // Reads the cache from the disk, once
+  void loadFontFileCache();
+
+  // The cache of the font files: for each font, the file and its
+  // modification time
+  QHash<QString, QPair<QString, QDateTime> > fontFileCache;
+  bool fontFileCacheLoaded;
+
   // This QString is used internally by the mf_output_receiver()
   // method.  This string is set to QString() in locateFonts(bool,
   // bool, bool *). Values are set and read by the
@@ -81,6 +81,7 @@ bool DviGenerator::loadDocument( const QString & fileName, QVector< Okular::Page
     (void)userMutex();
 
     m_dviRenderer = new dviRenderer(documentMetaData("TextHinting", QVariant()).toBool());
+    connect( m_dviRenderer, SIGNAL(graphicsReady(int)), this, SLOT(graphicsReady(int)) );
 #ifdef DVI_OPEN_BUSYLOOP
     static const ushort s_waitTime = 800; // milliseconds
     static const int s_maxIterations = 10;
@@ -226,8 +227,7 @@ QImage DviGenerator::image( Okular::PixmapRequest *request )
 
 //  pageInfo->resolution = m_resolution;
 
-    QMutexLocker lock( userMutex() );
-
+    // every page is drawn with a context of its own, no need to lock
     if ( m_dviRenderer )
     {
         SimplePageSize s = m_dviRenderer->sizeOfPage( pageInfo->pageNumber );
@@ -266,13 +266,17 @@ QImage DviGenerator::image( Okular::PixmapRequest *request )
         }
     }
 
-    lock.unlock();
-
     delete pageInfo;
 
     return ret;
 }
 
+void DviGenerator::graphicsReady( int page )
+{
+    // the pages drawn without their PostScript graphics need a new pixmap
+    emit pageContentsChanged( page - 1 );
+}
+
 Okular::TextPage* DviGenerator::textPage( Okular::Page *page )
 {
     kDebug(DviDebug);
@@ -286,8 +290,6 @@ Okular::TextPage* DviGenerator::textPage( Okular::Page *page )
 
     pageInfo->resolution = m_resolution;
 
-    QMutexLocker lock( userMutex() );
-
     // get page text from m_dviRenderer
     Okular::TextPage *ktp = 0;
     if ( m_dviRenderer )
@@ -296,7 +298,6 @@ Okular::TextPage* DviGenerator::textPage( Okular::Page *page )
         pageInfo->resolution = (double)(pageInfo->width)/ps.width().getLength_in_inch();
 
         m_dviRenderer->getText( pageInfo );
-        lock.unlock();
 
         ktp = extractTextFromPage( pageInfo );
     }
@@ -48,6 +48,9 @@ class DviGenerator : public Okular::Generator
         QImage image( Okular::PixmapRequest * request );
         Okular::TextPage* textPage( Okular::Page *page );
 
+    private slots:
+        void graphicsReady( int page );
+
     private:
         double m_resolution;
         bool m_fontExtracted;
@@ -36,3 +36,63 @@ glyph::glyph()
 
 glyph::~glyph()
 {}
+
+
+glyphCache::glyphCache(int maxCostInBytes)
+  : cache(maxCostInBytes)
+{
+}
+
+glyphCacheKey glyphCache::key(const void *font, quint16 ch, double resolution, const QColor &color)
+{
+  glyphCacheKey k;
+  k.font = font;
+  k.character = ch;
+  k.resolution = qRound64(resolution * 1000.0);
+  k.color = color.rgba();
+  return k;
+}
+
+bool glyphCache::find(const void *font, quint16 ch, double resolution, const QColor &color, glyph *g)
+{
+  QMutexLocker locker(&mutex);
+  const entry *e = cache.object(key(font, ch, resolution, color));
+  if (e == 0)
+    return false;
+
+  g->shrunkenCharacter = e->shrunkenCharacter;
+  g->x2 = e->x2;
+  g->y2 = e->y2;
+  g->dvi_advance_in_units_of_design_size_by_2e20 = e->dvi_advance_in_units_of_design_size_by_2e20;
+  g->color = color;
+  return true;
+}
+
+void glyphCache::insert(const void *font, quint16 ch, double resolution, const glyph *g)
+{
+  if (g->shrunkenCharacter.isNull())
+    return;
+
+  entry *e = new entry;
+  e->shrunkenCharacter = g->shrunkenCharacter;
+  e->x2 = g->x2;
+  e->y2 = g->y2;
+  e->dvi_advance_in_units_of_design_size_by_2e20 = g->dvi_advance_in_units_of_design_size_by_2e20;
+
+  QMutexLocker locker(&mutex);
+  cache.insert(key(font, ch, resolution, g->color), e, e->shrunkenCharacter.byteCount());
+}
+
+void glyphCache::removeFont(const void *font)
+{
+  QMutexLocker locker(&mutex);
+  foreach(const glyphCacheKey &k, cache.keys())
+    if (k.font == font)
+      cache.remove(k);
+}
+
+void glyphCache::clear()
+{
+  QMutexLocker locker(&mutex);
+  cache.clear();
+}
@@ -3,8 +3,10 @@
 #ifndef _GLYPH_H
 #define _GLYPH_H
 
+#include <QCache>
 #include <QColor>
 #include <QImage>
+#include <QMutex>
 
 
 struct bitmap {
@@ -41,4 +43,69 @@ class glyph {
   short   x2, y2;
 };
 
+
+/** Identifies a shrunken character in the glyphCache. */
+struct glyphCacheKey {
+  const void *font;
+  quint16 character;
+  // display resolution in 1/1000 dpi
+  qint64 resolution;
+  QRgb color;
+
+  bool operator==(const glyphCacheKey &other) const
+  {
+    return font == other.font && character == other.character &&
+      resolution == other.resolution && color == other.color;
+  }
+};
+
+inline uint qHash(const glyphCacheKey &key)
+{
+  return qHash(key.font) ^ (key.character << 16) ^ qHash(quint64(key.resolution)) ^ key.color;
+}
+
+
+/**
+ * A cache of the shrunken characters of the fonts of a document, for
+ * any resolution and color
+ *
+ * The pages rendered at the same time look their characters up here
+ * first, without taking the lock of the font pool, so that zooming
+ * back to a previous level does not shrink the characters again. The
+ * cache is bounded in bytes, and can be used from several threads.
+ */
+class glyphCache {
+ public:
+  glyphCache(int maxCostInBytes);
+
+  /** If the cache holds the character @p ch of @p font at the given
+      @p resolution and @p color, this method sets the shrunken
+      character, its offsets and its advance in @p g, and returns
+      true. */
+  bool find(const void *font, quint16 ch, double resolution, const QColor &color, glyph *g);
+
+  /** Adds the shrunken character of @p g to the cache. */
+  void insert(const void *font, quint16 ch, double resolution, const glyph *g);
+
+  /** Returns the key of the character @p ch of @p font at the given
+      @p resolution and @p color. */
+  static glyphCacheKey key(const void *font, quint16 ch, double resolution, const QColor &color);
+
+  /** Removes all the characters of @p font. */
+  void removeFont(const void *font);
+
+  /** Removes all the characters. */
+  void clear();
+
+ private:
+  struct entry {
+    QImage shrunkenCharacter;
+    short x2, y2;
+    qint32 dvi_advance_in_units_of_design_size_by_2e20;
+  };
+
+  QMutex mutex;
+  QCache<glyphCacheKey, entry> cache;
+};
+
 #endif //ifndef _GLYPH_H
@@ -15,20 +15,59 @@
 #include "kvs_debug.h"
 #include "pageNumber.h"
 
+#include <core/utils.h>
+
 #include <klocale.h>
 #include <kmessagebox.h>
 #include <kprocess.h>
+#include <kstandarddirs.h>
 #include <ktemporaryfile.h>
 #include <kurl.h>
 
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
 #include <QDir>
 #include <QPainter>
 #include <QPixmap>
+#include <QRegExp>
 #include <QTextStream>
 #include <QTimer>
+#include <QtConcurrentRun>
 
 //#define DEBUG_PSGS
 
+// The maximal size, in bytes, of the rendered graphics kept on disk
+static const qint64 graphicsCacheSize = 64 * 1024 * 1024;
+
+// The files already found by kpsewhich, which is slow to start
+static QMutex epsFilesMutex;
+static QHash<QString, QString> epsFiles;
+
+// The files that a PostScript program runs are only referenced by their
+// name, so their size and modification time have to be part of the key of
+// the graphics cache for an edited figure to be rendered again
+static QByteArray referencedFilesSignature(const QString &program, const QString &includePath)
+{
+  QString includeDir;
+  if (includePath.endsWith("/*"))
+    includeDir = includePath.left(includePath.length() - 2);
+
+  QByteArray signature;
+  QRegExp fileReference("\\(([^()]+)\\)\\s*(run|file)\\b");
+  int pos = 0;
+  while ((pos = fileReference.indexIn(program, pos)) != -1) {
+    const QString name = fileReference.cap(1);
+    QFileInfo fi(name);
+    if (fi.isRelative() && !includeDir.isEmpty())
+      fi = QFileInfo(QDir(includeDir), name);
+    if (fi.exists())
+      signature += QString("%1 %2 %3\n").arg(fi.absoluteFilePath()).arg(fi.size()).arg(fi.lastModified().toTime_t()).toUtf8();
+    pos += fileReference.matchedLength();
+  }
+  return signature;
+}
+
 //extern char psheader[];
 
 pageInfo::pageInfo(const QString& _PostScriptString) {
@@ -46,7 +85,8 @@ pageInfo::~pageInfo() {
 
 // ======================================================
 
-ghostscript_interface::ghostscript_interface() {
+ghostscript_interface::ghostscript_interface()
+  : stopping(false) {
 
   PostScriptHeaderString = new QString();
 
@@ -58,6 +98,12 @@ ghostscript_interface::ghostscript_interface() {
 }
 
 ghostscript_interface::~ghostscript_interface() {
+  // The jobs which did not start yet return immediately
+  jobMutex.lock();
+  stopping = true;
+  jobMutex.unlock();
+  jobs.waitForFinished();
+
   if (PostScriptHeaderString != 0L)
     delete PostScriptHeaderString;
   qDeleteAll(pageList);
@@ -145,27 +191,9 @@ void ghostscript_interface::clear() {
 }
 
 
-void ghostscript_interface::gs_generate_graphics_file(const PageNumber& page, const QString& filename, long magnification) {
-#ifdef DEBUG_PSGS
-  kDebug(kvs::dvi) << "ghostscript_interface::gs_generate_graphics_file( " << page << ", " << filename << " )";
-#endif
-
-  if (knownDevices.isEmpty()) {
-    kError(kvs::dvi) << "No known devices found" << endl;
-    return;
-  }
-
-  pageInfo *info = pageList.value(page);
-
-  // Generate a PNG-file
-  // Step 1: Write the PostScriptString to a File
-  KTemporaryFile PSfile;
-  PSfile.setAutoRemove(false);
-  PSfile.setSuffix(".ps");
-  PSfile.open();
-  const QString PSfileName = PSfile.fileName();
-
-  QTextStream os(&PSfile);
+QString ghostscript_interface::pageProgram(const pageInfo *info, long magnification, int pixel_page_w, int pixel_page_h, double resolution) const {
+  QString program;
+  QTextStream os(&program);
   os << "%!PS-Adobe-2.0\n"
      << "%%Creator: kdvi\n"
      << "%%Title: KDVI temporary PostScript\n"
@@ -210,88 +238,149 @@ void ghostscript_interface::gs_generate_graphics_file(const PageNumber& page, co
 
   os << "end\n"
      << "showpage \n";
+  os.flush();
+
+  return program;
+}
 
-  PSfile.close();
 
-  // Step 2: Call GS with the File
-  QFile::remove(filename.toAscii());
-  KProcess proc;
-  proc.setOutputChannelMode(KProcess::SeparateChannels);
-  QStringList argus;
-  argus << "gs";
-  argus << "-dSAFER" << "-dPARANOIDSAFER" << "-dDELAYSAFER" << "-dNOPAUSE" << "-dBATCH";
-  argus << QString("-sDEVICE=%1").arg(*gsDevice);
-  argus << QString("-sOutputFile=%1").arg(filename);
-  argus << QString("-sExtraIncludePath=%1").arg(includePath);
-  argus << QString("-g%1x%2").arg(pixel_page_w).arg(pixel_page_h); // page size in pixels
-  argus << QString("-r%1").arg(resolution);                       // resolution in dpi
-  argus << "-dTextAlphaBits=4 -dGraphicsAlphaBits=2"; // Antialiasing
-  argus << "-c" << "<< /PermitFileReading [ ExtraIncludePath ] /PermitFileWriting [] /PermitFileControl [] >> setuserparams .locksafe";
-  argus << "-f" << PSfileName;
+void ghostscript_interface::gs_generate_graphics_file(const graphicsJob &job) {
+#ifdef DEBUG_PSGS
+  kDebug(kvs::dvi) << "ghostscript_interface::gs_generate_graphics_file( " << job.page << ", " << job.fileName << " )";
+#endif
+
+  bool done = false;
+  forever {
+    QString device;
+    {
+      QMutexLocker locker(&jobMutex);
+      if (stopping)
+        break;
+      if (knownDevices.isEmpty()) {
+        kError(kvs::dvi) << "No known devices found" << endl;
+        break;
+      }
+      device = *gsDevice;
+    }
+
+    // Generate a PNG-file
+    // Step 1: Write the PostScript program to a File
+    KTemporaryFile PSfile;
+    PSfile.setAutoRemove(false);
+    PSfile.setSuffix(".ps");
+    PSfile.open();
+    const QString PSfileName = PSfile.fileName();
+
+    QTextStream os(&PSfile);
+    os << job.PostScript;
+    os.flush();
+    PSfile.close();
+
+    // Step 2: Call GS with the File. The output is written next to
+    // the cache file and renamed when complete, so that graphics()
+    // never sees a partial image.
+    const QString partFileName = QString("%1.%2.part").arg(job.fileName).arg(QCoreApplication::applicationPid());
+    QFile::remove(partFileName);
+    KProcess proc;
+    proc.setOutputChannelMode(KProcess::SeparateChannels);
+    QStringList argus;
+    argus << "gs";
+    argus << "-dSAFER" << "-dPARANOIDSAFER" << "-dDELAYSAFER" << "-dNOPAUSE" << "-dBATCH";
+    argus << QString("-sDEVICE=%1").arg(device);
+    argus << QString("-sOutputFile=%1").arg(partFileName);
+    argus << QString("-sExtraIncludePath=%1").arg(job.includePath);
+    argus << QString("-g%1x%2").arg(job.pixel_page_w).arg(job.pixel_page_h); // page size in pixels
+    argus << QString("-r%1").arg(job.resolution);                       // resolution in dpi
+    argus << "-dTextAlphaBits=4 -dGraphicsAlphaBits=2"; // Antialiasing
+    argus << "-c" << "<< /PermitFileReading [ ExtraIncludePath ] /PermitFileWriting [] /PermitFileControl [] >> setuserparams .locksafe";
+    argus << "-f" << PSfileName;
 
 #ifdef DEBUG_PSGS
-  kDebug(kvs::dvi) << argus.join(" ");
+    kDebug(kvs::dvi) << argus.join(" ");
 #endif
- 
-  proc << argus;
-  int res = proc.execute();
-  
-  if ( res ) {
-    // Starting ghostscript did not work. 
-    // TODO: Issue error message, switch PS support off.
-    kError(kvs::dvi) << "ghostview could not be started" << endl;
-  } 
-
-  PSfile.remove();
-
- // Check if gs has indeed produced a file.
-  if (QFile::exists(filename) == false) {
+
+    proc << argus;
+    int res = proc.execute();
+
+    if ( res ) {
+      // Starting ghostscript did not work.
+      // TODO: Issue error message, switch PS support off.
+      kError(kvs::dvi) << "ghostview could not be started" << endl;
+    }
+
+    PSfile.remove();
+
+    // Check if gs has indeed produced a file.
+    if (QFile::exists(partFileName)) {
+      QFile::remove(job.fileName);
+      done = QFile::rename(partFileName, job.fileName);
+      if (!done)
+        QFile::remove(partFileName);
+      break;
+    }
+
     kError(kvs::dvi) << "GS did not produce output." << endl;
 
     // No. Check is the reason is that the device is not compiled into
     // ghostscript. If so, try again with another device.
-    QString GSoutput;
+    bool unknownDevice = false;
     proc.setReadChannel(QProcess::StandardOutput);
     while(proc.canReadLine()) {
-      GSoutput = QString::fromLocal8Bit(proc.readLine());
+      const QString GSoutput = QString::fromLocal8Bit(proc.readLine());
       if (GSoutput.contains("Unknown device")) {
-	kDebug(kvs::dvi) << QString("The version of ghostview installed on this computer does not support "
-                                     "the '%1' ghostview device driver.").arg(*gsDevice) << endl;
-	knownDevices.erase(gsDevice);
-	gsDevice = knownDevices.begin();
-	if (knownDevices.isEmpty())
-	  // TODO: show a requestor of some sort.
+        unknownDevice = true;
+        break;
+      }
+    }
+    if (!unknownDevice)
+      break;
+
+    kDebug(kvs::dvi) << QString("The version of ghostview installed on this computer does not support "
+                                 "the '%1' ghostview device driver.").arg(device) << endl;
+    QMutexLocker locker(&jobMutex);
+    // another job may have dropped the device already
+    knownDevices.removeAll(device);
+    gsDevice = knownDevices.begin();
+    if (knownDevices.isEmpty()) {
+      // TODO: show a requestor of some sort.
 #if 0
-	  KMessageBox::detailedError(0, 
-				     i18n("<qt>The version of Ghostview that is installed on this computer does not contain "
-					  "any of the Ghostview device drivers that are known to Okular. PostScript "
-					  "support has therefore been turned off in Okular.</qt>"), 
-				     i18n("<qt><p>The Ghostview program, which Okular uses internally to display the "
-					  "PostScript graphics that is included in this DVI file, is generally able to "
-					  "write its output in a variety of formats. The sub-programs that Ghostview uses "
-					  "for these tasks are called 'device drivers'; there is one device driver for "
-					  "each format that Ghostview is able to write. Different versions of Ghostview "
-					  "often have different sets of device drivers available. It seems that the "
-					  "version of Ghostview that is installed on this computer does not contain "
-					  "<strong>any</strong> of the device drivers that are known to Okular.</p>"
-					  "<p>It seems unlikely that a regular installation of Ghostview would not contain "
-					  "these drivers. This error may therefore point to a serious misconfiguration of "
-					  "the Ghostview installation on your computer.</p>"
-					  "<p>If you want to fix the problems with Ghostview, you can use the command "
-					  "<strong>gs --help</strong> to display the list of device drivers contained in "
-					  "Ghostview. Among others, Okular can use the 'png256', 'jpeg' and 'pnm' "
-					  "drivers. Note that Okular needs to be restarted to re-enable PostScript support."
-					  "</p></qt>"));
-#else
-	{}
+      KMessageBox::detailedError(0,
+                                 i18n("<qt>The version of Ghostview that is installed on this computer does not contain "
+                                      "any of the Ghostview device drivers that are known to Okular. PostScript "
+                                      "support has therefore been turned off in Okular.</qt>"),
+                                 i18n("<qt><p>The Ghostview program, which Okular uses internally to display the "
+                                      "PostScript graphics that is included in this DVI file, is generally able to "
+                                      "write its output in a variety of formats. The sub-programs that Ghostview uses "
+                                      "for these tasks are called 'device drivers'; there is one device driver for "
+                                      "each format that Ghostview is able to write. Different versions of Ghostview "
+                                      "often have different sets of device drivers available. It seems that the "
+                                      "version of Ghostview that is installed on this computer does not contain "
+                                      "<strong>any</strong> of the device drivers that are known to Okular.</p>"
+                                      "<p>It seems unlikely that a regular installation of Ghostview would not contain "
+                                      "these drivers. This error may therefore point to a serious misconfiguration of "
+                                      "the Ghostview installation on your computer.</p>"
+                                      "<p>If you want to fix the problems with Ghostview, you can use the command "
+                                      "<strong>gs --help</strong> to display the list of device drivers contained in "
+                                      "Ghostview. Among others, Okular can use the 'png256', 'jpeg' and 'pnm' "
+                                      "drivers. Note that Okular needs to be restarted to re-enable PostScript support."
+                                      "</p></qt>"));
 #endif
-	else {
-	  kDebug(kvs::dvi) << QString("Okular will now try to use the '%1' device driver.").arg(*gsDevice);
-	  gs_generate_graphics_file(page, filename, magnification);
-	}
-	return;
-      }
+      break;
     }
+    kDebug(kvs::dvi) << QString("Okular will now try to use the '%1' device driver.").arg(*gsDevice);
+  }
+
+  {
+    QMutexLocker locker(&jobMutex);
+    pendingFiles.remove(job.fileName);
+    if (!done)
+      failedFiles.insert(job.fileName);
+  }
+
+  if (done) {
+    // Remove the least recently written files above the size limit
+    Okular::Utils::pruneCacheDirectory(QFileInfo(job.fileName).absolutePath(), graphicsCacheSize, QStringList());
+    emit graphicsReady(job.page);
   }
 }
 
@@ -306,11 +395,6 @@ void ghostscript_interface::graphics(const PageNumber& page, double dpi, long ma
     return;
   }
 
-  resolution   = dpi;
-
-  pixel_page_w = paint->viewport().width();
-  pixel_page_h = paint->viewport().height();
-
   pageInfo *info = pageList.value(page);
 
   // No PostScript? Then return immediately.
@@ -321,17 +405,39 @@ void ghostscript_interface::graphics(const PageNumber& page, double dpi, long ma
     return;
   }
 
-  QTemporaryFile gfxFile;
-  gfxFile.open();
-  const QString gfxFileName = gfxFile.fileName();
-  // We are want the filename, not the file.
-  gfxFile.close();
-
-  gs_generate_graphics_file(page, gfxFileName, magnification);
-  
-  QImage MemoryCopy(gfxFileName);
-  paint->drawImage(0, 0, MemoryCopy);
-  return;
+  graphicsJob job;
+  job.page         = page;
+  job.resolution   = dpi;
+  job.pixel_page_w = paint->viewport().width();
+  job.pixel_page_h = paint->viewport().height();
+  job.PostScript   = pageProgram(info, magnification, job.pixel_page_w, job.pixel_page_h, job.resolution);
+  job.includePath  = includePath;
+
+  // The include path is where the included graphics files come from
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  hash.addData(job.PostScript.toUtf8());
+  hash.addData(QString("%1 %2x%3 %4").arg(job.resolution).arg(job.pixel_page_w).arg(job.pixel_page_h).arg(job.includePath).toUtf8());
+  hash.addData(referencedFilesSignature(job.PostScript, job.includePath));
+  job.fileName = KStandardDirs::locateLocal("cache", "okular/dvi/graphics/") + hash.result().toHex();
+
+  QMutexLocker locker(&jobMutex);
+  if (pendingFiles.contains(job.fileName) || failedFiles.contains(job.fileName))
+    return;
+
+  if (QFile::exists(job.fileName)) {
+    locker.unlock();
+    QImage MemoryCopy(job.fileName);
+    if (!MemoryCopy.isNull()) {
+      paint->drawImage(0, 0, MemoryCopy);
+      return;
+    }
+    // The file is damaged, render it again
+    locker.relock();
+    QFile::remove(job.fileName);
+  }
+
+  pendingFiles.insert(job.fileName);
+  jobs.addFuture(QtConcurrent::run(this, &ghostscript_interface::gs_generate_graphics_file, job));
 }
 
 
@@ -347,11 +453,20 @@ QString ghostscript_interface::locateEPSfile(const QString &filename, const KUrl
       return fi2.absoluteFilePath();
   }
 
+  QMutexLocker locker(&epsFilesMutex);
+  QHash<QString, QString>::const_iterator it = epsFiles.constFind(filename);
+  if (it != epsFiles.constEnd())
+    return it.value();
+
   // Otherwise, use kpsewhich to find the eps file.
   KProcess proc;
   proc << "kpsewhich" << filename;
   proc.execute();
-  return QString::fromLocal8Bit(proc.readLine().trimmed());
+  const QString path = QString::fromLocal8Bit(proc.readLine().trimmed());
+  // a file that is not found may be created later
+  if (!path.isEmpty())
+    epsFiles.insert(filename, path);
+  return path;
 }
 
 #include "psgs.moc"
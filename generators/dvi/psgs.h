@@ -13,8 +13,11 @@
 #include <QApplication>
 #include <QColor>
 #include <QCustomEvent>
+#include <QFutureSynchronizer>
 #include <QHash>
+#include <QMutex>
 #include <QObject>
+#include <QSet>
 
 class KUrl;
 class PageNumber;
@@ -60,7 +63,10 @@ public:
   void restoreBackgroundColor(const PageNumber& page);
 
   // Draws the graphics of the page into the painter, if possible. If
-  // the page does not contain any graphics, nothing happens
+  // the page does not contain any graphics, nothing happens. The
+  // graphics are rendered by ghostscript in the background and kept
+  // in a disk cache; if they are not ready yet, nothing is drawn and
+  // graphicsReady() is emitted once they are.
   void     graphics(const PageNumber& page, double dpi, long magnification, QPainter* paint);
 
   // Returns the background color for a certain page. If no color was
@@ -79,15 +85,32 @@ public:
   static  QString locateEPSfile(const QString &filename, const KUrl &base);
 
 private:
-  void                  gs_generate_graphics_file(const PageNumber& page, const QString& filename, long magnification);
+  // Everything ghostscript needs to render the graphics of a page,
+  // copied so that the rendering does not depend on pageList
+  struct graphicsJob {
+    quint16 page;
+    QString PostScript;   // the complete PostScript program
+    QString fileName;     // where the result goes in the graphics cache
+    QString includePath;
+    int     pixel_page_w; // in pixels
+    int     pixel_page_h; // in pixels
+    double  resolution;   // in dots per inch
+  };
+
+  QString               pageProgram(const pageInfo *info, long magnification, int pixel_page_w, int pixel_page_h, double resolution) const;
+  void                  gs_generate_graphics_file(const graphicsJob &job);
   QHash<quint16,pageInfo*>   pageList;
 
-  double                resolution;   // in dots per inch
-  int                   pixel_page_w; // in pixels
-  int                   pixel_page_h; // in pixels
-
   QString               includePath;
 
+  // Guards the fields below, which are shared with the rendering jobs
+  QMutex                jobMutex;
+  // The cache files being rendered, and those ghostscript failed to render
+  QSet<QString>         pendingFiles;
+  QSet<QString>         failedFiles;
+  bool                  stopping;
+  QFutureSynchronizer<void> jobs;
+
   // Output device that ghostscript is supposed tp use. Default is
   // "png256". If that does not work, gs_generate_graphics_file will
   // automatically try other known device drivers. If no known output
@@ -104,6 +127,10 @@ private:
 signals:
   /** Passed through to the top-level kpart. */
   void setStatusBarText( const QString& );
+
+  /** Emitted, from the thread that rendered them, when the graphics
+      of the page are in the cache and graphics() can draw them. */
+  void graphicsReady( int page );
 };
 
 #endif
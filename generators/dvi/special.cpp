@@ -2,8 +2,8 @@
 
 // special.cpp
 
-// Methods for dviRenderer which deal with "\special" commands found in the
-// DVI file
+// Methods for dviRenderer and dviRenderContext which deal with
+// "\special" commands found in the DVI file
 
 // Copyright 2000--2004, Stefan Kebekus (kebekus@kde.org).
 
@@ -29,6 +29,7 @@
 
 void dviRenderer::printErrorMsgForSpecials(const QString& msg)
 {
+  QMutexLocker locker(&mutex);
   if (dviFile->errorCounter < 25) {
     kError(kvs::dvi) << msg << endl;
     dviFile->errorCounter++;
@@ -44,6 +45,7 @@ void dviRenderer::printErrorMsgForSpecials(const QString& msg)
 QColor dviRenderer::parseColorSpecification(const QString& colorSpec)
 {
   // Initialize the map of known colors, if that is not done yet.
+  QMutexLocker locker(&mutex);
   if (namedColors.isEmpty()) {
     namedColors["Red"] = QColor( (int)(255.0*1), (int)(255.0*0), (int)(255.0*0));
     namedColors["Tan"] = QColor( (int)(255.0*0.86), (int)(255.0*0.58), (int)(255.0*0.44));
@@ -114,6 +116,7 @@ QColor dviRenderer::parseColorSpecification(const QString& colorSpec)
     namedColors["CornflowerBlue"] = QColor( (int)(255.0*0.35), (int)(255.0*0.87), (int)(255.0*1));
     namedColors["WildStrawberry"] = QColor( (int)(255.0*1), (int)(255.0*0.04), (int)(255.0*0.61));
   }
+  locker.unlock();
 
   QString specType = colorSpec.section(' ', 0, 0);
 
@@ -205,7 +208,7 @@ QColor dviRenderer::parseColorSpecification(const QString& colorSpec)
 }
 
 
-void dviRenderer::color_special(const QString& _cp)
+void dviRenderContext::color_special(const QString& _cp)
 {
   QString const cp = _cp.trimmed();
 
@@ -214,7 +217,7 @@ void dviRenderer::color_special(const QString& _cp)
   if (command == "pop") {
     // Take color off the stack
     if (colorStack.isEmpty())
-      printErrorMsgForSpecials( i18n("Error in DVIfile '%1', page %2. Color pop command issued when the color stack is empty." , 
+      renderer->printErrorMsgForSpecials( i18n("Error in DVIfile '%1', page %2. Color pop command issued when the color stack is empty." , 
                                 dviFile->filename, current_page));
     else
       colorStack.pop();
@@ -223,7 +226,7 @@ void dviRenderer::color_special(const QString& _cp)
 
   if (command == "push") {
     // Get color specification
-    const QColor col = parseColorSpecification(cp.section(' ', 1));
+    const QColor col = renderer->parseColorSpecification(cp.section(' ', 1));
     // Set color
     if (col.isValid())
       colorStack.push(col);
@@ -234,7 +237,7 @@ void dviRenderer::color_special(const QString& _cp)
 
   // Get color specification and set the color for the rest of this
   // page
-  QColor col = parseColorSpecification(cp);
+  QColor col = renderer->parseColorSpecification(cp);
   // Set color
   if (col.isValid())
     globalColor = col;
@@ -244,7 +247,7 @@ void dviRenderer::color_special(const QString& _cp)
 }
 
 
-void dviRenderer::html_href_special(const QString& _cp)
+void dviRenderContext::html_href_special(const QString& _cp)
 {
   QString cp = _cp;
   cp.truncate(cp.indexOf('"'));
@@ -256,7 +259,7 @@ void dviRenderer::html_href_special(const QString& _cp)
 }
 
 
-void dviRenderer::html_anchor_end()
+void dviRenderContext::html_anchor_end()
 {
 #ifdef DEBUG_SPECIAL
   kDebug(kvs::dvi) << "HTML-special, anchor-end";
@@ -269,7 +272,7 @@ void dviRenderer::html_anchor_end()
 }
 
 
-void dviRenderer::source_special(const QString& cp)
+void dviRenderContext::source_special(const QString& cp)
 {
   // only when rendering really takes place: set source_href to the
   // current special string. When characters are rendered, the
@@ -306,7 +309,7 @@ void parse_special_argument(const QString& strg, const char* argument_name, int*
 }
 
 
-void dviRenderer::epsf_special(const QString& cp)
+void dviRenderContext::epsf_special(const QString& cp)
 {
 #ifdef DEBUG_SPECIAL
   kDebug(kvs::dvi) << "epsf-special: psfile=" << cp;
@@ -329,7 +332,7 @@ void dviRenderer::epsf_special(const QString& cp)
   if ((EPSfilename_orig.at(0) == '\"') && (EPSfilename_orig.at(EPSfilename_orig.length()-1) == '\"')) {
     EPSfilename_orig = EPSfilename_orig.mid(1,EPSfilename_orig.length()-2);
   }
-  QString EPSfilename = ghostscript_interface::locateEPSfile(EPSfilename_orig, baseURL);
+  QString EPSfilename = ghostscript_interface::locateEPSfile(EPSfilename_orig, renderer->baseURL);
 
   // Now parse the arguments.
   int  llx     = 0;
@@ -433,14 +436,14 @@ void dviRenderer::epsf_special(const QString& cp)
 }
 
 
-void dviRenderer::TPIC_flushPath_special()
+void dviRenderContext::TPIC_flushPath_special()
 {
 #ifdef DEBUG_SPECIAL
   kDebug(kvs::dvi) << "TPIC special flushPath";
 #endif
 
   if (number_of_elements_in_path == 0) {
-    printErrorMsgForSpecials("TPIC special flushPath called when path was empty.");
+    renderer->printErrorMsgForSpecials("TPIC special flushPath called when path was empty.");
     return;
   }
 
@@ -451,7 +454,7 @@ void dviRenderer::TPIC_flushPath_special()
 }
 
 
-void dviRenderer::TPIC_addPath_special(const QString& cp)
+void dviRenderContext::TPIC_addPath_special(const QString& cp)
 {
 #ifdef DEBUG_SPECIAL
   kDebug(kvs::dvi) << "TPIC special addPath: " << cp;
@@ -462,12 +465,12 @@ void dviRenderer::TPIC_addPath_special(const QString& cp)
   bool ok;
   float xKoord = cp_noWhiteSpace.section(' ', 0, 0).toFloat(&ok);
   if (ok == false) {
-    printErrorMsgForSpecials( QString("TPIC special; cannot parse first argument in 'pn %1'.").arg(cp) );
+    renderer->printErrorMsgForSpecials( QString("TPIC special; cannot parse first argument in 'pn %1'.").arg(cp) );
     return;
   }
   float yKoord = cp_noWhiteSpace.section(' ', 1, 1).toFloat(&ok);
   if (ok == false) {
-    printErrorMsgForSpecials( QString("TPIC special; cannot parse second argument in 'pn %1'.").arg(cp) );
+    renderer->printErrorMsgForSpecials( QString("TPIC special; cannot parse second argument in 'pn %1'.").arg(cp) );
     return;
   }
 
@@ -485,7 +488,7 @@ void dviRenderer::TPIC_addPath_special(const QString& cp)
 }
 
 
-void dviRenderer::TPIC_setPen_special(const QString& cp)
+void dviRenderContext::TPIC_setPen_special(const QString& cp)
 {
 #ifdef DEBUG_SPECIAL
   kDebug(kvs::dvi) << "TPIC special setPen: " << cp;
@@ -495,14 +498,14 @@ void dviRenderer::TPIC_setPen_special(const QString& cp)
   bool ok;
   penWidth_in_mInch = cp.trimmed().toFloat(&ok);
   if (ok == false) {
-    printErrorMsgForSpecials( QString("TPIC special; cannot parse argument in 'pn %1'.").arg(cp) );
+    renderer->printErrorMsgForSpecials( QString("TPIC special; cannot parse argument in 'pn %1'.").arg(cp) );
     penWidth_in_mInch = 0.0;
     return;
   }
 }
 
 
-void dviRenderer::applicationDoSpecial(char *cp)
+void dviRenderContext::applicationDoSpecial(char *cp)
 {
   QString special_command(cp);
 
@@ -671,7 +674,7 @@ void dviRenderer::applicationDoSpecial(char *cp)
       foreGroundPainter->rotate(-angle);
       foreGroundPainter->translate(-x,-y);
     } else
-      printErrorMsgForSpecials( i18n("Error in DVIfile '%1', page %2. Could not interpret angle in text rotation special." , 
+      renderer->printErrorMsgForSpecials( i18n("Error in DVIfile '%1', page %2. Could not interpret angle in text rotation special." , 
                                 dviFile->filename, current_page));
   }
 
@@ -694,6 +697,6 @@ void dviRenderer::applicationDoSpecial(char *cp)
       (strncasecmp(cp, "background", 10) == 0) )
     return;
 
-  printErrorMsgForSpecials(i18n("The special command '%1' is not implemented.", special_command));
+  renderer->printErrorMsgForSpecials(i18n("The special command '%1' is not implemented.", special_command));
   return;
 }
@@ -76,7 +76,7 @@ void TeXFontDefinition::read_VF_index()
   unsigned char        *avail, *availend;
 
   flags      |= FONT_VIRTUAL;
-  set_char_p  = &dviRenderer::set_vf_char;
+  set_char_p  = &dviRenderContext::set_vf_char;
 #ifdef DEBUG_FONTS
   kDebug(kvs::dvi) << "TeXFontDefinition::read_VF_index: reading VF pixel file " << filename;
 #endif
@@ -10,6 +10,8 @@
 #include <stdlib.h>
 
 #include <QtCore/QFile>
+#include <QtCore/QVector>
+#include <QtCore/QtEndian>
 
 #include "faxexpand.h"
 #include "faxdocument.h"
@@ -55,18 +57,6 @@ static void normalize( struct pagenode *pn, int revbits, int swapbytes, size_t l
     }
 }
 
-static bool new_image( pagenode *pn, int width, int height )
-{
-    pn->image = QImage( width, height, QImage::Format_MonoLSB );
-    pn->image.setColor( 0, qRgb( 255, 255, 255 ) );
-    pn->image.setColor( 1, qRgb( 0, 0, 0 ) );
-    pn->bytes_per_line = pn->image.bytesPerLine();
-    pn->dpi = FAX_DPI_FINE;
-    pn->imageData = new uchar[ width * height ];
-
-    return !pn->image.isNull();
-}
-
 /* get compressed data into memory */
 static unsigned char* getstrip( pagenode *pn, int strip )
 {
@@ -123,18 +113,6 @@ static unsigned char* getstrip( pagenode *pn, int strip )
     }
 
     normalize( pn, !pn->lsbfirst, ShortOrder, roundup );
-    if ( pn->size.height() == 0 )
-        pn->size.setHeight( G3count( pn, pn->expander == g32expand ) );
-
-    if ( pn->size.height() == 0 )
-    {
-        delete [] data;
-        pn->data = 0;
-        return 0;
-    }
-
-    if ( pn->strips == 0 )
-        pn->rowsperstrip = pn->size.height();
 
     pn->dataOrig = (t16bits *)data;
 
@@ -158,6 +136,8 @@ static void draw_line( pixnum *run, int lineNum, pagenode *pn )
     p = (t32bits *)(pn->imageData + lineNum*(2-pn->vres)*pn->bytes_per_line);
     p1 =(t32bits *)(pn->vres ? 0 : p + pn->bytes_per_line/sizeof(*p));
 
+    /* the first pixel is the most significant bit of acc, so store the
+       words big endian to get the pixels in order for a Format_Mono image */
     r = run;
     acc = 0;
     nacc = 0;
@@ -182,9 +162,9 @@ static void draw_line( pixnum *run, int lineNum, pagenode *pn )
             pix = ~pix;
             continue;
         }
-        *p++ = acc;
+        *p++ = qToBigEndian( acc );
         if ( p1 )
-            *p1++ = acc;
+            *p1++ = qToBigEndian( acc );
         n -= 32 - nacc;
         while ( n >= 32 )
         {
@@ -199,26 +179,12 @@ static void draw_line( pixnum *run, int lineNum, pagenode *pn )
     }
     if ( nacc )
     {
-        *p++ = acc;
+        *p++ = qToBigEndian( acc );
         if ( p1 )
-            *p1++ = acc;
+            *p1++ = qToBigEndian( acc );
     }
 }
 
-static bool get_image( struct pagenode *pn )
-{
-    unsigned char *data = getstrip( pn, 0 );
-    if ( !data )
-        return false;
-
-    if ( !new_image( pn, pn->size.width(), (pn->vres ? 1 : 2) * pn->size.height() ) )
-        return false;
-
-    (*pn->expander)( pn, draw_line );
-
-    return true;
-}
-
 class FaxDocument::Private
 {
     public:
@@ -228,9 +194,20 @@ class FaxDocument::Private
             mPageNode.size = QSize( 1728, 0 );
         }
 
+        /**
+         * The compressed data of a page.
+         */
+        struct Page
+        {
+            t16bits *data;
+            size_t length;
+            int height;
+        };
+
         FaxDocument *mParent;
         struct pagenode mPageNode;
         FaxDocument::DocumentType mType;
+        QVector<Page> mPages;
 };
 
 FaxDocument::FaxDocument( const QString &fileName, DocumentType type )
@@ -245,6 +222,7 @@ FaxDocument::FaxDocument( const QString &fileName, DocumentType type )
     d->mPageNode.data = 0;
     d->mPageNode.dataOrig = 0;
     d->mPageNode.imageData = 0;
+    d->mPageNode.dpi = FAX_DPI_FINE;
     d->mType = type;
 
     if ( d->mType == G3 )
@@ -256,7 +234,6 @@ FaxDocument::FaxDocument( const QString &fileName, DocumentType type )
 FaxDocument::~FaxDocument()
 {
     delete [] d->mPageNode.dataOrig;
-    delete [] d->mPageNode.imageData;
     delete d;
 }
 
@@ -264,46 +241,79 @@ bool FaxDocument::load()
 {
     fax_init_tables();
 
-    bool ok = get_image( &(d->mPageNode) );
-    if ( !ok )
+    pagenode *pn = &(d->mPageNode);
+    if ( !getstrip( pn, 0 ) )
         return false;
 
-    // byte-swapping the image
-    int height = d->mPageNode.size.height();
-    int bytes_per_line = d->mPageNode.size.width()/8;
-
-    QByteArray bytes( height * bytes_per_line, 0 );
-    for ( int y= height - 1; y >= 0; --y )
+    // only find where the pages are, they are decoded when asked;
+    // each page of a G3 document ends with a RTC
+    t16bits *data = pn->data;
+    t16bits *end = pn->data + pn->length / sizeof( t16bits );
+    while ( data < end )
     {
-        quint32 offset  = y * bytes_per_line;
-        quint32 *source = (quint32 *) (d->mPageNode.imageData + offset);
-        quint32 *dest   = (quint32 *) (bytes.data() + offset);
-        for ( int x= (bytes_per_line/4) - 1; x >= 0; --x )
-        {
-            quint32 dv = 0, sv = *source;
-            for ( int bit = 32; bit > 0; --bit )
-            {
-                dv <<= 1;
-                dv |= sv&1;
-                sv >>= 1;
-            }
-            *dest = dv;
-            ++dest;
-            ++source;
-        }
+        pn->data = data;
+        pn->length = ( end - data ) * sizeof( t16bits );
+
+        t16bits *pageEnd = end;
+        const int height = G3count( pn, pn->expander == g32expand, &pageEnd );
+        if ( height <= 0 )
+            break;
+
+        Private::Page page;
+        page.data = data;
+        page.length = ( pageEnd - data ) * sizeof( t16bits );
+        page.height = height;
+        d->mPages.append( page );
+
+        if ( d->mType != G3 || pageEnd <= data )
+            break;
+        data = pageEnd;
     }
 
-    // convert it into a QImage
-    QImage img( (uchar*)bytes.data(), d->mPageNode.size.width(), d->mPageNode.size.height(), QImage::Format_MonoLSB );
-    img.setColor( 0, qRgb( 255, 255, 255 ) );
-    img.setColor( 1, qRgb( 0, 0, 0 ) );
+    return !d->mPages.isEmpty();
+}
+
+int FaxDocument::pageCount() const
+{
+    return d->mPages.count();
+}
 
-    d->mPageNode.image = img.copy().scaled( img.width(), img.height() * 1.5 );
+QSize FaxDocument::pageSize( int page ) const
+{
+    if ( page < 0 || page >= d->mPages.count() )
+        return QSize();
 
-    return true;
+    // the lines of normal resolution faxes are doubled
+    const int lineFactor = d->mPageNode.vres ? 1 : 2;
+    return QSize( d->mPageNode.size.width(), lineFactor * d->mPages.at( page ).height );
 }
 
-QImage FaxDocument::image() const
+QImage FaxDocument::image( int page ) const
 {
-    return d->mPageNode.image;
+    const QSize size = pageSize( page );
+    if ( size.isEmpty() )
+        return QImage();
+
+    QImage image( size, QImage::Format_Mono );
+    if ( image.isNull() )
+        return QImage();
+    image.setColor( 0, qRgb( 255, 255, 255 ) );
+    image.setColor( 1, qRgb( 0, 0, 0 ) );
+    image.fill( 0 );
+
+    const Private::Page &pageData = d->mPages.at( page );
+    pagenode *pn = &(d->mPageNode);
+    pn->data = pageData.data;
+    pn->length = pageData.length;
+    pn->size.setHeight( pageData.height );
+    pn->rowsperstrip = pageData.height;
+    pn->stripnum = 0;
+    pn->bytes_per_line = image.bytesPerLine();
+    pn->imageData = image.bits();
+
+    (*pn->expander)( pn, draw_line );
+
+    pn->imageData = 0;
+
+    return image;
 }
@@ -14,7 +14,7 @@
 
 /**
  * Loads a G3/G4 fax document and provides methods
- * to convert it into a QImage.
+ * to convert its pages into a QImage.
  */
 class FaxDocument
 {
@@ -43,14 +43,29 @@ class FaxDocument
     /**
      * Loads the document.
      *
+     * Only the position of the pages is read, they are decoded by image().
+     *
      * @return @c true if the document can be loaded successfully, @c false otherwise.
      */
     bool load();
 
     /**
-     * Returns the document as an image.
+     * Returns the number of pages of the document.
+     */
+    int pageCount() const;
+
+    /**
+     * Returns the size in pixels of the given @p page, without any
+     * correction of its aspect ratio.
+     */
+    QSize pageSize( int page ) const;
+
+    /**
+     * Decodes the given @p page as an image of pageSize().
+     *
+     * The document can decode only one page at a time.
      */
-    QImage image() const;
+    QImage image( int page ) const;
 
   private:
     class Private;
@@ -715,9 +715,9 @@ static const unsigned char zerotab[256] = {
     empty = 1;								\
 } while (0)
 
-/* count fax lines */
+/* count fax lines, up to the end of the page (RTC) */
 int
-G3count(struct pagenode *pn, int twoD)
+G3count(struct pagenode *pn, int twoD, t16bits **pageEnd)
 {
     t16bits *p = pn->data;
     t16bits *end = p + pn->length/sizeof(*p);
@@ -740,5 +740,7 @@ G3count(struct pagenode *pn, int twoD)
 		zeros--;
 	}
     }
+    if (pageEnd)
+	*pageEnd = p;
     return lines - EOLcnt;	/* don't count trailing EOLs */
 }
@@ -70,7 +70,6 @@ class pagenode {		/* compressed page descriptor */
     void (*expander)(class pagenode *, drawfunc);
     unsigned int bytes_per_line;
     QString filename;         /* The name of the file to be opened */
-    QImage image;             /* The final image */
     uchar *imageData;         /* The temporary raw image data */
 };
 
@@ -114,7 +113,7 @@ void g4expand(class pagenode *pn, drawfunc df);
 /* initialise code tables */
 extern void fax_init_tables(void);
 
-/* count lines in image */
-extern int G3count(class pagenode *pn, int twoD);
+/* count lines in image, and set pageEnd after the end of its first page */
+extern int G3count(class pagenode *pn, int twoD, t16bits **pageEnd = 0);
 
 #endif
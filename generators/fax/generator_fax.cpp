@@ -11,6 +11,7 @@
 
 #include "faxdocument.h"
 
+#include <QtCore/QMutexLocker>
 #include <QtGui/QPainter>
 #include <QtGui/QPrinter>
 
@@ -18,8 +19,12 @@
 #include <klocale.h>
 
 #include <core/document.h>
+#include <core/fileprinter.h>
 #include <core/page.h>
 
+// the lines of fax documents are higher than their pixels are wide
+static const double aspectRatioCorrection = 1.5;
+
 static KAboutData createAboutData()
 {
     KAboutData aboutData(
@@ -39,7 +44,7 @@ static KAboutData createAboutData()
 OKULAR_EXPORT_PLUGIN( FaxGenerator, createAboutData() )
 
 FaxGenerator::FaxGenerator( QObject *parent, const QVariantList &args )
-    : Generator( parent, args )
+    : Generator( parent, args ), m_document( 0 ), m_imgPage( -1 ), m_scaledPage( -1 ), m_docInfo( 0 )
 {
     setFeature( Threaded );
     setFeature( PrintNative );
@@ -58,20 +63,23 @@ bool FaxGenerator::loadDocument( const QString & fileName, QVector<Okular::Page*
     else
         type = FaxDocument::G4;
 
-    FaxDocument faxDocument( fileName, type );
+    m_document = new FaxDocument( fileName, type );
 
-    if ( !faxDocument.load() )
+    if ( !m_document->load() )
     {
         emit error( i18n( "Unable to load document" ), -1 );
+        delete m_document;
+        m_document = 0;
         return false;
     }
 
-    m_img = faxDocument.image();
-
-    pagesVector.resize( 1 );
-
-    Okular::Page * page = new Okular::Page( 0, m_img.width(), m_img.height(), Okular::Rotation0 );
-    pagesVector[0] = page;
+    // the pages are decoded only when shown
+    pagesVector.resize( m_document->pageCount() );
+    for ( int i = 0; i < pagesVector.count(); ++i )
+    {
+        const QSize size = m_document->pageSize( i );
+        pagesVector[i] = new Okular::Page( i, size.width(), size.height() * aspectRatioCorrection, Okular::Rotation0 );
+    }
 
     m_docInfo = new Okular::DocumentInfo();
     if ( type == FaxDocument::G3 )
@@ -84,7 +92,14 @@ bool FaxGenerator::loadDocument( const QString & fileName, QVector<Okular::Page*
 
 bool FaxGenerator::doCloseDocument()
 {
+    userMutex()->lock();
+    delete m_document;
+    m_document = 0;
+    m_imgPage = -1;
     m_img = QImage();
+    userMutex()->unlock();
+    m_scaledPage = -1;
+    m_scaledImg = QImage();
     delete m_docInfo;
     m_docInfo = 0;
 
@@ -99,7 +114,36 @@ QImage FaxGenerator::image( Okular::PixmapRequest * request )
     if ( request->page()->rotation() % 2 == 1 )
         qSwap( width, height );
 
-    return m_img.scaled( width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
+    // the aspect ratio correction is part of this scaling, as the size of
+    // the page is corrected already
+    const int pageNumber = request->page()->number();
+    const QImage image = pageImage( pageNumber );
+    if ( pageNumber != m_scaledPage )
+        m_scaledImg = QImage();
+
+    // scaling the whole fax down is slow, so scale from the last scaled
+    // image when it is up to twice the requested size
+    const QImage &source = ( m_scaledImg.width() >= width && m_scaledImg.height() >= height &&
+                             m_scaledImg.width() <= 2 * width ) ? m_scaledImg : image;
+    const QImage scaled = source.scaled( width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
+    if ( &source == &image )
+    {
+        m_scaledImg = scaled;
+        m_scaledPage = pageNumber;
+    }
+
+    return scaled;
+}
+
+QImage FaxGenerator::pageImage( int page )
+{
+    QMutexLocker locker( userMutex() );
+    if ( page != m_imgPage && m_document )
+    {
+        m_img = m_document->image( page );
+        m_imgPage = page;
+    }
+    return m_img;
 }
 
 const Okular::DocumentInfo * FaxGenerator::generateDocumentInfo()
@@ -111,14 +155,29 @@ bool FaxGenerator::print( QPrinter& printer )
 {
     QPainter p( &printer );
 
-    QImage image( m_img );
+    QList<int> pageList = Okular::FilePrinter::pageList( printer, document()->pages(),
+                                                         document()->currentPage() + 1,
+                                                         document()->bookmarkedPageList() );
 
-    if ( ( image.width() > printer.width() ) || ( image.height() > printer.height() ) )
+    for ( int i = 0; i < pageList.count(); ++i )
+    {
+        const int page = pageList[i] - 1;
+        QImage image = pageImage( page );
+        if ( image.isNull() )
+            continue;
 
-        image = image.scaled( printer.width(), printer.height(),
-                              Qt::KeepAspectRatio, Qt::SmoothTransformation );
+        image = image.scaled( image.width(), image.height() * aspectRatioCorrection );
 
-    p.drawImage( 0, 0, image );
+        if ( ( image.width() > printer.width() ) || ( image.height() > printer.height() ) )
+
+            image = image.scaled( printer.width(), printer.height(),
+                                  Qt::KeepAspectRatio, Qt::SmoothTransformation );
+
+        if ( i != 0 )
+            printer.newPage();
+
+        p.drawImage( 0, 0, image );
+    }
 
     return true;
 }
@@ -14,6 +14,8 @@
 
 #include <QtGui/QImage>
 
+class FaxDocument;
+
 class FaxGenerator : public Okular::Generator
 {
     Q_OBJECT
@@ -33,7 +35,16 @@ class FaxGenerator : public Okular::Generator
         QImage image( Okular::PixmapRequest * request );
 
     private:
+        // decodes a page, unless it is the last decoded one
+        QImage pageImage( int page );
+
+        FaxDocument *m_document;
+        // the last decoded page, and the last scaled image of it,
+        // reused for the smaller requests close to it
+        int m_imgPage;
         QImage m_img;
+        int m_scaledPage;
+        QImage m_scaledImg;
         Okular::DocumentInfo *m_docInfo;
 };
 
@@ -12,6 +12,8 @@
 #include "generator_kimgio.h"
 
 #include <QtCore/QBuffer>
+#include <QtCore/QFile>
+#include <QtCore/QMutex>
 #include <QtGui/QImageReader>
 #include <QtGui/QPainter>
 #include <QtGui/QPrinter>
@@ -75,16 +77,16 @@ bool KIMGIOGenerator::loadDocument( const QString & fileName, QVector<Okular::Pa
     const QString mime = KMimeType::findByFileContent(fileName)->name();
     const QStringList types = KImageIO::typeForMime(mime);
     const QByteArray type = !types.isEmpty() ? types[0].toAscii() : QByteArray();
-    QImageReader reader( fileName, type );
-    if ( !reader.read( &m_img ) ) {
-        emit error( i18n( "Unable to load document: %1", reader.errorString() ), -1 );
+    QFile file( fileName );
+    file.open( QIODevice::ReadOnly );
+    if ( !loadImage( &file, type ) )
         return false;
-    }
+    m_fileName = fileName;
     docInfo.set( Okular::DocumentInfo::MimeType, mime );
 
     pagesVector.resize( 1 );
 
-    Okular::Page * page = new Okular::Page( 0, m_img.width(), m_img.height(), Okular::Rotation0 );
+    Okular::Page * page = new Okular::Page( 0, m_size.width(), m_size.height(), Okular::Rotation0 );
     pagesVector[0] = page;
 
     return true;
@@ -100,24 +102,65 @@ bool KIMGIOGenerator::loadDocumentFromData( const QByteArray & fileData, QVector
     buffer.setData( fileData );
     buffer.open( QIODevice::ReadOnly );
 
-    QImageReader reader( &buffer, type );
-    if ( !reader.read( &m_img ) ) {
-        emit error( i18n( "Unable to load document: %1", reader.errorString() ), -1 );
+    if ( !loadImage( &buffer, type ) )
         return false;
-    }
+    m_data = fileData;
     docInfo.set( Okular::DocumentInfo::MimeType, mime );
 
     pagesVector.resize( 1 );
 
-    Okular::Page * page = new Okular::Page( 0, m_img.width(), m_img.height(), Okular::Rotation0 );
+    Okular::Page * page = new Okular::Page( 0, m_size.width(), m_size.height(), Okular::Rotation0 );
     pagesVector[0] = page;
 
     return true;
 }
 
+bool KIMGIOGenerator::loadImage( QIODevice *device, const QByteArray &type )
+{
+    QImageReader reader( device, type );
+    m_type = type;
+    m_size = reader.size();
+
+    // the formats able to decode directly at the requested size are decoded
+    // at each request, the others are decoded once now
+    if ( !m_size.isValid() || !reader.supportsOption( QImageIOHandler::ScaledSize ) ) {
+        if ( !reader.read( &m_img ) ) {
+            emit error( i18n( "Unable to load document: %1", reader.errorString() ), -1 );
+            return false;
+        }
+        m_size = m_img.size();
+    } else if ( !reader.canRead() ) {
+        emit error( i18n( "Unable to load document: %1", reader.errorString() ), -1 );
+        return false;
+    }
+
+    return true;
+}
+
+QImage KIMGIOGenerator::decode( const QSize &scaledSize ) const
+{
+    QFile file( m_fileName );
+    QBuffer buffer;
+    QIODevice *device = &file;
+    if ( m_fileName.isEmpty() ) {
+        buffer.setData( m_data );
+        device = &buffer;
+    }
+    device->open( QIODevice::ReadOnly );
+
+    QImageReader reader( device, m_type );
+    if ( scaledSize.isValid() )
+        reader.setScaledSize( scaledSize );
+    return reader.read();
+}
+
 bool KIMGIOGenerator::doCloseDocument()
 {
     m_img = QImage();
+    m_fileName.clear();
+    m_data.clear();
+    m_type.clear();
+    m_size = QSize();
 
     return true;
 }
@@ -130,14 +173,38 @@ QImage KIMGIOGenerator::image( Okular::PixmapRequest * request )
     if ( request->page()->rotation() % 2 == 1 )
         qSwap( width, height );
 
-    return m_img.scaled( width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
+    userMutex()->lock();
+    QImage source = m_img;
+    userMutex()->unlock();
+
+    // the last decoded image is good for any size if it is the full image,
+    // otherwise for the requests up to its size and down to its half
+    const bool reusable = !source.isNull() &&
+                          ( source.size() == m_size ||
+                            ( source.width() >= width && source.height() >= height && source.width() <= 2 * width ) );
+    if ( !reusable ) {
+        source = decode( QSize( width, height ) );
+
+        userMutex()->lock();
+        m_img = source;
+        userMutex()->unlock();
+    }
+
+    if ( source.size() == QSize( width, height ) )
+        return source;
+
+    return source.scaled( width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
 }
 
 bool KIMGIOGenerator::print( QPrinter& printer )
 {
     QPainter p( &printer );
 
+    userMutex()->lock();
     QImage image( m_img );
+    userMutex()->unlock();
+    if ( image.size() != m_size )
+        image = decode( QSize() );
 
     if ( ( image.width() > printer.width() ) || ( image.height() > printer.height() ) )
 
@@ -40,6 +40,16 @@ class KIMGIOGenerator : public Okular::Generator
         void slotTest();
 
     private:
+        bool loadImage( QIODevice *device, const QByteArray &type );
+        QImage decode( const QSize &scaledSize ) const;
+
+        // the file or data of the image, and its format
+        QString m_fileName;
+        QByteArray m_data;
+        QByteArray m_type;
+        QSize m_size;
+        // the last decoded image, at full size when the format cannot
+        // be decoded at a smaller size
         QImage m_img;
         Okular::DocumentInfo docInfo;
 };
@@ -17,6 +17,7 @@
 #include <core/area.h>
 
 #include "annots.h"
+#include "documentpool.h"
 #include "generator_pdf.h"
 #include "popplerembeddedfile.h"
 #include "config-okular-poppler.h"
@@ -59,8 +60,8 @@ static int maskExportedFlags(int flags)
 }
 
 //BEGIN PopplerAnnotationProxy implementation
-PopplerAnnotationProxy::PopplerAnnotationProxy( Poppler::Document *doc, QMutex *userMutex )
-    : ppl_doc ( doc ), mutex ( userMutex )
+PopplerAnnotationProxy::PopplerAnnotationProxy( Poppler::Document *doc, QMutex *userMutex, PopplerDocumentPool *docPool )
+    : ppl_doc ( doc ), mutex ( userMutex ), pool ( docPool )
 {
 }
 
@@ -92,6 +93,7 @@ void PopplerAnnotationProxy::notifyAddition( Okular::Annotation *okl_ann, int pa
     Okular::AnnotationUtils::storeAnnotation( okl_ann, dom_ann, doc );
 
     QMutexLocker ml(mutex);
+    pool->setRenderable( false );
 
     // Create poppler annotation
     Poppler::Annotation *ppl_ann = Poppler::AnnotationUtils::createAnnotation( dom_ann );
@@ -145,6 +147,7 @@ void PopplerAnnotationProxy::notifyModification( const Okular::Annotation *okl_a
         return;
 
     QMutexLocker ml(mutex);
+    pool->setRenderable( false );
 
     if ( okl_ann->flags() & Okular::Annotation::BeingMoved )
     {
@@ -255,6 +258,7 @@ void PopplerAnnotationProxy::notifyRemoval( Okular::Annotation *okl_ann, int pag
         return;
 
     QMutexLocker ml(mutex);
+    pool->setRenderable( false );
 
     Poppler::Page *ppl_page = ppl_doc->page( page );
     ppl_page->removeAnnotation( ppl_ann ); // Also destroys ppl_ann
@@ -18,12 +18,14 @@
 #include "core/annotations.h"
 #include "config-okular-poppler.h"
 
+class PopplerDocumentPool;
+
 extern Okular::Annotation* createAnnotationFromPopplerAnnotation( Poppler::Annotation *ann, bool * doDelete );
 
 class PopplerAnnotationProxy : public Okular::AnnotationProxy
 {
     public:
-        PopplerAnnotationProxy( Poppler::Document *doc, QMutex *userMutex );
+        PopplerAnnotationProxy( Poppler::Document *doc, QMutex *userMutex, PopplerDocumentPool *docPool );
         ~PopplerAnnotationProxy();
 
         bool supports( Capability capability ) const;
@@ -33,6 +35,8 @@ class PopplerAnnotationProxy : public Okular::AnnotationProxy
     private:
         Poppler::Document *ppl_doc;
         QMutex *mutex;
+        // its copies of the document do not see the changes
+        PopplerDocumentPool *pool;
 };
 
 #endif
@@ -0,0 +1,218 @@
+/***************************************************************************
+ *   Copyright (C) 2013 by Albert Astals Cid <aacid@kde.org>               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#include "documentpool.h"
+
+PopplerPageCache::PopplerPageCache( Poppler::Document *document, int size )
+    : m_document( document ), m_size( size )
+{
+}
+
+PopplerPageCache::~PopplerPageCache()
+{
+    clear();
+}
+
+Poppler::Page * PopplerPageCache::page( int number )
+{
+    for ( int i = 0; i < m_pages.count(); ++i )
+    {
+        if ( m_pages.at( i ).first == number )
+        {
+            if ( i > 0 )
+                m_pages.move( i, 0 );
+            return m_pages.first().second;
+        }
+    }
+
+    Poppler::Page *page = m_document->page( number );
+    if ( !page )
+        return 0;
+
+    if ( m_pages.count() >= m_size )
+        delete m_pages.takeLast().second;
+    m_pages.prepend( qMakePair( number, page ) );
+    return page;
+}
+
+void PopplerPageCache::clear()
+{
+    for ( int i = 0; i < m_pages.count(); ++i )
+        delete m_pages.at( i ).second;
+    m_pages.clear();
+}
+
+PopplerDocumentPool::PopplerDocumentPool( int size )
+    : m_size( size ), m_opened( 0 ), m_openFailed( false ), m_renderable( false ),
+      m_renderHints( 0 ), m_paperColor( Qt::white )
+{
+}
+
+PopplerDocumentPool::~PopplerDocumentPool()
+{
+    clear();
+}
+
+void PopplerDocumentPool::setSource( const QString &filePath, const QByteArray &fileData, const QByteArray &password )
+{
+    clear();
+
+    QMutexLocker locker( &m_mutex );
+    m_filePath = filePath;
+    m_fileData = fileData;
+    m_password = password;
+}
+
+void PopplerDocumentPool::setRenderSettings( Poppler::Document::RenderHints hints, const QColor &paperColor )
+{
+    QMutexLocker locker( &m_mutex );
+    m_renderHints = hints;
+    m_paperColor = paperColor;
+}
+
+void PopplerDocumentPool::setRenderable( bool renderable )
+{
+    QMutexLocker locker( &m_mutex );
+    m_renderable = renderable;
+}
+
+bool PopplerDocumentPool::isRenderable()
+{
+    QMutexLocker locker( &m_mutex );
+    return m_renderable && !m_openFailed;
+}
+
+void PopplerDocumentPool::clear()
+{
+    QMutexLocker locker( &m_mutex );
+    while ( m_free.count() < m_opened )
+        m_released.wait( &m_mutex );
+
+    qDeleteAll( m_pageCaches );
+    m_pageCaches.clear();
+    qDeleteAll( m_free );
+    m_free.clear();
+    m_opened = 0;
+    m_openFailed = false;
+    m_renderable = false;
+    m_filePath.clear();
+    m_fileData.clear();
+    m_password.clear();
+}
+
+Poppler::Document * PopplerDocumentPool::acquire()
+{
+    QMutexLocker locker( &m_mutex );
+    if ( m_filePath.isEmpty() && m_fileData.isEmpty() )
+        return 0;
+
+    while ( m_free.isEmpty() && m_opened >= m_size )
+        m_released.wait( &m_mutex );
+
+    // once opening an instance failed, only the ones already open are used
+    if ( m_free.isEmpty() && m_openFailed )
+        return 0;
+
+    Poppler::Document *document = 0;
+    if ( !m_free.isEmpty() )
+    {
+        document = m_free.takeLast();
+        setupDocument( document );
+        return document;
+    }
+
+    // opening can take a while, do not block the other users meanwhile
+    ++m_opened;
+    locker.unlock();
+    document = open();
+    locker.relock();
+
+    if ( document )
+    {
+        m_pageCaches.insert( document, new PopplerPageCache( document, 8 ) );
+        setupDocument( document );
+    }
+    else
+    {
+        // the callers use the main document from now on
+        m_openFailed = true;
+        --m_opened;
+        m_released.wakeAll();
+    }
+    return document;
+}
+
+void PopplerDocumentPool::release( Poppler::Document *document )
+{
+    QMutexLocker locker( &m_mutex );
+    m_free.append( document );
+    m_released.wakeAll();
+}
+
+Poppler::Document * PopplerDocumentPool::openDetached()
+{
+    {
+        QMutexLocker locker( &m_mutex );
+        if ( ( m_filePath.isEmpty() && m_fileData.isEmpty() ) || m_openFailed )
+            return 0;
+    }
+
+    Poppler::Document *document = open();
+    QMutexLocker locker( &m_mutex );
+    if ( !document )
+        m_openFailed = true;
+    return document;
+}
+
+PopplerPageCache * PopplerDocumentPool::pageCache( Poppler::Document *document )
+{
+    QMutexLocker locker( &m_mutex );
+    return m_pageCaches.value( document );
+}
+
+void PopplerDocumentPool::setupDocument( Poppler::Document *document ) const
+{
+    if ( document->renderHints() != m_renderHints )
+    {
+        const Poppler::Document::RenderHints changed = document->renderHints() ^ m_renderHints;
+        for ( int i = 0; i < 32; ++i )
+        {
+            const Poppler::Document::RenderHint hint = static_cast< Poppler::Document::RenderHint >( 1 << i );
+            if ( changed.testFlag( hint ) )
+                document->setRenderHint( hint, m_renderHints.testFlag( hint ) );
+        }
+    }
+    if ( document->paperColor() != m_paperColor )
+        document->setPaperColor( m_paperColor );
+}
+
+Poppler::Document * PopplerDocumentPool::open()
+{
+    QString filePath;
+    QByteArray fileData;
+    QByteArray password;
+    {
+        QMutexLocker locker( &m_mutex );
+        filePath = m_filePath;
+        fileData = m_fileData;
+        password = m_password;
+    }
+
+    Poppler::Document *document = filePath.isEmpty()
+                                  ? Poppler::Document::loadFromData( fileData, password, password )
+                                  : Poppler::Document::load( filePath, password, password );
+    if ( document && document->isLocked() )
+    {
+        delete document;
+        document = 0;
+    }
+    return document;
+}
+
+/* kate: replace-tabs on; indent-width 4; */
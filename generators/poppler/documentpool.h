@@ -0,0 +1,195 @@
+/***************************************************************************
+ *   Copyright (C) 2013 by Albert Astals Cid <aacid@kde.org>               *
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ ***************************************************************************/
+
+#ifndef _OKULAR_GENERATOR_PDF_DOCUMENTPOOL_H_
+#define _OKULAR_GENERATOR_PDF_DOCUMENTPOOL_H_
+
+#include <poppler-qt4.h>
+
+#include <qbytearray.h>
+#include <qcolor.h>
+#include <qhash.h>
+#include <qlist.h>
+#include <qpair.h>
+#include <qmutex.h>
+#include <qstring.h>
+#include <qwaitcondition.h>
+
+/**
+ * A bounded cache of the Poppler::Page objects of a Poppler::Document,
+ * dropping the least recently used ones first.
+ *
+ * Creating a Poppler::Page means looking up and parsing its page dictionary,
+ * so the users asking again and again for the same pages (rendering at new
+ * zoom levels, text extraction) keep the objects here instead.
+ *
+ * The cache is not thread safe: it must be used with the same lock
+ * protecting the document.
+ */
+class PopplerPageCache
+{
+    public:
+        PopplerPageCache( Poppler::Document *document, int size );
+        ~PopplerPageCache();
+
+        /**
+         * Returns the page @p number of the document, or 0 if it does not exist.
+         * The page is owned by the cache, and stays valid only until the next call.
+         */
+        Poppler::Page * page( int number );
+
+        /**
+         * Deletes all the cached pages
+         */
+        void clear();
+
+    private:
+        Q_DISABLE_COPY( PopplerPageCache )
+
+        Poppler::Document *m_document;
+        const int m_size;
+        // most recently used first
+        QList< QPair< int, Poppler::Page * > > m_pages;
+};
+
+/**
+ * A pool of read only Poppler::Document instances of the same file (or data).
+ *
+ * A Poppler::Document can be used only by one thread at a time, so the jobs
+ * that only read the document (like the text extraction and the rendering)
+ * take an instance of the pool, leaving the main document free for the
+ * others. Instances are opened lazily, up to the size of the pool.
+ *
+ * The instances never see the changes done to the main document (annotations,
+ * form fields), so they must not be used for anything depending on them:
+ * once the main document is edited, they are not used for rendering.
+ */
+class PopplerDocumentPool
+{
+    public:
+        explicit PopplerDocumentPool( int size );
+        ~PopplerDocumentPool();
+
+        /**
+         * Sets the file (or data) and the password of the instances,
+         * closing the ones already opened
+         */
+        void setSource( const QString &filePath, const QByteArray &fileData, const QByteArray &password );
+
+        /**
+         * Closes all the instances; waits for the ones in use
+         */
+        void clear();
+
+        /**
+         * Sets the render hints and the paper color of the instances
+         */
+        void setRenderSettings( Poppler::Document::RenderHints hints, const QColor &paperColor );
+
+        /**
+         * Sets whether the instances render the pages as the main document
+         * does, that is whether the main document has not been edited
+         */
+        void setRenderable( bool renderable );
+
+        /**
+         * Returns whether the instances can be used for rendering
+         */
+        bool isRenderable();
+
+        /**
+         * Returns a free instance, waiting for one if all are in use,
+         * or 0 if no instance can be opened
+         */
+        Poppler::Document * acquire();
+
+        /**
+         * Gives back an instance got with acquire()
+         */
+        void release( Poppler::Document *document );
+
+        /**
+         * Opens a new instance, not part of the pool, for a job keeping it
+         * for long (like the font scanning). Returns 0 if it cannot be opened
+         */
+        Poppler::Document * openDetached();
+
+        /**
+         * Returns the page cache of an instance got with acquire()
+         */
+        PopplerPageCache * pageCache( Poppler::Document *document );
+
+    private:
+        Poppler::Document * open();
+        // called with m_mutex locked
+        void setupDocument( Poppler::Document *document ) const;
+
+        const int m_size;
+        QMutex m_mutex;
+        QWaitCondition m_released;
+        QList< Poppler::Document * > m_free;
+        QHash< Poppler::Document *, PopplerPageCache * > m_pageCaches;
+        int m_opened;
+        // opening an instance failed, do not try again for the same source
+        bool m_openFailed;
+        bool m_renderable;
+        Poppler::Document::RenderHints m_renderHints;
+        QColor m_paperColor;
+        QString m_filePath;
+        QByteArray m_fileData;
+        QByteArray m_password;
+};
+
+/**
+ * Holds an instance of a PopplerDocumentPool for the scope of the object.
+ */
+class PooledDocument
+{
+    public:
+        /**
+         * Takes an instance of @p pool, if any; document() is 0 when
+         * @p pool is 0 or has no instance to give
+         */
+        explicit PooledDocument( PopplerDocumentPool *pool )
+            : m_pool( pool ), m_document( pool ? pool->acquire() : 0 ),
+              m_pageCache( m_document ? pool->pageCache( m_document ) : 0 )
+        {
+        }
+
+        ~PooledDocument()
+        {
+            if ( m_document )
+                m_pool->release( m_document );
+        }
+
+        Poppler::Document * document() const
+        {
+            return m_document;
+        }
+
+        /**
+         * Returns the page @p number of the instance, cached as
+         * PopplerPageCache::page() does
+         */
+        Poppler::Page * page( int number ) const
+        {
+            return m_pageCache ? m_pageCache->page( number ) : 0;
+        }
+
+    private:
+        Q_DISABLE_COPY( PooledDocument )
+
+        PopplerDocumentPool *m_pool;
+        Poppler::Document *m_document;
+        PopplerPageCache *m_pageCache;
+};
+
+#endif
+
+/* kate: replace-tabs on; indent-width 4; */
@@ -19,8 +19,11 @@
 #include <qlayout.h>
 #include <qmutex.h>
 #include <qregexp.h>
+#include <qset.h>
 #include <qstack.h>
 #include <qtextstream.h>
+#include <qthread.h>
+#include <qdatetime.h>
 #include <QtGui/QPrinter>
 #include <QtGui/QPainter>
 
@@ -57,6 +60,7 @@
 #endif
 
 #include "annots.h"
+#include "documentpool.h"
 #include "formfields.h"
 #include "popplerembeddedfile.h"
 
@@ -424,11 +428,12 @@ static void PDFGeneratorPopplerDebugFunction(const QString &message, const QVari
 #endif
 
 PDFGenerator::PDFGenerator( QObject *parent, const QVariantList &args )
-    : Generator( parent, args ), pdfdoc( 0 ),
+    : Generator( parent, args ), pdfdoc( 0 ), pageCache( 0 ),
+    docPool( new PopplerDocumentPool( qBound( 1, QThread::idealThreadCount() - 1, 3 ) ) ),
     docInfoDirty( true ), docSynopsisDirty( true ),
-    docEmbeddedFilesDirty( true ), nextFontPage( 0 ),
+    docEmbeddedFilesDirty( true ), nextFontPage( 0 ), fontsDoc( 0 ),
     dpiX( 72.0 /*Okular::Utils::dpiX()*/ ), dpiY( 72.0 /*Okular::Utils::dpiY()*/ ),
-    annotProxy( 0 ), synctex_scanner( 0 )
+    annotProxy( 0 ), nextMetaDataPage( 0 ), synctex_scanner( 0 )
 {
     setFeature( Threaded );
     setFeature( TextExtraction );
@@ -443,6 +448,9 @@ PDFGenerator::PDFGenerator( QObject *parent, const QVariantList &args )
     setFeature( ReadRawData );
     setFeature( TiledRendering );
 
+    metaDataTimer.setInterval( 0 );
+    connect( &metaDataTimer, SIGNAL(timeout()), this, SLOT(loadPendingPageMetaData()) );
+
 #ifdef HAVE_POPPLER_0_16
     // You only need to do it once not for each of the documents but it is cheap enough
     // so doing it all the time won't hurt either
@@ -453,6 +461,7 @@ PDFGenerator::PDFGenerator( QObject *parent, const QVariantList &args )
 PDFGenerator::~PDFGenerator()
 {
     delete pdfOptionsPage;
+    delete docPool;
 }
 
 //BEGIN Generator inherited functions
@@ -470,6 +479,9 @@ bool PDFGenerator::loadDocument( const QString & filePath, QVector<Okular::Page*
     bool success = init(pagesVector, filePath.section('/', -1, -1));
     if (success)
     {
+        docPool->setSource( filePath, QByteArray(), docPassword );
+        docPool->setRenderable( canRenderFromPool() );
+
         // no need to check for the existence of a synctex file, no parser will be
         // created if none exists
         initSynctexParser(filePath);
@@ -492,7 +504,13 @@ bool PDFGenerator::loadDocumentFromData( const QByteArray & fileData, QVector<Ok
 #endif
     // create PDFDoc for the given file
     pdfdoc = Poppler::Document::loadFromData( fileData, 0, 0 );
-    return init(pagesVector, QString());
+    bool success = init(pagesVector, QString());
+    if (success)
+    {
+        docPool->setSource( QString(), fileData, docPassword );
+        docPool->setRenderable( canRenderFromPool() );
+    }
+    return success;
 }
 
 bool PDFGenerator::init(QVector<Okular::Page*> & pagesVector, const QString &walletKey)
@@ -502,6 +520,7 @@ bool PDFGenerator::init(QVector<Okular::Page*> & pagesVector, const QString &wal
     bool triedWallet = false;
     KWallet::Wallet * wallet = 0;
     bool keep = true;
+    docPassword.clear();
     while ( pdfdoc && pdfdoc->isLocked() )
     {
         QString password;
@@ -552,6 +571,7 @@ bool PDFGenerator::init(QVector<Okular::Page*> & pagesVector, const QString &wal
 
         // 2. reopen the document using the password
         pdfdoc->unlock( password.toLatin1(), password.toLatin1() );
+        docPassword = password.toLatin1();
 
         // 3. if the password is correct and the user chose to remember it, store it to the wallet
         if ( !pdfdoc->isLocked() && wallet && /*safety check*/ wallet->isOpen() && keep )
@@ -566,6 +586,8 @@ bool PDFGenerator::init(QVector<Okular::Page*> & pagesVector, const QString &wal
         return false;
     }
 
+    pageCache = new PopplerPageCache( pdfdoc, 16 );
+
     // build Pages (currentPage was set -1 by deletePages)
     uint pageCount = pdfdoc->numPages();
     pagesVector.resize(pageCount);
@@ -575,11 +597,20 @@ bool PDFGenerator::init(QVector<Okular::Page*> & pagesVector, const QString &wal
 
     loadPages(pagesVector, 0, false);
 
+    // load the annotations, form fields, transitions and page actions once
+    // the document is shown, or as soon as a page is shown (see preparePage)
+    metaDataPages = pagesVector;
+    metaDataLoaded.fill(false, pageCount);
+    wantedMetaDataPages.clear();
+    nextMetaDataPage = 0;
+    if ( pageCount > 0 )
+        metaDataTimer.start();
+
     // update the configuration
     reparseConfig();
 
     // create annotation proxy
-    annotProxy = new PopplerAnnotationProxy( pdfdoc, userMutex() );
+    annotProxy = new PopplerAnnotationProxy( pdfdoc, userMutex(), docPool );
 
     // the file has been loaded correctly
     return true;
@@ -588,9 +619,18 @@ bool PDFGenerator::init(QVector<Okular::Page*> & pagesVector, const QString &wal
 bool PDFGenerator::doCloseDocument()
 {
     // remove internal objects
+    metaDataTimer.stop();
+    metaDataPages.clear();
+    metaDataLoaded.clear();
+    wantedMetaDataPages.clear();
+    nextMetaDataPage = 0;
+    docPool->clear();
+    docPassword.clear();
     userMutex()->lock();
     delete annotProxy;
     annotProxy = 0;
+    delete pageCache;
+    pageCache = 0;
     delete pdfdoc;
     pdfdoc = 0;
     userMutex()->unlock();
@@ -601,6 +641,8 @@ bool PDFGenerator::doCloseDocument()
     qDeleteAll(docEmbeddedFiles);
     docEmbeddedFiles.clear();
     nextFontPage = 0;
+    delete fontsDoc;
+    fontsDoc = 0;
     rectsGenerated.clear();
     if ( synctex_scanner )
     {
@@ -636,25 +678,11 @@ void PDFGenerator::loadPages(QVector<Okular::Page*> &pagesVector, int rotation,
             }
             if (rotation % 2 == 1)
             qSwap(w,h);
-            // init a Okular::page, add transition and annotation information
+            // init a Okular::page; the annotations, form fields, transition
+            // and page actions are added by loadPageMetaData
             page = new Okular::Page( i, w, h, orientation );
-            addTransition( p, page );
-            if ( true ) //TODO real check
-            addAnnotations( p, page );
-            Poppler::Link * tmplink = p->action( Poppler::Page::Opening );
-            if ( tmplink )
-            {
-                page->setPageAction( Okular::Page::Opening, createLinkFromPopplerLink( tmplink ) );
-            }
-            tmplink = p->action( Poppler::Page::Closing );
-            if ( tmplink )
-            {
-                page->setPageAction( Okular::Page::Closing, createLinkFromPopplerLink( tmplink ) );
-            }
             page->setDuration( p->duration() );
             page->setLabel( p->label() );
-
-            addFormFields( p, page );
 //        kWarning(PDFDebug).nospace() << page->width() << "x" << page->height();
 
 #ifdef PDFGENERATOR_DEBUG
@@ -674,6 +702,100 @@ void PDFGenerator::loadPages(QVector<Okular::Page*> &pagesVector, int rotation,
     }
 }
 
+bool PDFGenerator::loadPageMetaData( int pageNumber )
+{
+    if ( pageNumber < 0 || pageNumber >= metaDataPages.count() || metaDataLoaded.testBit( pageNumber ) )
+        return true;
+
+    // pdfdoc may be rendering in the generator thread; don't wait for it
+    // in the GUI thread, the page is tried again later
+    if ( !userMutex()->tryLock() )
+        return false;
+
+    metaDataLoaded.setBit( pageNumber );
+    Okular::Page *page = metaDataPages.at( pageNumber );
+    bool itemsAdded = false;
+
+    Poppler::Page *p = pageCache->page( pageNumber );
+    if ( p )
+    {
+        const int annotationCount = page->annotations().count();
+        addAnnotations( p, page );
+#ifdef HAVE_POPPLER_0_22
+        // don't look for fields page by page when the document has no form
+        if ( pdfdoc->formType() != Poppler::Document::NoForm )
+#endif
+            addFormFields( p, page );
+        itemsAdded = page->annotations().count() != annotationCount || !page->formFields().isEmpty();
+
+        addTransition( p, page );
+        Poppler::Link * tmplink = p->action( Poppler::Page::Opening );
+        if ( tmplink )
+        {
+            page->setPageAction( Okular::Page::Opening, createLinkFromPopplerLink( tmplink ) );
+        }
+        tmplink = p->action( Poppler::Page::Closing );
+        if ( tmplink )
+        {
+            page->setPageAction( Okular::Page::Closing, createLinkFromPopplerLink( tmplink ) );
+        }
+        // the page may have been rendered already, so the media links
+        // of its actions and items would not be resolved otherwise
+        resolveMediaLinkReferences( page );
+    }
+    userMutex()->unlock();
+
+    if ( itemsAdded )
+        signalPageItemsAdded( pageNumber );
+    return true;
+}
+
+void PDFGenerator::preparePage( int pageNumber )
+{
+    // the items of a page are read as soon as it is shown, so don't wait
+    // for the timer to get to it, unless pdfdoc is busy
+    if ( loadPageMetaData( pageNumber ) )
+        return;
+
+    if ( !wantedMetaDataPages.contains( pageNumber ) )
+        wantedMetaDataPages.append( pageNumber );
+    metaDataTimer.start( 20 );
+}
+
+void PDFGenerator::loadPendingPageMetaData()
+{
+    // first the pages being shown that preparePage() could not load, then
+    // all the others without blocking the event loop for long
+    QTime time;
+    time.start();
+    while ( !wantedMetaDataPages.isEmpty() )
+    {
+        if ( !loadPageMetaData( wantedMetaDataPages.first() ) )
+        {
+            // pdfdoc is busy, retry a bit later
+            metaDataTimer.start( 20 );
+            return;
+        }
+        wantedMetaDataPages.removeFirst();
+    }
+
+    const int count = metaDataPages.count();
+    while ( nextMetaDataPage < count && time.elapsed() < 20 )
+    {
+        if ( !loadPageMetaData( nextMetaDataPage ) )
+        {
+            metaDataTimer.start( 20 );
+            return;
+        }
+        ++nextMetaDataPage;
+    }
+
+    if ( nextMetaDataPage >= count )
+        metaDataTimer.stop();
+    else
+        metaDataTimer.start( 0 );
+}
+
 const Okular::DocumentInfo * PDFGenerator::generateDocumentInfo()
 {
     if ( docInfoDirty )
@@ -822,10 +944,25 @@ Okular::FontInfo::List PDFGenerator::fontsForPage( int page )
     if ( page != nextFontPage )
         return list;
 
+    // scan a copy of the document, kept for the whole scan as the scanner
+    // goes on from the page it stopped at, so that pdfdoc can render meanwhile
+    if ( page == 0 )
+    {
+        delete fontsDoc;
+        fontsDoc = docPool->openDetached();
+    }
+
     QList<Poppler::FontInfo> fonts;
-    userMutex()->lock();
-    pdfdoc->scanForFonts( 1, &fonts );
-    userMutex()->unlock();
+    if ( fontsDoc )
+    {
+        fontsDoc->scanForFonts( 1, &fonts );
+    }
+    else
+    {
+        userMutex()->lock();
+        pdfdoc->scanForFonts( 1, &fonts );
+        userMutex()->unlock();
+    }
 
     foreach (const Poppler::FontInfo &font, fonts)
     {
@@ -844,6 +981,11 @@ Okular::FontInfo::List PDFGenerator::fontsForPage( int page )
     }
 
     ++nextFontPage;
+    if ( fontsDoc && nextFontPage >= fontsDoc->numPages() )
+    {
+        delete fontsDoc;
+        fontsDoc = 0;
+    }
 
     return list;
 }
@@ -911,12 +1053,15 @@ QImage PDFGenerator::image( Okular::PixmapRequest * request )
     // generate links rects only the first time
     bool genObjectRects = !rectsGenerated.at( page->number() );
 
-    // 0. LOCK [waits for the thread end]
-    userMutex()->lock();
+    // 0. render on a copy of the document while it renders like pdfdoc, so that
+    // pdfdoc stays free for the other jobs; LOCK otherwise [waits for the thread end]
+    PooledDocument pooled( docPool->isRenderable() ? docPool : 0 );
+    if ( !pooled.document() )
+        userMutex()->lock();
 
     // 1. Set OutputDev parameters and Generate contents
     // note: thread safety is set on 'false' for the GUI (this) thread
-    Poppler::Page *p = pdfdoc->page(page->number());
+    Poppler::Page *p = pooled.document() ? pooled.page( page->number() ) : pageCache->page(page->number());
 
     // 2. Take data from outputdev and attach it to the Page
     QImage img;
@@ -938,6 +1083,13 @@ QImage PDFGenerator::image( Okular::PixmapRequest * request )
         img.fill( Qt::white );
     }
 
+    if ( pooled.document() )
+    {
+        // the links are taken from pdfdoc, their media links refer to its annotations
+        userMutex()->lock();
+        p = genObjectRects ? pageCache->page(page->number()) : 0;
+    }
+
     if ( p && genObjectRects )
     {
         // TODO previously we extracted Image type rects too, but that needed porting to poppler
@@ -952,8 +1104,6 @@ QImage PDFGenerator::image( Okular::PixmapRequest * request )
     // 3. UNLOCK [re-enables shared access]
     userMutex()->unlock();
 
-    delete p;
-
     return img;
 }
 
@@ -1040,24 +1190,28 @@ Okular::TextPage* PDFGenerator::textPage( Okular::Page *page )
     // build a TextList...
     QList<Poppler::TextBox*> textList;
     double pageWidth, pageHeight;
-    Poppler::Page *pp = pdfdoc->page( page->number() );
+
+    // use a copy of the document if available, so that the text can be
+    // extracted while pdfdoc is rendering
+    PooledDocument pooled( docPool );
+    if ( !pooled.document() )
+        userMutex()->lock();
+    Poppler::Page *pp = pooled.document() ? pooled.page( page->number() ) : pageCache->page( page->number() );
     if (pp)
     {
-        userMutex()->lock();
         textList = pp->textList();
-        userMutex()->unlock();
 
         QSizeF s = pp->pageSizeF();
         pageWidth = s.width();
         pageHeight = s.height();
-
-        delete pp;
     }
     else
     {
         pageWidth = defaultPageWidth;
         pageHeight = defaultPageHeight;
     }
+    if ( !pooled.document() )
+        userMutex()->unlock();
 
     Okular::TextPage *tp = abstractTextPage(textList, pageHeight, pageWidth, (Poppler::Page::Rotation)page->orientation());
     qDeleteAll(textList);
@@ -1087,12 +1241,11 @@ bool PDFGenerator::print( QPrinter& printer )
 
         const int page = pageList.at( i ) - 1;
         userMutex()->lock();
-        Poppler::Page *pp = pdfdoc->page( page );
+        Poppler::Page *pp = pageCache->page( page );
         if (pp)
         {
             QImage img = pp->renderToImage(  printer.physicalDpiX(), printer.physicalDpiY() );
             painter.drawImage( painter.window(), img, QRectF(0, 0, img.width(), img.height()) );
-            delete pp;
         }
         userMutex()->unlock();
     }
@@ -1281,9 +1434,21 @@ bool PDFGenerator::reparseConfig()
     }
     bool aaChanged = setDocumentRenderHints();
     somethingchanged = somethingchanged || aaChanged;
+    docPool->setRenderSettings( pdfdoc->renderHints(), pdfdoc->paperColor() );
     return somethingchanged;
 }
 
+bool PDFGenerator::canRenderFromPool() const
+{
+    // the form fields are edited directly on pdfdoc, which the copies in the
+    // pool do not see, so they render only the documents without forms
+#ifdef HAVE_POPPLER_0_22
+    return pdfdoc->formType() == Poppler::Document::NoForm;
+#else
+    return false;
+#endif
+}
+
 void PDFGenerator::addPages( KConfigDialog *dlg )
 {
 #ifdef HAVE_POPPLER_0_24
@@ -1350,19 +1515,28 @@ bool PDFGenerator::exportTo( const QString &fileName, const Okular::ExportFormat
             return false;
 
         QTextStream ts( &f );
+        PooledDocument pooled( docPool );
         int num = document()->pages();
         for ( int i = 0; i < num; ++i )
         {
             QString text;
-            userMutex()->lock();
-            Poppler::Page *pp = pdfdoc->page(i);
-            if (pp)
+            if ( pooled.document() )
             {
-                text = pp->text(QRect()).normalized(QString::NormalizationForm_KC);
+                Poppler::Page *pp = pooled.page(i);
+                if (pp)
+                    text = pp->text(QRect()).normalized(QString::NormalizationForm_KC);
+            }
+            else
+            {
+                userMutex()->lock();
+                Poppler::Page *pp = pageCache->page(i);
+                if (pp)
+                {
+                    text = pp->text(QRect()).normalized(QString::NormalizationForm_KC);
+                }
+                userMutex()->unlock();
             }
-            userMutex()->unlock();
             ts << text;
-            delete pp;
         }
         f.close();
 
@@ -1482,8 +1656,23 @@ void PDFGenerator::addAnnotations( Poppler::Page * popplerPage, Okular::Page * p
     // Reverse the list so that the z-order of Poppler/PDF matches the z-order used by Okular
     std::reverse(popplerAnnotations.begin(), popplerAnnotations.end());
 
+    // the annotations added through the proxy before this page was loaded
+    // are in pdfdoc already, don't add them twice
+    QSet<QString> existingNames;
+    foreach(const Okular::Annotation *annotation, page->annotations())
+    {
+        if ( !annotation->uniqueName().isEmpty() )
+            existingNames.insert( annotation->uniqueName() );
+    }
+
     foreach(Poppler::Annotation *a, popplerAnnotations)
     {
+        if ( !a->uniqueName().isEmpty() && existingNames.contains( a->uniqueName() ) )
+        {
+            delete a;
+            continue;
+        }
+
         bool doDelete = true;
         Okular::Annotation * newann = createAnnotationFromPopplerAnnotation( a, &doDelete );
         if (newann)
@@ -1536,7 +1725,7 @@ void PDFGenerator::addAnnotations( Poppler::Page * popplerPage, Okular::Page * p
 }
 
 void PDFGenerator::addTransition( Poppler::Page * pdfPage, Okular::Page * page )
-// called on opening when MUTEX is not used
+// called by loadPageMetaData with the MUTEX locked
 {
     Poppler::PageTransition *pdfTransition = pdfPage->transition();
     if ( !pdfTransition || pdfTransition->type() == Poppler::PageTransition::Replace )
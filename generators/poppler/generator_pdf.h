@@ -19,6 +19,7 @@
 
 #include <qbitarray.h>
 #include <qpointer.h>
+#include <qtimer.h>
 
 #include <core/document.h>
 #include <core/generator.h>
@@ -33,6 +34,8 @@ class SourceReference;
 
 class PDFOptionsPage;
 class PopplerAnnotationProxy;
+class PopplerDocumentPool;
+class PopplerPageCache;
 
 /**
  * @short A generator that builds contents from a PDF document.
@@ -106,6 +109,11 @@ class PDFGenerator : public Okular::Generator, public Okular::ConfigInterface, p
         void requestFontData(const Okular::FontInfo &font, QByteArray *data);
         const Okular::SourceReference * dynamicSourceReference( int pageNr, double absX, double absY );
         Okular::Generator::PrintError printError() const;
+        void preparePage( int pageNumber );
+
+    private slots:
+        // load the deferred page metadata of a few more pages
+        void loadPendingPageMetaData();
 
     private:
         bool init(QVector<Okular::Page*> & pagesVector, const QString &walletKey);
@@ -118,6 +126,9 @@ class PDFGenerator : public Okular::Generator, public Okular::ConfigInterface, p
         void addTransition( Poppler::Page * popplerPage, Okular::Page * page );
         // fetch the form fields and add them to the page
         void addFormFields( Poppler::Page * popplerPage, Okular::Page * page );
+        // fetch the annotations, form fields, transition and page actions
+        // of a page, once; returns false if pdfdoc is busy
+        bool loadPageMetaData( int pageNumber );
         // load the source references from a pdfsync file
         void loadPdfSync( const QString & fileName, QVector<Okular::Page*> & pagesVector );
         // init the synctex parser if a synctex file exists
@@ -131,9 +142,17 @@ class PDFGenerator : public Okular::Generator, public Okular::ConfigInterface, p
         void resolveMediaLinkReference( Okular::Action *action );
 
         bool setDocumentRenderHints();
+        // whether the copies of the document render it as pdfdoc does
+        bool canRenderFromPool() const;
 
         // poppler dependant stuff
         Poppler::Document *pdfdoc;
+        // the recently used pages of pdfdoc, guarded by userMutex()
+        PopplerPageCache *pageCache;
+        // read only copies of pdfdoc, for the jobs that may run
+        // while pdfdoc is busy rendering
+        PopplerDocumentPool *docPool;
+        QByteArray docPassword;
 
 
         // misc variables for document info and synopsis caching
@@ -144,6 +163,8 @@ class PDFGenerator : public Okular::Generator, public Okular::ConfigInterface, p
         mutable bool docEmbeddedFilesDirty;
         mutable QList<Okular::EmbeddedFile*> docEmbeddedFiles;
         int nextFontPage;
+        // the copy of pdfdoc scanned for fonts, 0 when not scanning
+        Poppler::Document *fontsDoc;
         double dpiX;
         double dpiY;
         PopplerAnnotationProxy *annotProxy;
@@ -151,6 +172,15 @@ class PDFGenerator : public Okular::Generator, public Okular::ConfigInterface, p
 
         QBitArray rectsGenerated;
 
+        // annotations, form fields, transitions and page actions are not
+        // needed to show the document, so they are loaded after opening it
+        QVector<Okular::Page*> metaDataPages;
+        QBitArray metaDataLoaded;
+        // the pages shown while pdfdoc was busy, loaded first
+        QList<int> wantedMetaDataPages;
+        int nextMetaDataPage;
+        QTimer metaDataTimer;
+
         QPointer<PDFOptionsPage> pdfOptionsPage;
         
         synctex_scanner_t synctex_scanner;
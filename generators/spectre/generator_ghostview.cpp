@@ -54,17 +54,17 @@ OKULAR_EXPORT_PLUGIN(GSGenerator, createAboutData())
 GSGenerator::GSGenerator( QObject *parent, const QVariantList &args ) :
     Okular::Generator( parent, args ),
     m_internalDocument(0),
-    m_docInfo(0),
-    m_request(0)
+    m_docInfo(0)
 {
     setFeature( PrintPostscript );
     setFeature( PrintToFile );
 
-    GSRendererThread *renderer = GSRendererThread::getCreateRenderer();
-    if (!renderer->isRunning()) renderer->start();
-    connect(renderer, SIGNAL(imageDone(QImage*,Okular::PixmapRequest*)),
-                      SLOT(slotImageGenerated(QImage*,Okular::PixmapRequest*)),
-                      Qt::QueuedConnection);
+    foreach (GSRendererThread *renderer, GSRendererThread::renderers())
+    {
+        connect(renderer, SIGNAL(imageDone(QImage*,Okular::PixmapRequest*)),
+                          SLOT(slotImageGenerated(QImage*,Okular::PixmapRequest*)),
+                          Qt::QueuedConnection);
+    }
 }
 
 GSGenerator::~GSGenerator()
@@ -179,7 +179,11 @@ bool GSGenerator::loadDocument( const QString & fileName, QVector< Okular::Page
 
 bool GSGenerator::doCloseDocument()
 {
+    // the renderers may still be freeing pages, which drops the reference
+    // count of the document as well
+    GSRendererThread::pageMutex()->lock();
     spectre_document_free(m_internalDocument);
+    GSRendererThread::pageMutex()->unlock();
     m_internalDocument = 0;
 
     delete m_docInfo;
@@ -190,14 +194,14 @@ bool GSGenerator::doCloseDocument()
 
 void GSGenerator::slotImageGenerated(QImage *img, Okular::PixmapRequest *request)
 {
-    // This can happen as GSInterpreterCMD is a singleton and on creation signals all the slots
-    // of all the generators attached to it
-    if (request != m_request) return;
+    // This can happen as the renderers are shared and signal all the slots
+    // of all the generators attached to them
+    if (!m_requests.contains(request)) return;
 
     if ( !request->page()->isBoundingBoxKnown() )
         updatePageBoundingBox( request->page()->number(), Okular::Utils::imageBoundingBox( img ) );
 
-    m_request = 0;
+    m_requests.removeAll(request);
     QPixmap *pix = new QPixmap(QPixmap::fromImage(*img));
     delete img;
     request->page()->setPixmap( request->observer(), pix );
@@ -229,7 +233,9 @@ void GSGenerator::generatePixmap( Okular::PixmapRequest * req )
 {
     kDebug(4711) << "receiving" << *req;
 
+    GSRendererThread::pageMutex()->lock();
     SpectrePage *page = spectre_document_get_page(m_internalDocument, req->pageNumber());
+    GSRendererThread::pageMutex()->unlock();
 
     GSRendererThread *renderer = GSRendererThread::getCreateRenderer();
 
@@ -256,13 +262,14 @@ void GSGenerator::generatePixmap( Okular::PixmapRequest * req )
                               (double)req->height() / req->page()->height() );
     }
     gsreq.request = req;
-    m_request = req;
+    m_requests.append(req);
     renderer->addRequest(gsreq);
 }
 
 bool GSGenerator::canGeneratePixmap() const
 {
-    return !m_request;
+    // render as many pages at a time as there are renderers
+    return m_requests.count() < GSRendererThread::renderers().count();
 }
 
 const Okular::DocumentInfo * GSGenerator::generateDocumentInfo()
@@ -61,7 +61,8 @@ class GSGenerator : public Okular::Generator, public Okular::ConfigInterface
         SpectreDocument *m_internalDocument;
         Okular::DocumentInfo *m_docInfo;
 
-        Okular::PixmapRequest *m_request;
+        // the requests being rendered
+        QList<Okular::PixmapRequest*> m_requests;
 
         bool cache_AAtext;
         bool cache_AAgfx;
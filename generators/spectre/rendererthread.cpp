@@ -9,7 +9,9 @@
 
 #include "rendererthread.h"
 
+#include <qatomic.h>
 #include <qimage.h>
+#include <qreadwritelock.h>
 
 #include <kdebug.h>
 
@@ -17,15 +19,79 @@
 #include "core/page.h"
 #include "core/utils.h"
 
-GSRendererThread *GSRendererThread::theRenderer = 0;
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// the most renderers, as each of them runs a ghostscript instance
+static const int maxRenderers = 4;
+
+// Ghostscript builds without support for several instances in a process
+// fail to create the second one. Renders share the lock for reading until
+// that happens, and take it for writing, one at a time, afterwards.
+static QReadWriteLock ghostscriptLock;
+static QAtomicInt singleInstance;
+// the renders running and started, to tell if a render overlapped another
+static QAtomicInt activeRenders;
+static QAtomicInt startedRenders;
+
+// Qt needs the missing alpha of QImage::Format_RGB32 to be 0xff
+static void fixAlpha(unsigned char *data, int size)
+{
+    int i = 0;
+#ifdef __SSE2__
+    const __m128i alpha = _mm_set1_epi32(0xFF000000);
+    for ( ; i + 16 <= size; i += 16)
+    {
+        const __m128i p = _mm_loadu_si128((const __m128i *)(data + i));
+        _mm_storeu_si128((__m128i *)(data + i), _mm_or_si128(p, alpha));
+    }
+#endif
+    for (i += 3; i < size; i += 4)
+        data[i] = 0xff;
+}
+
+QList<GSRendererThread*> GSRendererThread::thePool;
+
+QList<GSRendererThread*> GSRendererThread::renderers()
+{
+    if (thePool.isEmpty())
+    {
+        const int count = qBound(1, QThread::idealThreadCount(), maxRenderers);
+        for (int i = 0; i < count; ++i)
+        {
+            GSRendererThread *renderer = new GSRendererThread();
+            renderer->start();
+            thePool.append(renderer);
+        }
+    }
+    return thePool;
+}
 
 GSRendererThread *GSRendererThread::getCreateRenderer()
 {
-    if (!theRenderer) theRenderer = new GSRendererThread();
-    return theRenderer;
+    GSRendererThread *best = 0;
+    int bestPending = 0;
+    foreach (GSRendererThread *renderer, renderers())
+    {
+        QMutexLocker locker(&renderer->m_queueMutex);
+        if (!best || renderer->m_pending < bestPending)
+        {
+            best = renderer;
+            bestPending = renderer->m_pending;
+        }
+    }
+    return best;
+}
+
+QMutex *GSRendererThread::pageMutex()
+{
+    static QMutex mutex;
+    return &mutex;
 }
 
 GSRendererThread::GSRendererThread()
+    : m_pending(0)
 {
     m_renderContext = spectre_render_context_new();
 }
@@ -39,10 +105,45 @@ void GSRendererThread::addRequest(const GSRendererThreadRequest &req)
 {
     m_queueMutex.lock();
     m_queue.enqueue(req);
+    ++m_pending;
     m_queueMutex.unlock();
     m_semaphore.release();
 }
 
+void GSRendererThread::render(SpectrePage *page, unsigned char **data, int *row_length)
+{
+    if (!singleInstance)
+    {
+        ghostscriptLock.lockForRead();
+        const int started = startedRenders.fetchAndAddOrdered(1) + 1;
+        bool overlapped = activeRenders.fetchAndAddOrdered(1) > 0;
+        spectre_page_render(page, m_renderContext, data, row_length);
+        overlapped = activeRenders.fetchAndAddOrdered(-1) > 1 || overlapped || int(startedRenders) != started;
+        ghostscriptLock.unlock();
+        // a page that fails on its own does not tell anything about
+        // ghostscript
+        if (spectre_page_status(page) == SPECTRE_STATUS_SUCCESS || thePool.count() == 1 || !overlapped)
+            return;
+
+        free(*data);
+        *data = NULL;
+
+        ghostscriptLock.lockForWrite();
+        spectre_page_render(page, m_renderContext, data, row_length);
+        ghostscriptLock.unlock();
+        if (spectre_page_status(page) == SPECTRE_STATUS_SUCCESS)
+        {
+            kDebug(4711) << "Rendering failed next to another instance, rendering one page at a time from now on";
+            singleInstance = 1;
+        }
+        return;
+    }
+
+    ghostscriptLock.lockForWrite();
+    spectre_page_render(page, m_renderContext, data, row_length);
+    ghostscriptLock.unlock();
+}
+
 void GSRendererThread::run()
 {
     while(1)
@@ -68,14 +169,10 @@ void GSRendererThread::run()
             if ( req.orientation % 2 )
                 qSwap( wantedWidth, wantedHeight );
 
-            spectre_page_render(req.spectrePage, m_renderContext, &data, &row_length);
+            render(req.spectrePage, &data, &row_length);
 
-            // Qt needs the missing alpha of QImage::Format_RGB32 to be 0xff
             if (data && data[3] != 0xff)
-            {
-                for (int i = 3; i < row_length * wantedHeight; i += 4)
-                    data[i] = 0xff;
-            }
+                fixAlpha(data, row_length * wantedHeight);
 
             QImage img;
             if (row_length == wantedWidth * 4)
@@ -128,7 +225,13 @@ void GSRendererThread::run()
             }
             emit imageDone(image, req.request);
 
+            pageMutex()->lock();
             spectre_page_free(req.spectrePage);
+            pageMutex()->unlock();
+
+            m_queueMutex.lock();
+            --m_pending;
+            m_queueMutex.unlock();
         }
     }
 }
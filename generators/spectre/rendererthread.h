@@ -10,6 +10,7 @@
 #ifndef _OKULAR_GSRENDERERTHREAD_H_
 #define _OKULAR_GSRENDERERTHREAD_H_
 
+#include <qlist.h>
 #include <qmutex.h>
 #include <qqueue.h>
 #include <qsemaphore.h>
@@ -50,12 +51,34 @@ struct GSRendererThreadRequest
 };
 Q_DECLARE_TYPEINFO(GSRendererThreadRequest, Q_MOVABLE_TYPE);
 
+/**
+ * A thread rendering pages with its own spectre render context.
+ *
+ * The renderers form a process-wide pool shared by all the documents,
+ * so that several pages, of one or several documents, are rendered
+ * at the same time.
+ */
 class GSRendererThread : public QThread
 {
 Q_OBJECT
     public:
+        /**
+         * Returns the renderers of the pool, creating and starting them
+         * the first time.
+         */
+        static QList<GSRendererThread*> renderers();
+
+        /**
+         * Returns the renderer with the fewest pending requests.
+         */
         static GSRendererThread *getCreateRenderer();
 
+        /**
+         * Guards getting and freeing SpectrePage objects, which changes
+         * the reference count of their document from several threads.
+         */
+        static QMutex *pageMutex();
+
         ~GSRendererThread();
 
         void addRequest(const GSRendererThreadRequest &req);
@@ -68,12 +91,15 @@ Q_OBJECT
 
         QSemaphore m_semaphore;
 
-        static GSRendererThread *theRenderer;
+        static QList<GSRendererThread*> thePool;
 
         void run();
+        void render(SpectrePage *page, unsigned char **data, int *row_length);
 
         SpectreRenderContext *m_renderContext;
         QQueue<GSRendererThreadRequest> m_queue;
+        // the requests queued or being rendered
+        int m_pending;
         QMutex m_queueMutex;
 };
 
@@ -16,6 +16,7 @@
 #include <qimage.h>
 #include <qlist.h>
 #include <qpainter.h>
+#include <qvector.h>
 #include <QtGui/QPrinter>
 
 #include <kaboutdata.h>
@@ -31,6 +32,10 @@
 #include <tiff.h>
 #include <tiffio.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #define TiffDebug 4714
 
 tsize_t okular_tiffReadProc( thandle_t handle, tdata_t buf, tsize_t size )
@@ -86,17 +91,182 @@ void okular_tiffUnmapProc( thandle_t, tdata_t, toff_t )
 }
 
 
+// a reduced resolution version of a page
+struct ReducedImage
+{
+    toff_t offset;
+    uint32 width;
+    uint32 height;
+};
+
 class TIFFGenerator::Private
 {
     public:
         Private()
-          : tiff( 0 ), dev( 0 ) {}
+          : tiff( 0 ), dev( 0 ), lastOffset( 0 ) {}
 
         TIFF* tiff;
         QByteArray data;
         QIODevice* dev;
+        // the reduced resolution images of the pages
+        QHash< int, QList< ReducedImage > > reducedImages;
+        // the last decoded directory, reused for the requests of other sizes
+        toff_t lastOffset;
+        QImage lastImage;
 };
 
+/**
+ * Copies @p count pixels read by the TIFFReadRGBA* functions, which are ABGR,
+ * to @p dst as ARGB, swapping red and blue; @p src and @p dst can be the same.
+ */
+static void abgrToArgb( const uint32 *src, uint32 *dst, uint32 count )
+{
+    uint32 i = 0;
+#ifdef __SSE2__
+    const __m128i alphaGreen = _mm_set1_epi32( 0xFF00FF00 );
+    const __m128i blue = _mm_set1_epi32( 0x000000FF );
+    for ( ; i + 4 <= count; i += 4 )
+    {
+        const __m128i p = _mm_loadu_si128( (const __m128i *)( src + i ) );
+        const __m128i swapped = _mm_or_si128( _mm_and_si128( p, alphaGreen ),
+                                _mm_or_si128( _mm_slli_epi32( _mm_and_si128( p, blue ), 16 ),
+                                              _mm_and_si128( _mm_srli_epi32( p, 16 ), blue ) ) );
+        _mm_storeu_si128( (__m128i *)( dst + i ), swapped );
+    }
+#endif
+    for ( ; i < count; ++i )
+    {
+        const uint32 p = src[i];
+        dst[i] = ( p & 0xFF00FF00 ) | ( ( p & 0x000000FF ) << 16 ) | ( ( p >> 16 ) & 0x000000FF );
+    }
+}
+
+static QImage readTiffImage( TIFF *tiff, uint32 orientation )
+{
+    uint32 width = 1;
+    uint32 height = 1;
+    if ( TIFFGetField( tiff, TIFFTAG_IMAGEWIDTH, &width ) != 1 ||
+         TIFFGetField( tiff, TIFFTAG_IMAGELENGTH, &height ) != 1 )
+        return QImage();
+
+    QImage image( width, height, QImage::Format_RGB32 );
+    if ( image.isNull() )
+        return QImage();
+    uint32 * data = (uint32 *)image.bits();
+
+    // read data
+    if ( TIFFReadRGBAImageOriented( tiff, width, height, data, orientation ) == 0 )
+        return QImage();
+
+    // an image read by ReadRGBAImage is ABGR, we need ARGB, so swap red and blue
+    abgrToArgb( data, data, width * height );
+
+    return image;
+}
+
+static QImage whiteImage( const QSize &size )
+{
+    QImage image( size, QImage::Format_RGB32 );
+    image.fill( qRgb( 255, 255, 255 ) );
+    return image;
+}
+
+// the largest tile or strip readTiffRegion() decodes, in pixels
+static const qulonglong maxRegionRasterPixels = 4096 * 4096;
+
+/**
+ * Reads the part of the current directory of @p tiff which, once the
+ * directory is scaled to @p scaledWidth x @p scaledHeight, is @p rect,
+ * decoding only the tiles or the strips it intersects.
+ * The directory must have the top-left orientation.
+ * Returns a null image if the tiles or the strips are too big to be decoded
+ * one at a time, e.g. when the whole image is a single strip.
+ */
+static QImage readTiffRegion( TIFF *tiff, const QRect &rect, int scaledWidth, int scaledHeight )
+{
+    uint32 width = 1;
+    uint32 height = 1;
+    if ( TIFFGetField( tiff, TIFFTAG_IMAGEWIDTH, &width ) != 1 ||
+         TIFFGetField( tiff, TIFFTAG_IMAGELENGTH, &height ) != 1 )
+        return QImage();
+
+    // the part of the directory to decode
+    const double xScale = (double)width / scaledWidth;
+    const double yScale = (double)height / scaledHeight;
+    const QRect source = QRectF( rect.x() * xScale, rect.y() * yScale,
+                                 rect.width() * xScale, rect.height() * yScale ).toAlignedRect()
+                         & QRect( 0, 0, width, height );
+    if ( source.isEmpty() )
+        return QImage();
+
+    QImage region( source.size(), QImage::Format_RGB32 );
+    region.fill( qRgb( 255, 255, 255 ) );
+
+    if ( TIFFIsTiled( tiff ) )
+    {
+        uint32 tileWidth = 0;
+        uint32 tileHeight = 0;
+        TIFFGetField( tiff, TIFFTAG_TILEWIDTH, &tileWidth );
+        TIFFGetField( tiff, TIFFTAG_TILELENGTH, &tileHeight );
+        if ( tileWidth == 0 || tileHeight == 0 || (qulonglong)tileWidth * tileHeight > maxRegionRasterPixels )
+            return QImage();
+
+        QVector< uint32 > raster( tileWidth * tileHeight );
+        for ( uint32 ty = source.top() / tileHeight * tileHeight; ty <= (uint32)source.bottom(); ty += tileHeight )
+        {
+            for ( uint32 tx = source.left() / tileWidth * tileWidth; tx <= (uint32)source.right(); tx += tileWidth )
+            {
+                if ( !TIFFReadRGBATile( tiff, tx, ty, raster.data() ) )
+                    continue;
+
+                // the rows of the tile are bottom-up, the last ones first
+                const QRect part = QRect( tx, ty, qMin( tileWidth, width - tx ), qMin( tileHeight, height - ty ) ) & source;
+                for ( int y = part.top(); y <= part.bottom(); ++y )
+                {
+                    const uint32 *src = raster.constData() + ( tileHeight - 1 - ( y - ty ) ) * tileWidth + ( part.left() - tx );
+                    uint32 *dst = (uint32 *)region.scanLine( y - source.top() ) + ( part.left() - source.left() );
+                    abgrToArgb( src, dst, part.width() );
+                }
+            }
+        }
+    }
+    else
+    {
+        uint32 rowsPerStrip = height;
+        TIFFGetField( tiff, TIFFTAG_ROWSPERSTRIP, &rowsPerStrip );
+        rowsPerStrip = qBound( (uint32)1, rowsPerStrip, height );
+        if ( (qulonglong)width * rowsPerStrip > maxRegionRasterPixels )
+            return QImage();
+
+        QVector< uint32 > raster( width * rowsPerStrip );
+        for ( uint32 sy = source.top() / rowsPerStrip * rowsPerStrip; sy <= (uint32)source.bottom(); sy += rowsPerStrip )
+        {
+            if ( !TIFFReadRGBAStrip( tiff, sy, raster.data() ) )
+                continue;
+
+            // the rows of the strip are bottom-up, the last ones first
+            const int rows = qMin( rowsPerStrip, height - sy );
+            const int first = qMax( (int)sy, source.top() );
+            const int last = qMin( (int)sy + rows - 1, source.bottom() );
+            for ( int y = first; y <= last; ++y )
+            {
+                const uint32 *src = raster.constData() + ( rows - 1 - ( y - sy ) ) * width + source.left();
+                uint32 *dst = (uint32 *)region.scanLine( y - source.top() );
+                abgrToArgb( src, dst, source.width() );
+            }
+        }
+    }
+
+    return region.scaled( rect.size(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
+}
+
+static bool isReducedImage( TIFF *tiff )
+{
+    uint32 subfiletype = 0;
+    return TIFFGetField( tiff, TIFFTAG_SUBFILETYPE, &subfiletype ) == 1 &&
+           ( subfiletype & FILETYPE_REDUCEDIMAGE );
+}
+
 static QDateTime convertTIFFDateTime( const char* tiffdate )
 {
     if ( !tiffdate )
@@ -181,6 +351,7 @@ TIFFGenerator::TIFFGenerator( QObject *parent, const QVariantList &args )
       d( new Private ), m_docInfo( 0 )
 {
     setFeature( Threaded );
+    setFeature( TiledRendering );
     setFeature( PrintNative );
     setFeature( PrintToFile );
     setFeature( ReadRawData );
@@ -248,6 +419,9 @@ bool TIFFGenerator::doCloseDocument()
         delete m_docInfo;
         m_docInfo = 0;
         m_pageMapping.clear();
+        d->reducedImages.clear();
+        d->lastOffset = 0;
+        d->lastImage = QImage();
     }
 
     return true;
@@ -258,37 +432,83 @@ QImage TIFFGenerator::image( Okular::PixmapRequest * request )
     bool generated = false;
     QImage img;
 
-    if ( TIFFSetDirectory( d->tiff, mapPage( request->page()->number() ) ) )
+    const int pageNumber = request->page()->number();
+    if ( TIFFSetDirectory( d->tiff, mapPage( pageNumber ) ) )
     {
         int rotation = request->page()->rotation();
-        uint32 width = 1;
-        uint32 height = 1;
-        uint32 orientation = 0;
-        TIFFGetField( d->tiff, TIFFTAG_IMAGEWIDTH, &width );
-        TIFFGetField( d->tiff, TIFFTAG_IMAGELENGTH, &height );
+        int reqwidth = request->width();
+        int reqheight = request->height();
+        if ( rotation % 2 == 1 )
+            qSwap( reqwidth, reqheight );
+
+        // decode the smallest reduced resolution image still big enough,
+        // if the file has any
+        toff_t offset = TIFFCurrentDirOffset( d->tiff );
+        const ReducedImage *best = 0;
+        const QList< ReducedImage > reducedImages = d->reducedImages.value( pageNumber );
+        foreach ( const ReducedImage &reduced, reducedImages )
+        {
+            if ( reduced.width >= (uint32)reqwidth && reduced.height >= (uint32)reqheight &&
+                 ( !best || reduced.width < best->width ) )
+                best = &reduced;
+        }
+        bool ok = true;
+        if ( best )
+        {
+            offset = best->offset;
+            ok = TIFFSetSubDirectory( d->tiff, offset );
+        }
 
-        if ( !TIFFGetField( d->tiff, TIFFTAG_ORIENTATION, &orientation ) )
+        uint32 orientation = 0;
+        if ( ok && !TIFFGetField( d->tiff, TIFFTAG_ORIENTATION, &orientation ) )
             orientation = ORIENTATION_TOPLEFT;
 
-        QImage image( width, height, QImage::Format_RGB32 );
-        uint32 * data = (uint32 *)image.bits();
+        // for a tile, decode only the tiles or the strips it intersects,
+        // unless the whole image is at hand already
+        const bool cached = ok && offset == d->lastOffset && !d->lastImage.isNull();
+        if ( ok && request->isTile() && !cached && orientation == ORIENTATION_TOPLEFT )
+        {
+            const QRect rect = request->normalizedRect().geometry( reqwidth, reqheight );
+            img = readTiffRegion( d->tiff, rect, reqwidth, reqheight );
+            if ( !img.isNull() )
+                return img;
+            // the strips are too big to be read one by one, decode the
+            // whole image instead
+        }
 
-        // read data
-        if ( TIFFReadRGBAImageOriented( d->tiff, width, height, data, orientation ) != 0 )
+        QImage image;
+        if ( cached )
         {
-            // an image read by ReadRGBAImage is ABGR, we need ARGB, so swap red and blue
-            uint32 size = width * height;
-            for ( uint32 i = 0; i < size; ++i )
+            image = d->lastImage;
+        }
+        else if ( ok )
+        {
+            image = readTiffImage( d->tiff, orientation );
+
+            // keep it for the next requests, unless it is huge
+            const bool keep = (qulonglong)image.width() * image.height() <= 4096 * 4096;
+            d->lastOffset = keep ? offset : 0;
+            d->lastImage = keep ? image : QImage();
+        }
+
+        if ( !image.isNull() && request->isTile() )
+        {
+            // scale only the part of the image in the tile
+            const QRect rect = request->normalizedRect().geometry( reqwidth, reqheight );
+            const double xScale = (double)image.width() / reqwidth;
+            const double yScale = (double)image.height() / reqheight;
+            const QRect source = QRectF( rect.x() * xScale, rect.y() * yScale,
+                                         rect.width() * xScale, rect.height() * yScale ).toAlignedRect()
+                                 & image.rect();
+            if ( !source.isEmpty() )
             {
-                uint32 red = ( data[i] & 0x00FF0000 ) >> 16;
-                uint32 blue = ( data[i] & 0x000000FF ) << 16;
-                data[i] = ( data[i] & 0xFF00FF00 ) + red + blue;
-            }
+                img = image.copy( source ).scaled( rect.size(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
 
-            int reqwidth = request->width();
-            int reqheight = request->height();
-            if ( rotation % 2 == 1 )
-                qSwap( reqwidth, reqheight );
+                generated = true;
+            }
+        }
+        else if ( !image.isNull() )
+        {
             img = image.scaled( reqwidth, reqheight, Qt::IgnoreAspectRatio, Qt::SmoothTransformation );
 
             generated = true;
@@ -297,8 +517,10 @@ QImage TIFFGenerator::image( Okular::PixmapRequest * request )
 
     if ( !generated )
     {
-        img = QImage( request->width(), request->height(), QImage::Format_RGB32 );
-        img.fill( qRgb( 255, 255, 255 ) );
+        const QSize size = request->isTile()
+                           ? request->normalizedRect().geometry( request->width(), request->height() ).size()
+                           : QSize( request->width(), request->height() );
+        img = whiteImage( size );
     }
 
     return img;
@@ -364,6 +586,27 @@ void TIFFGenerator::loadPages( QVector<Okular::Page*> & pagesVector )
              TIFFGetField( d->tiff, TIFFTAG_IMAGELENGTH, &height ) != 1 )
             continue;
 
+        // a reduced resolution version of the previous page, not a page
+        if ( isReducedImage( d->tiff ) )
+        {
+            if ( realdirs > 0 )
+            {
+                ReducedImage reduced = { TIFFCurrentDirOffset( d->tiff ), width, height };
+                d->reducedImages[ realdirs - 1 ].append( reduced );
+            }
+            continue;
+        }
+
+        // the reduced resolution versions can also be in sub directories
+        uint16 subCount = 0;
+        toff_t *subOffsets = 0;
+        QVector< toff_t > subDirs;
+        if ( TIFFGetField( d->tiff, TIFFTAG_SUBIFD, &subCount, &subOffsets ) == 1 )
+        {
+            for ( uint16 j = 0; j < subCount; ++j )
+                subDirs.append( subOffsets[j] );
+        }
+
         adaptSizeToResolution( d->tiff, TIFFTAG_XRESOLUTION, dpiX, &width );
         adaptSizeToResolution( d->tiff, TIFFTAG_YRESOLUTION, dpiY, &height );
 
@@ -372,6 +615,19 @@ void TIFFGenerator::loadPages( QVector<Okular::Page*> & pagesVector )
 
         m_pageMapping[ realdirs ] = i;
 
+        foreach ( toff_t subDir, subDirs )
+        {
+            uint32 subWidth = 0;
+            uint32 subHeight = 0;
+            if ( TIFFSetSubDirectory( d->tiff, subDir ) && isReducedImage( d->tiff ) &&
+                 TIFFGetField( d->tiff, TIFFTAG_IMAGEWIDTH, &subWidth ) == 1 &&
+                 TIFFGetField( d->tiff, TIFFTAG_IMAGELENGTH, &subHeight ) == 1 )
+            {
+                ReducedImage reduced = { subDir, subWidth, subHeight };
+                d->reducedImages[ realdirs ].append( reduced );
+            }
+        }
+
         ++realdirs;
     }
 
@@ -398,20 +654,11 @@ bool TIFFGenerator::print( QPrinter& printer )
              TIFFGetField( d->tiff, TIFFTAG_IMAGELENGTH, &height ) != 1 )
             continue;
 
-        QImage image( width, height, QImage::Format_RGB32 );
-        uint32 * data = (uint32 *)image.bits();
-
-        // read data
-        if ( TIFFReadRGBAImageOriented( d->tiff, width, height, data, ORIENTATION_TOPLEFT ) != 0 )
+        QImage image = readTiffImage( d->tiff, ORIENTATION_TOPLEFT );
+        if ( image.isNull() )
         {
-            // an image read by ReadRGBAImage is ABGR, we need ARGB, so swap red and blue
-            uint32 size = width * height;
-            for ( uint32 i = 0; i < size; ++i )
-            {
-                uint32 red = ( data[i] & 0x00FF0000 ) >> 16;
-                uint32 blue = ( data[i] & 0x000000FF ) << 16;
-                data[i] = ( data[i] & 0xFF00FF00 ) + red + blue;
-            }
+            image = QImage( width, height, QImage::Format_RGB32 );
+            image.fill( qRgb( 255, 255, 255 ) );
         }
 
         if ( i != 0 )
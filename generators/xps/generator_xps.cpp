@@ -726,6 +726,45 @@ static void applySpreadStyleToQGradient( const QString &style, QGradient *qgrad
     }
 }
 
+/**
+    Read the advance widths of the characters from an Indices attribute;
+    the characters without an advance width get -1.0
+    \param data the value of the Indices attribute
+    \param fontSize the FontRenderingEmSize of the glyphs
+
+    \see XPS specification 5.1.3
+*/
+static QList<qreal> glyphAdvanceWidths( const QString &data, float fontSize )
+{
+    // partial handling only
+    QList<qreal> advanceWidths;
+    if ( ! data.isEmpty() ) {
+        QStringList indicesElements = data.split( ';' );
+        for( int i = 0; i < indicesElements.size(); ++i ) {
+            if ( indicesElements.at(i).contains( "," ) ) {
+                QStringList parts = indicesElements.at(i).split( ',' );
+                if (parts.size() == 2 ) {
+                    // regular advance case, no offsets
+                    advanceWidths.append( parts.at(1).toDouble() * fontSize / 100.0 );
+                } else if (parts.size() == 3 ) {
+                    // regular advance case, with uOffset
+                    qreal AdvanceWidth = parts.at(1).toDouble() * fontSize / 100.0 ;
+                    qreal uOffset = parts.at(2).toDouble() / 100.0;
+                    advanceWidths.append( AdvanceWidth + uOffset );
+                } else {
+                    // has vertical offset, but don't know how to handle that yet
+                    kDebug(XpsDebug) << "Unhandled Indices element: " << indicesElements.at(i);
+                    advanceWidths.append( -1.0 );
+                }
+            } else {
+                // no special advance case
+                advanceWidths.append( -1.0 );
+            }
+        }
+    }
+    return advanceWidths;
+}
+
 /**
     Read an UnicodeString
     \param string the raw value of UnicodeString
@@ -744,7 +783,7 @@ static QString unicodeString( const QString &raw )
 }
 
 
-XpsHandler::XpsHandler(XpsPage *page): m_page(page)
+XpsHandler::XpsHandler(XpsPage *page, XpsPageContent *content): m_page(page), m_content(content)
 {
     m_painter = NULL;
 }
@@ -822,6 +861,8 @@ void XpsHandler::processGlyph( XpsRenderNode &node )
         return;
     }
     QFont font = m_page->m_file->getFontByName( node.attributes.value("FontUri"), fontSize );
+    // the em size is in drawing units, so make the font that high on the device
+    font.setPointSizeF( fontSize * 72.0 / m_painter->device()->logicalDpiY() );
     att = node.attributes.value( "StyleSimulations" );
     if  ( !att.isEmpty() ) {
         if ( att == QLatin1String( "ItalicSimulation" ) ) {
@@ -838,6 +879,34 @@ void XpsHandler::processGlyph( XpsRenderNode &node )
     //Origin
     QPointF origin( node.attributes.value("OriginX").toDouble(), node.attributes.value("OriginY").toDouble() );
 
+    // UnicodeString, and the position of each character
+    QString stringToDraw( unicodeString( node.attributes.value( "UnicodeString" ) ) );
+    const QList<qreal> advanceWidths = glyphAdvanceWidths( node.attributes.value( "Indices" ), fontSize );
+    const QFontMetricsF metrics( font, m_painter->device() );
+    QVector<qreal> advances( stringToDraw.size() + 1 );
+    advances[0] = 0.0;
+    for ( int i = 0; i < stringToDraw.size(); ++i ) {
+        const qreal advanceWidth = advanceWidths.value( i, qreal(-1.0) );
+        advances[i + 1] = advances[i] + ( advanceWidth > 0.0 ? advanceWidth : metrics.width( stringToDraw.at( i ) ) );
+    }
+
+    // the text is recorded even when it is not visible, so it can be found
+    if ( m_content ) {
+        QTransform matrix = m_painter->worldTransform();
+        att = node.attributes.value( "RenderTransform" );
+        if ( !att.isEmpty() ) {
+            matrix = parseRscRefMatrix( att ) * matrix;
+        }
+        const QSizeF pageSize = m_page->size();
+        for ( int i = 0; i < stringToDraw.size(); ++i ) {
+            const QRectF rect = matrix.mapRect( QRectF( origin.x() + advances[i], origin.y() - metrics.height(),
+                                                        advances[i + 1] - advances[i], metrics.height() ) );
+            m_content->text.append( XpsTextBox( stringToDraw.mid( i, 1 ),
+                                                QRectF( rect.x() / pageSize.width(), rect.y() / pageSize.height(),
+                                                        rect.width() / pageSize.width(), rect.height() / pageSize.height() ) ) );
+        }
+    }
+
     //Fill
     QBrush brush;
     att = node.attributes.value("Fill");
@@ -900,47 +969,8 @@ void XpsHandler::processGlyph( XpsRenderNode &node )
         }
     }
 
-    // Indices - partial handling only
-    att = node.attributes.value( "Indices" );
-    QList<qreal> advanceWidths;
-    if ( ! att.isEmpty() ) {
-        QStringList indicesElements = att.split( ';' );
-        for( int i = 0; i < indicesElements.size(); ++i ) {
-            if ( indicesElements.at(i).contains( "," ) ) {
-                QStringList parts = indicesElements.at(i).split( ',' );
-                if (parts.size() == 2 ) {
-                    // regular advance case, no offsets
-                    advanceWidths.append( parts.at(1).toDouble() * fontSize / 100.0 );
-                } else if (parts.size() == 3 ) {
-                    // regular advance case, with uOffset
-                    qreal AdvanceWidth = parts.at(1).toDouble() * fontSize / 100.0 ;
-                    qreal uOffset = parts.at(2).toDouble() / 100.0;
-                    advanceWidths.append( AdvanceWidth + uOffset );
-                } else {
-                    // has vertical offset, but don't know how to handle that yet
-                    kDebug(XpsDebug) << "Unhandled Indices element: " << indicesElements.at(i);
-                    advanceWidths.append( -1.0 );
-                }
-            } else {
-                // no special advance case
-                advanceWidths.append( -1.0 );
-            }
-        }
-    }
-
-    // UnicodeString
-    QString stringToDraw( unicodeString( node.attributes.value( "UnicodeString" ) ) );
-    QPointF originAdvance(0, 0);
-    QFontMetrics metrics = m_painter->fontMetrics();
     for ( int i = 0; i < stringToDraw.size(); ++i ) {
-        QChar thisChar = stringToDraw.at( i );
-        m_painter->drawText( origin + originAdvance, QString( thisChar ) );
-	const qreal advanceWidth = advanceWidths.value( i, qreal(-1.0) );
-        if ( advanceWidth > 0.0 ) {
-            originAdvance.rx() += advanceWidth;
-        } else {
-            originAdvance.rx() += metrics.width( thisChar );
-        }
+        m_painter->drawText( origin + QPointF( advances[i], 0 ), QString( stringToDraw.at( i ) ) );
     }
     // kDebug(XpsDebug) << "Glyphs: " << atts.value("Fill") << ", " << atts.value("FontUri");
     // kDebug(XpsDebug) << "    Origin: " << atts.value("OriginX") << "," << atts.value("OriginY");
@@ -982,6 +1012,9 @@ void XpsHandler::processImageBrush( XpsRenderNode &node )
     QRectF viewport = stringToRectF( node.attributes.value( "Viewport" ) );
     QRectF viewbox = stringToRectF( node.attributes.value( "Viewbox" ) );
     QImage image = m_page->loadImageFromFile( node.attributes.value( "ImageSource" ) );
+    if ( m_content ) {
+        m_content->imageBytes += image.byteCount();
+    }
 
     // Matrix which can transform [0, 0, 1, 1] rectangle to given viewbox
     QTransform viewboxMatrix = QTransform( viewbox.width() * image.physicalDpiX() / 96, 0, 0, viewbox.height() * image.physicalDpiY() / 96, viewbox.x(), viewbox.y() );
@@ -1401,10 +1434,8 @@ void XpsHandler::processEndElement( XpsRenderNode &node )
 }
 
 XpsPage::XpsPage(XpsFile *file, const QString &fileName): m_file( file ),
-    m_fileName( fileName ), m_pageIsRendered(false)
+    m_fileName( fileName )
 {
-    m_pageImage = NULL;
-
     // kDebug(XpsDebug) << "page file name: " << fileName;
 
     const KZipFileEntry* pageFile = static_cast<const KZipFileEntry *>(m_file->xpsArchive()->directory()->entry( fileName ));
@@ -1430,35 +1461,25 @@ XpsPage::XpsPage(XpsFile *file, const QString &fileName): m_file( file ),
 
 XpsPage::~XpsPage()
 {
-    delete m_pageImage;
 }
 
-bool XpsPage::renderToImage( QImage *p )
+bool XpsPage::renderToImage( QImage *image, const QSize &scaledSize, const QPoint &offset )
 {
+    XpsPageContent *content = m_file->pageContent( this );
 
-    if ((m_pageImage == NULL) || (m_pageImage->size() != p->size())) {
-        delete m_pageImage;
-        m_pageImage = new QImage( p->size(), QImage::Format_ARGB32 );
-        // Set one point = one drawing unit. Useful for fonts, because xps specifies font size using drawing units, not points as usual
-        m_pageImage->setDotsPerMeterX( 2835 );
-        m_pageImage->setDotsPerMeterY( 2835 );
-
-        m_pageIsRendered = false;
-    }
-    if (! m_pageIsRendered) {
-        m_pageImage->fill( qRgba( 255, 255, 255, 255 ) );
-        QPainter painter( m_pageImage );
-        renderToPainter( &painter );
-        m_pageIsRendered = true;
-    }
-
-    *p = *m_pageImage;
+    image->fill( qRgba( 255, 255, 255, 255 ) );
+    QPainter painter( image );
+    painter.translate( -offset );
+    painter.scale( (qreal)scaledSize.width() / size().width(), (qreal)scaledSize.height() / size().height() );
+    painter.drawPicture( 0, 0, content->picture );
 
     return true;
 }
 
 bool XpsPage::renderToPainter( QPainter *painter )
 {
+    // the fonts of a display list are resolved for the screen, so
+    // parse the page again, with the fonts of the painter device
     XpsHandler handler( this );
     handler.m_painter = painter;
     handler.m_painter->setWorldTransform(QTransform().scale((qreal)painter->device()->width() / size().width(), (qreal)painter->device()->height() / size().height()));
@@ -1475,6 +1496,32 @@ bool XpsPage::renderToPainter( QPainter *painter )
     return true;
 }
 
+XpsPageContent* XpsPage::parseContent()
+{
+    XpsPageContent *content = new XpsPageContent();
+
+    QPainter painter( &content->picture );
+    XpsHandler handler( this, content );
+    handler.m_painter = &painter;
+    QXmlSimpleReader parser;
+    parser.setContentHandler( &handler );
+    parser.setErrorHandler( &handler );
+    const KZipFileEntry* pageFile = static_cast<const KZipFileEntry *>(m_file->xpsArchive()->directory()->entry( m_fileName ));
+    QByteArray data = readFileOrDirectoryParts( pageFile );
+    QBuffer buffer( &data );
+    QXmlInputSource source( &buffer );
+    bool ok = parser.parse( source );
+    kDebug(XpsDebug) << "Parse result: " << ok;
+    painter.end();
+
+    return content;
+}
+
+int XpsPageContent::cost() const
+{
+    return picture.size() + imageBytes + text.count() * ( sizeof( XpsTextBox ) + 16 );
+}
+
 QSizeF XpsPage::size() const
 {
     return m_pageSize;
@@ -1484,12 +1531,22 @@ QFont XpsFile::getFontByName( const QString &fileName, float size )
 {
     // kDebug(XpsDebug) << "trying to get font: " << fileName << ", size: " << size;
 
-    int index = m_fontCache.value(fileName, -1);
-    if (index == -1)
-    {
-        index = loadFontByName(fileName);
-        m_fontCache[fileName] = index;
+    // part names are case insensitive
+    const QString key = fileName.toLower();
+    QHash<QString, QFont>::const_iterator it = m_fontCache.constFind( key );
+    if ( it == m_fontCache.constEnd() ) {
+        // fonts that cannot be loaded are registered too, so they are not
+        // read from the archive again
+        it = m_fontCache.insert( key, fontByIndex( fileName, loadFontByName( fileName ) ) );
     }
+
+    QFont font = it.value();
+    font.setPointSizeF( size );
+    return font;
+}
+
+QFont XpsFile::fontByIndex( const QString &fileName, int index )
+{
     if ( index == -1 ) {
         kWarning(XpsDebug) << "Requesting uknown font:" << fileName;
         return QFont();
@@ -1507,7 +1564,7 @@ QFont XpsFile::getFontByName( const QString &fileName, float size )
       return QFont();
     }
     const QString fontStyle =  fontStyles[0];
-    return m_fontDatabase.font(fontFamily, fontStyle, qRound(size));
+    return m_fontDatabase.font( fontFamily, fontStyle, 12 );
 }
 
 int XpsFile::loadFontByName( const QString &fileName )
@@ -1560,51 +1617,73 @@ KZip * XpsFile::xpsArchive() {
     return m_xpsArchive;
 }
 
-QImage XpsPage::loadImageFromFile( const QString &fileName )
+QImage XpsFile::image( const QString &absoluteFileName )
 {
-    // kDebug(XpsDebug) << "image file name: " << fileName;
-
-    if ( fileName.at( 0 ) == QLatin1Char( '{' ) ) {
-        // for example: '{ColorConvertedBitmap /Resources/bla.wdp /Resources/foobar.icc}'
-        // TODO: properly read a ColorConvertedBitmap
-        return QImage();
+    // part names are case insensitive
+    const QString key = absoluteFileName.toLower();
+    if ( const QImage *cached = m_imageCache.object( key ) ) {
+        return *cached;
     }
 
-    QString absoluteFileName = absolutePath( entryPath( m_fileName ), fileName );
-    const KZipFileEntry* imageFile = loadFile( m_file->xpsArchive(), absoluteFileName, Qt::CaseInsensitive );
+    const KZipFileEntry* imageFile = loadFile( m_xpsArchive, absoluteFileName, Qt::CaseInsensitive );
     if ( !imageFile ) {
         // image not found
         return QImage();
     }
 
+    QByteArray data = imageFile->data();
+    QBuffer buffer(&data);
+    buffer.open(QBuffer::ReadOnly);
+
+    QImageReader reader(&buffer);
+    QImage image = reader.read();
+
     /* WORKAROUND:
         XPS standard requires to use 96dpi for images which doesn't have dpi specified (in file). When Qt loads such an image,
         it sets its dpi to qt_defaultDpi and doesn't allow to find out that it happend.
 
-        To workaround this I used this procedure: load image, set its dpi to 96, load image again. When dpi isn't set in file,
-        dpi set by me stays unchanged.
+        To workaround this, an image with the default dpi is assumed not to specify it; this avoids decoding
+        the image a second time after setting its dpi to 96.
 
         Trolltech task ID: 159527.
 
     */
+    static const int defaultDotsPerMeterX = QImage( 1, 1, QImage::Format_Mono ).dotsPerMeterX();
+    static const int defaultDotsPerMeterY = QImage( 1, 1, QImage::Format_Mono ).dotsPerMeterY();
+    if ( image.dotsPerMeterX() == defaultDotsPerMeterX && image.dotsPerMeterY() == defaultDotsPerMeterY ) {
+        image.setDotsPerMeterX(qRound(96 / 0.0254));
+        image.setDotsPerMeterY(qRound(96 / 0.0254));
+    }
 
-    QImage image;
-    QByteArray data = imageFile->data();
+    if ( !image.isNull() ) {
+        m_imageCache.insert( key, new QImage( image ), image.byteCount() );
+    }
 
-    QBuffer buffer(&data);
-    buffer.open(QBuffer::ReadOnly);
+    return image;
+}
 
-    QImageReader reader(&buffer);
-    image = reader.read();
+XpsPageContent* XpsFile::pageContent( XpsPage *page )
+{
+    XpsPageContent *content = m_pageContents.object( page );
+    if ( !content ) {
+        content = page->parseContent();
+        // a page bigger than the cache still has to stay until the next call
+        m_pageContents.insert( page, content, qMin( content->cost(), m_pageContents.maxCost() ) );
+    }
+    return content;
+}
 
-    image.setDotsPerMeterX(qRound(96 / 0.0254));
-    image.setDotsPerMeterY(qRound(96 / 0.0254));
-  
-    buffer.seek(0);
-    reader.setDevice(&buffer);
-    reader.read(&image);
+QImage XpsPage::loadImageFromFile( const QString &fileName )
+{
+    // kDebug(XpsDebug) << "image file name: " << fileName;
 
-    return image;
+    if ( fileName.at( 0 ) == QLatin1Char( '{' ) ) {
+        // for example: '{ColorConvertedBitmap /Resources/bla.wdp /Resources/foobar.icc}'
+        // TODO: properly read a ColorConvertedBitmap
+        return QImage();
+    }
+
+    return m_file->image( absolutePath( entryPath( m_fileName ), fileName ) );
 }
 
 Okular::TextPage* XpsPage::textPage()
@@ -1613,100 +1692,12 @@ Okular::TextPage* XpsPage::textPage()
 
     Okular::TextPage* textPage = new Okular::TextPage();
 
-    const KZipFileEntry* pageFile = static_cast<const KZipFileEntry *>(m_file->xpsArchive()->directory()->entry( m_fileName ));
-    QXmlStreamReader xml;
-    xml.addData( readFileOrDirectoryParts( pageFile ) );
-
-    QTransform matrix = QTransform();
-    QStack<QTransform> matrices;
-    matrices.push( QTransform() );
-    bool useMatrix = false;
-    QXmlStreamAttributes glyphsAtts;
-
-    while ( ! xml.atEnd() ) {
-        xml.readNext();
-        if ( xml.isStartElement() ) {
-            if ( xml.name() == "Canvas") {
-                matrices.push(matrix);
-
-                QString att = xml.attributes().value( "RenderTransform" ).toString();
-                if (!att.isEmpty()) {
-                    matrix = parseRscRefMatrix( att ) * matrix;
-                }
-            } else if ((xml.name() == "Canvas.RenderTransform") || (xml.name() == "Glyphs.RenderTransform")) {
-                useMatrix = true;
-            } else if (xml.name() == "MatrixTransform") {
-                if (useMatrix) {
-                    matrix = attsToMatrix( xml.attributes().value("Matrix").toString() ) * matrix;
-                }
-            } else if (xml.name() == "Glyphs") {
-                matrices.push( matrix );
-                glyphsAtts = xml.attributes();
-            } else if ( (xml.name() == "Path") || (xml.name() == "Path.Fill") || (xml.name() == "SolidColorBrush")
-                        || (xml.name() == "ImageBrush") ||  (xml.name() == "ImageBrush.Transform")
-                        || (xml.name() == "Path.OpacityMask") || (xml.name() == "Path.Data")
-                        || (xml.name() == "PathGeometry") || (xml.name() == "PathFigure")
-                        || (xml.name() == "PolyLineSegment") ) {
-                // those are only graphical - no use in text handling
-            } else if ( (xml.name() == "FixedPage") || (xml.name() == "FixedPage.Resources") ) {
-                // not useful for text extraction
-            } else {
-                kDebug(XpsDebug) << "Unhandled element in Text Extraction start: " << xml.name().toString();
-            }
-        } else if (xml.isEndElement() ) {
-            if (xml.name() == "Canvas") {
-                matrix = matrices.pop();
-            } else if ((xml.name() == "Canvas.RenderTransform") || (xml.name() == "Glyphs.RenderTransform")) {
-                useMatrix = false;
-            } else if (xml.name() == "MatrixTransform") {
-                // not clear if we need to do anything here yet.
-            } else if (xml.name() == "Glyphs") {
-                QString att = glyphsAtts.value( "RenderTransform" ).toString();
-                if (!att.isEmpty()) {
-                    matrix = parseRscRefMatrix( att ) * matrix;
-                }
-                QString text = unicodeString( glyphsAtts.value( "UnicodeString" ).toString() );
-
-                // Get font (doesn't work well because qt doesn't allow to load font from file)
-                QFont font = m_file->getFontByName( glyphsAtts.value( "FontUri" ).toString(),
-                                                    glyphsAtts.value("FontRenderingEmSize").toString().toFloat() * 72 / 96 );
-                QFontMetrics metrics = QFontMetrics( font );
-                // Origin
-                QPointF origin( glyphsAtts.value("OriginX").toString().toDouble(),
-                                glyphsAtts.value("OriginY").toString().toDouble() );
-
-
-                int lastWidth = 0;
-                for (int i = 0; i < text.length(); i++) {
-                    int width = metrics.width( text, i + 1 );
-
-                    Okular::NormalizedRect * rect = new Okular::NormalizedRect( (origin.x() + lastWidth) / m_pageSize.width(),
-                                                                                (origin.y() - metrics.height()) / m_pageSize.height(),
-                                                                                (origin.x() + width) / m_pageSize.width(),
-                                                                                origin.y() / m_pageSize.height() );
-                    rect->transform( matrix );
-                    textPage->append( text.mid(i, 1), rect );
-
-                    lastWidth = width;
-                }
-
-                matrix = matrices.pop();
-            } else if ( (xml.name() == "Path") || (xml.name() == "Path.Fill") || (xml.name() == "SolidColorBrush")
-                        || (xml.name() == "ImageBrush") ||  (xml.name() == "ImageBrush.Transform")
-                        || (xml.name() == "Path.OpacityMask") || (xml.name() == "Path.Data")
-                        || (xml.name() == "PathGeometry") || (xml.name() == "PathFigure")
-                        || (xml.name() == "PolyLineSegment") ) {
-                // those are only graphical - no use in text handling
-            } else if ( (xml.name() == "FixedPage") || (xml.name() == "FixedPage.Resources") ) {
-                // not useful for text extraction
-            } else {
-                kDebug(XpsDebug) << "Unhandled element in Text Extraction end: " << xml.name().toString();
-            }
-        }
-    }
-    if ( xml.error() ) {
-        kDebug(XpsDebug) << "Error parsing XpsPage text: " << xml.errorString();
+    const XpsPageContent *content = m_file->pageContent( this );
+    Q_FOREACH ( const XpsTextBox &box, content->text ) {
+        textPage->append( box.text, new Okular::NormalizedRect( box.rect.left(), box.rect.top(),
+                                                                box.rect.right(), box.rect.bottom() ) );
     }
+
     return textPage;
 }
 
@@ -1892,7 +1883,12 @@ XpsPage* XpsDocument::page(int pageNum) const
     return m_pages.at(pageNum);
 }
 
-XpsFile::XpsFile() : m_docInfo( 0 )
+// the memory for the display lists of the pages, in bytes
+static const int maxPageContentsCost = 32 * 1024 * 1024;
+// the memory for the decoded images, in bytes
+static const int maxImageCacheCost = 32 * 1024 * 1024;
+
+XpsFile::XpsFile() : m_docInfo( 0 ), m_pageContents( maxPageContentsCost ), m_imageCache( maxImageCacheCost )
 {
 }
 
@@ -2061,6 +2057,9 @@ bool XpsFile::closeDocument()
 
     m_docInfo = 0;
 
+    m_pageContents.clear();
+    m_imageCache.clear();
+
     qDeleteAll( m_documents );
     m_documents.clear();
 
@@ -2093,6 +2092,7 @@ XpsGenerator::XpsGenerator( QObject *parent, const QVariantList &args )
   : Okular::Generator( parent, args ), m_xpsFile( 0 )
 {
     setFeature( TextExtraction );
+    setFeature( TiledRendering );
     setFeature( PrintNative );
     setFeature( PrintToFile );
     // activate the threaded rendering iif:
@@ -2146,9 +2146,13 @@ QImage XpsGenerator::image( Okular::PixmapRequest * request )
 {
     QMutexLocker lock( userMutex() );
     QSize size( (int)request->width(), (int)request->height() );
-    QImage image( size, QImage::Format_RGB32 );
+    QRect rect( QPoint( 0, 0 ), size );
+    if ( request->isTile() ) {
+        rect = request->normalizedRect().geometry( size.width(), size.height() );
+    }
+    QImage image( rect.size(), QImage::Format_RGB32 );
     XpsPage *pageToRender = m_xpsFile->page( request->page()->number() );
-    pageToRender->renderToImage( &image );
+    pageToRender->renderToImage( &image, size, rect.topLeft() );
     return image;
 }
 
@@ -2197,6 +2201,7 @@ bool XpsGenerator::exportTo( const QString &fileName, const Okular::ExportFormat
         if ( !f.open( QIODevice::WriteOnly ) )
             return false;
 
+        QMutexLocker lock( userMutex() );
         QTextStream ts( &f );
         for ( int i = 0; i < m_xpsFile->numPages(); ++i )
         {
@@ -2222,6 +2227,7 @@ bool XpsGenerator::print( QPrinter &printer )
 
     QPainter painter( &printer );
 
+    QMutexLocker lock( userMutex() );
     for ( int i = 0; i < pageList.count(); ++i )
     {
         if ( i != 0 )
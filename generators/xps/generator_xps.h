@@ -23,10 +23,12 @@
 #include <core/generator.h>
 #include <core/textpage.h>
 
+#include <QCache>
 #include <QColor>
 #include <QDomDocument>
 #include <QFontDatabase>
 #include <QImage>
+#include <QPicture>
 #include <QXmlStreamReader>
 #include <QXmlDefaultHandler>
 #include <QStack>
@@ -103,13 +105,53 @@ struct XpsPathGeometry
     XpsMatrixTransform transform;
 };
 
+/**
+    A character of a page, and its rectangle in normalized coordinates
+*/
+struct XpsTextBox
+{
+    XpsTextBox()
+    {}
+    XpsTextBox( const QString &t, const QRectF &r )
+        : text( t ), rect( r )
+    {}
+
+    QString text;
+    QRectF rect;
+};
+
+/**
+    A parsed page: its drawing commands, which can be replayed at any
+    scale, and its text
+*/
+class XpsPageContent
+{
+public:
+    XpsPageContent()
+        : imageBytes( 0 )
+    {}
+
+    /**
+       the memory used by the content, in bytes
+    */
+    int cost() const;
+
+    QPicture picture;
+    QVector<XpsTextBox> text;
+    int imageBytes;
+};
+
 class XpsPage;
 class XpsFile;
 
 class XpsHandler: public QXmlDefaultHandler
 {
 public:
-    XpsHandler( XpsPage *page );
+    /**
+       Paints the page on the painter set in m_painter, and records
+       its text in \p content, if any
+    */
+    XpsHandler( XpsPage *page, XpsPageContent *content = 0 );
     ~XpsHandler();
 
     bool startElement( const QString & nameSpace,
@@ -138,6 +180,7 @@ protected:
     void processPathFigure( XpsRenderNode &node );
 
     QPainter *m_painter;
+    XpsPageContent *m_content;
 
     QImage m_image;
 
@@ -153,10 +196,28 @@ public:
     ~XpsPage();
 
     QSizeF size() const;
-    bool renderToImage( QImage *p );
+
+    /**
+       Renders the page scaled to \p scaledSize on \p image, which is
+       the part of the scaled page starting at \p offset.
+
+       The page is parsed once into a display list, kept in the cache
+       of its XpsFile.
+    */
+    bool renderToImage( QImage *image, const QSize &scaledSize, const QPoint &offset = QPoint() );
+
+    /**
+       Renders the page straight on \p painter, scaled to its device.
+    */
     bool renderToPainter( QPainter *painter );
+
     Okular::TextPage* textPage();
 
+    /**
+       Parses the page into a new display list.
+    */
+    XpsPageContent* parseContent();
+
     QImage loadImageFromFile( const QString &filename );
 
 private:
@@ -171,9 +232,6 @@ private:
     QImage m_thumbnail;
     bool m_thumbnailIsLoaded;
 
-    QImage *m_pageImage;
-    bool m_pageIsRendered;
-
     friend class XpsHandler;
     friend class XpsTextExtractionHandler;
 };
@@ -272,11 +330,25 @@ public:
 
     QFont getFontByName( const QString &fontName, float size );
 
+    /**
+       the image of the part \p absoluteFileName, decoded once and kept
+       in a cache bounded in bytes
+    */
+    QImage image( const QString &absoluteFileName );
+
     KZip* xpsArchive();
 
+    /**
+       the display list of a page, parsed if it is not in the cache
+
+       \note the content is valid until the next call
+    */
+    XpsPageContent* pageContent( XpsPage *page );
+
 
 private:
     int loadFontByName( const QString &fontName );
+    QFont fontByIndex( const QString &fontName, int index );
 
     QList<XpsDocument*> m_documents;
     QList<XpsPage*> m_pages;
@@ -293,8 +365,15 @@ private:
 
     KZip * m_xpsArchive;
 
-    QMap<QString, int> m_fontCache;
+    // the fonts of the document, by lower case part name
+    QHash<QString, QFont> m_fontCache;
     QFontDatabase m_fontDatabase;
+
+    // the decoded images, by lower case part name
+    QCache<QString, QImage> m_imageCache;
+
+    // the display lists of the recently shown pages, bounded in bytes
+    QCache<XpsPage*, XpsPageContent> m_pageContents;
 };
 
 
@@ -28,6 +28,7 @@
 #include <qfile.h>
 #include <qlayout.h>
 #include <qlabel.h>
+#include <qprogressbar.h>
 #include <qtimer.h>
 #include <QtGui/QPrinter>
 #include <QtGui/QPrintDialog>
@@ -43,6 +44,7 @@
 #include <kfiledialog.h>
 #include <kinputdialog.h>
 #include <kmessagebox.h>
+#include <kprogressdialog.h>
 #include <knuminput.h>
 #include <kio/netaccess.h>
 #include <kmenu.h>
@@ -289,7 +291,7 @@ const QVariantList &args,
 KComponentData componentData )
 : KParts::ReadWritePart(parent),
 m_tempfile( 0 ), m_fileWasRemoved( false ), m_showMenuBarAction( 0 ), m_showFullScreenAction( 0 ), m_actionsSearched( false ),
-m_cliPresentation(false), m_cliPrint(false), m_embedMode(detectEmbedMode(parentWidget, parent, args)), m_generatorGuiClient(0), m_keeper( 0 )
+m_cliPresentation(false), m_cliPrint(false), m_embedMode(detectEmbedMode(parentWidget, parent, args)), m_generatorGuiClient(0), m_keeper( 0 ), m_textExportDialog( 0 ), m_formsActionEnabled( false )
 {
     // first, we check if a config file name has been specified
     QString configFileName = detectConfigFileName( args );
@@ -929,6 +931,19 @@ void Part::slotHandleActivatedSourceReference(const QString& absFileName, int li
     }
 }
 
+void Part::slotFormsActionChanged()
+{
+    // the generator may add the forms of a page only once the page is about
+    // to be shown, so tell the user about them when they appear
+    const bool enabled = m_pageView->toggleFormsAction()->isEnabled();
+    if ( enabled && !m_formsActionEnabled && !m_formsMessage->isVisible() )
+    {
+        m_formsMessage->setup( i18n( "This document has forms. Click on the button to interact with them, or use View -> Show Forms." ) );
+        m_formsMessage->setVisible( true );
+    }
+    m_formsActionEnabled = enabled;
+}
+
 void Part::openUrlFromDocument(const KUrl &url)
 {
     if ( m_embedMode == PrintPreviewMode )
@@ -1443,6 +1458,9 @@ bool Part::closeUrl(bool promptToSave)
     if ( m_generatorGuiClient )
         factory()->removeClient( m_generatorGuiClient );
     m_generatorGuiClient = 0;
+    // closing the document stops the text export without notifying it
+    if ( m_textExportDialog )
+        slotTextExportCancelled();
     m_document->closeDocument();
     updateViewActions();
     delete m_tempfile;
@@ -2445,6 +2463,20 @@ void Part::slotExportAs(QAction * act)
         switch ( id )
         {
             case 0:
+                // write big documents in the background, with a progress dialog
+                if ( !m_textExportDialog && m_document->startTextExport( fileName ) )
+                {
+                    m_textExportFileName = fileName;
+                    m_textExportDialog = new KProgressDialog( widget(), i18n( "Export" ), i18n( "Exporting the text of the document..." ) );
+                    m_textExportDialog->setAllowCancel( true );
+                    m_textExportDialog->setAutoClose( false );
+                    m_textExportDialog->progressBar()->setRange( 0, m_document->pages() );
+                    connect( m_document, SIGNAL(textExportProgress(int)), this, SLOT(slotTextExportProgress(int)) );
+                    connect( m_document, SIGNAL(textExportEnded(bool)), this, SLOT(slotTextExportEnded(bool)) );
+                    connect( m_textExportDialog, SIGNAL(cancelClicked()), this, SLOT(slotTextExportCancelled()) );
+                    m_textExportDialog->show();
+                    return;
+                }
                 saved = m_document->exportToText( fileName );
                 break;
             case 1:
@@ -2460,6 +2492,40 @@ void Part::slotExportAs(QAction * act)
 }
 
 
+void Part::slotTextExportProgress(int page)
+{
+    if ( m_textExportDialog )
+        m_textExportDialog->progressBar()->setValue( page + 1 );
+}
+
+
+void Part::slotTextExportEnded(bool success)
+{
+    disconnect( m_document, SIGNAL(textExportProgress(int)), this, SLOT(slotTextExportProgress(int)) );
+    disconnect( m_document, SIGNAL(textExportEnded(bool)), this, SLOT(slotTextExportEnded(bool)) );
+    if ( m_textExportDialog )
+    {
+        m_textExportDialog->deleteLater();
+        m_textExportDialog = 0;
+    }
+
+    if ( !success )
+        KMessageBox::information( widget(), i18n("File could not be saved in '%1'. Try to save it to another location.", m_textExportFileName ) );
+}
+
+
+void Part::slotTextExportCancelled()
+{
+    m_document->stopTextExport();
+    disconnect( m_document, SIGNAL(textExportProgress(int)), this, SLOT(slotTextExportProgress(int)) );
+    disconnect( m_document, SIGNAL(textExportEnded(bool)), this, SLOT(slotTextExportEnded(bool)) );
+    if ( m_textExportDialog )
+    {
+        m_textExportDialog->deleteLater();
+        m_textExportDialog = 0;
+    }
+}
+
 void Part::slotReload()
 {
     // stop the dirty handler timer, otherwise we may conflict with the
@@ -2634,6 +2700,9 @@ void Part::unsetDummyMode()
 
     // attach the actions of the children widgets too
     m_formsMessage->setActionButton( m_pageView->toggleFormsAction() );
+    // the forms of a page may be found only when the page is shown
+    if ( m_pageView->toggleFormsAction() )
+        connect( m_pageView->toggleFormsAction(), SIGNAL(changed()), this, SLOT(slotFormsActionChanged()) );
 
     // ensure history actions are in the correct state
     updateViewActions();
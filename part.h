@@ -39,6 +39,7 @@ class QMenu;
 class KUrl;
 class KConfigGroup;
 class KDirWatch;
+class KProgressDialog;
 class KToggleAction;
 class KToggleFullScreenAction;
 class KSelectAction;
@@ -332,9 +333,17 @@ class OKULAR_PART_EXPORT Part : public KParts::ReadWritePart, public Okular::Doc
         KXMLGUIClient *m_generatorGuiClient;
         FileKeeper *m_keeper;
 
+        KProgressDialog *m_textExportDialog;
+        QString m_textExportFileName;
+        bool m_formsActionEnabled;
+
     private slots:
         void slotGeneratorPreferences();
+        void slotTextExportProgress(int page);
+        void slotTextExportEnded(bool success);
+        void slotTextExportCancelled();
         void slotHandleActivatedSourceReference(const QString& absFileName, int line, int col, bool *handled);
+        void slotFormsActionChanged();
 };
 
 class PartFactory : public KPluginFactory
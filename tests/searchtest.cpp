@@ -9,7 +9,10 @@
 
 #include <qtest_kde.h>
 
+#include "../core/area.h"
 #include "../core/document.h"
+#include "../core/page.h"
+#include "../core/textpage.h"
 #include "../settings_core.h"
 
 Q_DECLARE_METATYPE(Okular::Document::SearchStatus)
@@ -37,8 +40,33 @@ class SearchTest : public QObject
     private slots:
         void initTestCase();
         void test311232();
+        void testNextAndPrevious();
+        void testHyphenation();
+        void testWholeWords();
+        void testRegularExpression();
+        void testIgnoreDiacritics();
+        void testTextInArea();
+        void testSearchInTextOrder();
 };
 
+// Creates a TextPage with one entity per string of @p entities, laid out in a row
+static Okular::TextPage *createTextPage( const QStringList &entities )
+{
+    Okular::TextPage *tp = new Okular::TextPage();
+    const double width = 1.0 / entities.count();
+    for ( int i = 0; i < entities.count(); ++i )
+        tp->append( entities.at( i ), new Okular::NormalizedRect( i * width, 0.1, ( i + 1 ) * width, 0.2 ) );
+    return tp;
+}
+
+static QStringList characters( const QString &text )
+{
+    QStringList res;
+    for ( int i = 0; i < text.length(); ++i )
+        res << QString( text.at( i ) );
+    return res;
+}
+
 void SearchTest::initTestCase()
 {
     qRegisterMetaType<Okular::Document::SearchStatus>();
@@ -77,6 +105,230 @@ void SearchTest::test311232()
     QCOMPARE(receiver.m_status, Okular::Document::NoMatchFound);
 }
 
+void SearchTest::testNextAndPrevious()
+{
+    Okular::TextPage *tp = createTextPage( characters( "abXcdxefX" ) );
+    const double width = 1.0 / 9;
+
+    Okular::RegularAreaRect *result = tp->findText( 0, "x", Okular::FromTop, Qt::CaseSensitive, 0 );
+    QVERIFY( result );
+    QCOMPARE( result->first().left, 5 * width );
+    delete result;
+
+    result = tp->findText( 0, "x", Okular::FromTop, Qt::CaseInsensitive, 0 );
+    QVERIFY( result );
+    QCOMPARE( result->first().left, 2 * width );
+
+    Okular::RegularAreaRect *next = tp->findText( 0, "x", Okular::NextResult, Qt::CaseInsensitive, result );
+    QVERIFY( next );
+    QCOMPARE( next->first().left, 5 * width );
+    delete result;
+    result = next;
+
+    next = tp->findText( 0, "x", Okular::NextResult, Qt::CaseInsensitive, result );
+    QVERIFY( next );
+    QCOMPARE( next->first().left, 8 * width );
+    delete result;
+    result = next;
+
+    next = tp->findText( 0, "x", Okular::NextResult, Qt::CaseInsensitive, result );
+    QVERIFY( !next );
+    delete result;
+
+    result = tp->findText( 0, "X", Okular::FromBottom, Qt::CaseSensitive, 0 );
+    QVERIFY( result );
+    QCOMPARE( result->first().left, 8 * width );
+
+    Okular::RegularAreaRect *previous = tp->findText( 0, "X", Okular::PreviousResult, Qt::CaseSensitive, result );
+    QVERIFY( previous );
+    QCOMPARE( previous->first().left, 2 * width );
+    delete result;
+    result = previous;
+
+    previous = tp->findText( 0, "X", Okular::PreviousResult, Qt::CaseSensitive, result );
+    QVERIFY( !previous );
+    delete result;
+
+    result = tp->findText( 0, "cdxe", Okular::FromTop, Qt::CaseInsensitive, 0 );
+    QVERIFY( result );
+    QCOMPARE( result->count(), 1 );
+    QCOMPARE( result->first().left, 3 * width );
+    QCOMPARE( result->first().right, 7 * width );
+    delete result;
+
+    delete tp;
+}
+
+void SearchTest::testHyphenation()
+{
+    Okular::TextPage *tp = createTextPage( QStringList() << "hy" << "phen" << "-\n" << "ation" << " " << "rules" );
+    const double width = 1.0 / 6;
+
+    Okular::RegularAreaRect *result = tp->findText( 0, "hyphenation", Okular::FromTop, Qt::CaseSensitive, 0 );
+    QVERIFY( result );
+    QCOMPARE( result->count(), 1 );
+    QCOMPARE( result->first().left, 0.0 );
+    QCOMPARE( result->first().right, 4 * width );
+    delete result;
+
+    result = tp->findText( 0, "enation rul", Okular::FromBottom, Qt::CaseSensitive, 0 );
+    QVERIFY( result );
+    QCOMPARE( result->first().left, 1 * width );
+    delete result;
+
+    result = tp->findText( 0, "phen-", Okular::FromTop, Qt::CaseSensitive, 0 );
+    QVERIFY( !result );
+
+    delete tp;
+}
+
+void SearchTest::testWholeWords()
+{
+    Okular::TextPage *tp = createTextPage( characters( "other the theme the" ) );
+    const double width = 1.0 / 19;
+
+    Okular::RegularAreaRect *result = tp->findText( 0, "the", Okular::FromTop, Qt::CaseInsensitive, 0, Okular::WholeWordsSearch );
+    QVERIFY( result );
+    QCOMPARE( result->first().left, 6 * width );
+
+    Okular::RegularAreaRect *next = tp->findText( 0, "the", Okular::NextResult, Qt::CaseInsensitive, result, Okular::WholeWordsSearch );
+    QVERIFY( next );
+    QCOMPARE( next->first().left, 16 * width );
+    delete result;
+    delete next;
+
+    result = tp->findText( 0, "THE", Okular::FromBottom, Qt::CaseInsensitive, 0, Okular::WholeWordsSearch );
+    QVERIFY( result );
+    QCOMPARE( result->first().left, 16 * width );
+    delete result;
+
+    result = tp->findText( 0, "them", Okular::FromTop, Qt::CaseInsensitive, 0, Okular::WholeWordsSearch );
+    QVERIFY( !result );
+
+    delete tp;
+}
+
+void SearchTest::testRegularExpression()
+{
+    Okular::TextPage *tp = createTextPage( characters( "page 12, page 345" ) );
+    const double width = 1.0 / 17;
+
+    Okular::RegularAreaRect *result = tp->findText( 0, "[0-9]+", Okular::FromTop, Qt::CaseSensitive, 0, Okular::RegularExpressionSearch );
+    QVERIFY( result );
+    QCOMPARE( result->first().left, 5 * width );
+    QCOMPARE( result->first().right, 7 * width );
+
+    Okular::RegularAreaRect *next = tp->findText( 0, "[0-9]+", Okular::NextResult, Qt::CaseSensitive, result, Okular::RegularExpressionSearch );
+    QVERIFY( next );
+    QCOMPARE( next->first().left, 14 * width );
+    QCOMPARE( next->first().right, 17 * width );
+    delete result;
+    delete next;
+
+    result = tp->findText( 0, "PAGE \\d", Okular::FromBottom, Qt::CaseInsensitive, 0, Okular::RegularExpressionSearch );
+    QVERIFY( result );
+    QCOMPARE( result->first().left, 9 * width );
+    delete result;
+
+    result = tp->findText( 0, "\\d", Okular::FromTop, Qt::CaseSensitive, 0, Okular::RegularExpressionSearch | Okular::WholeWordsSearch );
+    QVERIFY( !result );
+
+    result = tp->findText( 0, "[", Okular::FromTop, Qt::CaseSensitive, 0, Okular::RegularExpressionSearch );
+    QVERIFY( !result );
+
+    delete tp;
+}
+
+void SearchTest::testIgnoreDiacritics()
+{
+    Okular::TextPage *tp = createTextPage( characters( QString::fromUtf8( "Un caf\xc3\xa9, une \xc5\x93uvre" ) ) );
+    const double width = 1.0 / 18;
+
+    Okular::RegularAreaRect *result = tp->findText( 0, "cafe", Okular::FromTop, Qt::CaseSensitive, 0 );
+    QVERIFY( !result );
+
+    result = tp->findText( 0, "cafe", Okular::FromTop, Qt::CaseSensitive, 0, Okular::IgnoreDiacriticsSearch );
+    QVERIFY( result );
+    QCOMPARE( result->first().left, 3 * width );
+    QCOMPARE( result->first().right, 7 * width );
+    delete result;
+
+    // the ligature matches both its expansion and itself
+    result = tp->findText( 0, "OEUVRE", Okular::FromTop, Qt::CaseInsensitive, 0, Okular::IgnoreDiacriticsSearch );
+    QVERIFY( result );
+    QCOMPARE( result->first().left, 13 * width );
+    QCOMPARE( result->first().right, 18 * width );
+    delete result;
+
+    result = tp->findText( 0, QString::fromUtf8( "\xc5\x93uvre" ), Okular::FromTop, Qt::CaseSensitive, 0, Okular::IgnoreDiacriticsSearch | Okular::WholeWordsSearch );
+    QVERIFY( result );
+    QCOMPARE( result->first().left, 13 * width );
+    delete result;
+
+    delete tp;
+}
+
+void SearchTest::testTextInArea()
+{
+    // enough entities for the spatial index to have more than one cell
+    Okular::TextPage *tp = createTextPage( characters( QString( "word " ).repeated( 13 ) ) );
+    const double width = 1.0 / 65;
+
+    Okular::RegularAreaRect area;
+    area.append( Okular::NormalizedRect( 10.6 * width, 0.12, 12.4 * width, 0.18 ) );
+    QCOMPARE( tp->text( &area, Okular::TextPage::AnyPixelTextAreaInclusionBehaviour ), QString( "wor" ) );
+    QCOMPARE( tp->text( &area, Okular::TextPage::CentralPixelTextAreaInclusionBehaviour ), QString( "o" ) );
+
+    Okular::TextEntity::List words = tp->words( &area, Okular::TextPage::AnyPixelTextAreaInclusionBehaviour );
+    QCOMPARE( words.count(), 3 );
+    qDeleteAll( words );
+
+    QString word;
+    Okular::RegularAreaRect *result = tp->wordAt( Okular::NormalizedPoint( 52.5 * width, 0.15 ), &word );
+    QVERIFY( result );
+    QCOMPARE( word, QString( "word" ) );
+    QCOMPARE( result->first().left, 50 * width );
+    delete result;
+
+    delete tp;
+}
+
+// Appends one entity per character of @p text to @p tp, laid out in a row at @p top
+static void appendRow( Okular::TextPage *tp, const QString &text, double top )
+{
+    for ( int i = 0; i < text.length(); ++i )
+        tp->append( QString( text.at( i ) ), new Okular::NormalizedRect( i * 0.05, top, ( i + 1 ) * 0.05, top + 0.05 ) );
+}
+
+void SearchTest::testSearchInTextOrder()
+{
+    // the generator gives the second line first, and the text order
+    // is corrected as soon as the text page is set on the page
+    Okular::Page page( 0, 1000, 1000, Okular::Rotation0 );
+    Okular::TextPage *tp = new Okular::TextPage();
+    appendRow( tp, "efX", 0.5 );
+    appendRow( tp, "abXcdX", 0.1 );
+    page.setTextPage( tp );
+
+    // the matches come in the order of text(), whether it was asked or not
+    const double tops[] = { 0.1, 0.1, 0.5 };
+    const double lefts[] = { 2 * 0.05, 5 * 0.05, 2 * 0.05 };
+    Okular::RegularAreaRect *result = 0;
+    for ( int i = 0; i < 3; ++i )
+    {
+        Okular::RegularAreaRect *next = tp->findText( 0, "x", result ? Okular::NextResult : Okular::FromTop, Qt::CaseInsensitive, result );
+        QVERIFY( next );
+        QCOMPARE( next->first().top, tops[i] );
+        QCOMPARE( next->first().left, lefts[i] );
+        delete result;
+        result = next;
+    }
+    QVERIFY( !tp->findText( 0, "x", Okular::NextResult, Qt::CaseInsensitive, result ) );
+    delete result;
+
+    QCOMPARE( tp->text().simplified().remove( ' ' ), QString( "abXcdXefX" ) );
+}
+
 QTEST_KDEMAIN( SearchTest, GUI )
 
 #include "searchtest.moc"
@@ -68,6 +68,12 @@ FindBar::FindBar( Okular::Document * document, QWidget * parent )
     m_caseSensitiveAct->setCheckable( true );
     m_fromCurrentPageAct = optionsMenu->addAction( i18n( "From current page" ) );
     m_fromCurrentPageAct->setCheckable( true );
+    m_wholeWordsAct = optionsMenu->addAction( i18n( "Whole words only" ) );
+    m_wholeWordsAct->setCheckable( true );
+    m_regularExpressionAct = optionsMenu->addAction( i18n( "Regular expression" ) );
+    m_regularExpressionAct->setCheckable( true );
+    m_ignoreDiacriticsAct = optionsMenu->addAction( i18n( "Ignore accents" ) );
+    m_ignoreDiacriticsAct->setCheckable( true );
     optionsBtn->setMenu( optionsMenu );
     lay->addWidget( optionsBtn );
 
@@ -76,9 +82,15 @@ FindBar::FindBar( Okular::Document * document, QWidget * parent )
     connect( findPrevBtn, SIGNAL(clicked()), this, SLOT(findPrev()) );
     connect( m_caseSensitiveAct, SIGNAL(toggled(bool)), this, SLOT(caseSensitivityChanged()) );
     connect( m_fromCurrentPageAct, SIGNAL(toggled(bool)), this, SLOT(fromCurrentPageChanged()) );
+    connect( m_wholeWordsAct, SIGNAL(toggled(bool)), this, SLOT(searchOptionsChanged()) );
+    connect( m_regularExpressionAct, SIGNAL(toggled(bool)), this, SLOT(searchOptionsChanged()) );
+    connect( m_ignoreDiacriticsAct, SIGNAL(toggled(bool)), this, SLOT(searchOptionsChanged()) );
 
     m_caseSensitiveAct->setChecked( Okular::Settings::searchCaseSensitive() );
     m_fromCurrentPageAct->setChecked( Okular::Settings::searchFromCurrentPage() );
+    m_wholeWordsAct->setChecked( Okular::Settings::searchWholeWords() );
+    m_regularExpressionAct->setChecked( Okular::Settings::searchRegularExpression() );
+    m_ignoreDiacriticsAct->setChecked( Okular::Settings::searchIgnoreDiacritics() );
 
     hide();
 
@@ -164,6 +176,25 @@ void FindBar::caseSensitivityChanged()
     m_search->lineEdit()->restartSearch();
 }
 
+void FindBar::searchOptionsChanged()
+{
+    Okular::SearchOptions options = Okular::NoSearchOption;
+    if ( m_wholeWordsAct->isChecked() )
+        options |= Okular::WholeWordsSearch;
+    if ( m_regularExpressionAct->isChecked() )
+        options |= Okular::RegularExpressionSearch;
+    if ( m_ignoreDiacriticsAct->isChecked() )
+        options |= Okular::IgnoreDiacriticsSearch;
+    m_search->lineEdit()->setSearchOptions( options );
+    if ( !m_active )
+        return;
+    Okular::Settings::setSearchWholeWords( m_wholeWordsAct->isChecked() );
+    Okular::Settings::setSearchRegularExpression( m_regularExpressionAct->isChecked() );
+    Okular::Settings::setSearchIgnoreDiacritics( m_ignoreDiacriticsAct->isChecked() );
+    Okular::Settings::self()->writeConfig();
+    m_search->lineEdit()->restartSearch();
+}
+
 void FindBar::fromCurrentPageChanged()
 {
     m_search->lineEdit()->setSearchFromStart( !m_fromCurrentPageAct->isChecked() );
@@ -44,6 +44,7 @@ class FindBar
 
     private slots:
         void caseSensitivityChanged();
+        void searchOptionsChanged();
         void fromCurrentPageChanged();
         void closeAndStopSearch();
 
@@ -51,6 +52,9 @@ class FindBar
         SearchLineWidget * m_search;
         QAction * m_caseSensitiveAct;
         QAction * m_fromCurrentPageAct;
+        QAction * m_wholeWordsAct;
+        QAction * m_regularExpressionAct;
+        QAction * m_ignoreDiacriticsAct;
         bool eventFilter( QObject *target, QEvent *event );
         bool m_active;
 };
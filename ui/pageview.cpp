@@ -859,46 +859,8 @@ void PageView::notifySetup( const QVector< Okular::Page * > & pageSet, int setup
 #ifdef PAGEVIEW_DEBUG
         kDebug().nospace() << "cropped geom for " << d->items.last()->pageNumber() << " is " << d->items.last()->croppedGeometry();
 #endif
-        const QLinkedList< Okular::FormField * > pageFields = (*setIt)->formFields();
-        QLinkedList< Okular::FormField * >::const_iterator ffIt = pageFields.constBegin(), ffEnd = pageFields.constEnd();
-        for ( ; ffIt != ffEnd; ++ffIt )
-        {
-            Okular::FormField * ff = *ffIt;
-            FormWidgetIface * w = FormWidgetFactory::createWidget( ff, viewport() );
-            if ( w )
-            {
-                w->setPageItem( item );
-                w->setFormWidgetsController( d->formWidgetsController() );
-                w->setVisibility( false );
-                w->setCanBeFilled( d->document->isAllowed( Okular::AllowFillForms ) );
-                item->formWidgets().insert( ff->id(), w );
-                hasformwidgets = true;
-            }
-        }
-        const QLinkedList< Okular::Annotation * > annotations = (*setIt)->annotations();
-        QLinkedList< Okular::Annotation * >::const_iterator aIt = annotations.constBegin(), aEnd = annotations.constEnd();
-        for ( ; aIt != aEnd; ++aIt )
-        {
-            Okular::Annotation * a = *aIt;
-            if ( a->subType() == Okular::Annotation::AMovie )
-            {
-                Okular::MovieAnnotation * movieAnn = static_cast< Okular::MovieAnnotation * >( a );
-                VideoWidget * vw = new VideoWidget( movieAnn, movieAnn->movie(), d->document, viewport() );
-                item->videoWidgets().insert( movieAnn->movie(), vw );
-                vw->pageInitialized();
-            }
-            else if ( a->subType() == Okular::Annotation::AScreen )
-            {
-                const Okular::ScreenAnnotation * screenAnn = static_cast< Okular::ScreenAnnotation * >( a );
-                Okular::Movie *movie = GuiUtils::renditionMovieFromScreenAnnotation( screenAnn );
-                if ( movie )
-                {
-                    VideoWidget * vw = new VideoWidget( screenAnn, movie, d->document, viewport() );
-                    item->videoWidgets().insert( movie, vw );
-                    vw->pageInitialized();
-                }
-            }
-        }
+        if ( createPageItemWidgets( item ) )
+            hasformwidgets = true;
     }
 
     // invalidate layout so relayout/repaint will happen on next viewport change
@@ -942,6 +904,63 @@ void PageView::notifySetup( const QVector< Okular::Page * > & pageSet, int setup
     selectionClear();
 }
 
+bool PageView::createPageItemWidgets( PageViewItem * item, QList< VideoWidget * > * newVideoWidgets )
+{
+    // creates the form and video widgets of the page that the item does not
+    // have yet; returns whether any form widget was created
+    const Okular::Page * page = item->page();
+    bool hasformwidgets = false;
+    const QLinkedList< Okular::FormField * > pageFields = page->formFields();
+    QLinkedList< Okular::FormField * >::const_iterator ffIt = pageFields.constBegin(), ffEnd = pageFields.constEnd();
+    for ( ; ffIt != ffEnd; ++ffIt )
+    {
+        Okular::FormField * ff = *ffIt;
+        if ( item->formWidgets().contains( ff->id() ) )
+            continue;
+        FormWidgetIface * w = FormWidgetFactory::createWidget( ff, viewport() );
+        if ( w )
+        {
+            w->setPageItem( item );
+            w->setFormWidgetsController( d->formWidgetsController() );
+            w->setVisibility( false );
+            w->setCanBeFilled( d->document->isAllowed( Okular::AllowFillForms ) );
+            item->formWidgets().insert( ff->id(), w );
+            hasformwidgets = true;
+        }
+    }
+    const QLinkedList< Okular::Annotation * > annotations = page->annotations();
+    QLinkedList< Okular::Annotation * >::const_iterator aIt = annotations.constBegin(), aEnd = annotations.constEnd();
+    for ( ; aIt != aEnd; ++aIt )
+    {
+        Okular::Annotation * a = *aIt;
+        if ( a->subType() == Okular::Annotation::AMovie )
+        {
+            Okular::MovieAnnotation * movieAnn = static_cast< Okular::MovieAnnotation * >( a );
+            if ( item->videoWidgets().contains( movieAnn->movie() ) )
+                continue;
+            VideoWidget * vw = new VideoWidget( movieAnn, movieAnn->movie(), d->document, viewport() );
+            item->videoWidgets().insert( movieAnn->movie(), vw );
+            vw->pageInitialized();
+            if ( newVideoWidgets )
+                newVideoWidgets->append( vw );
+        }
+        else if ( a->subType() == Okular::Annotation::AScreen )
+        {
+            const Okular::ScreenAnnotation * screenAnn = static_cast< Okular::ScreenAnnotation * >( a );
+            Okular::Movie *movie = GuiUtils::renditionMovieFromScreenAnnotation( screenAnn );
+            if ( movie && !item->videoWidgets().contains( movie ) )
+            {
+                VideoWidget * vw = new VideoWidget( screenAnn, movie, d->document, viewport() );
+                item->videoWidgets().insert( movie, vw );
+                vw->pageInitialized();
+                if ( newVideoWidgets )
+                    newVideoWidgets->append( vw );
+            }
+        }
+    }
+    return hasformwidgets;
+}
+
 void PageView::updateActionState( bool haspages, bool documentChanged, bool hasformwidgets )
 {
     if ( d->aPageSizes )
@@ -1190,6 +1209,25 @@ void PageView::notifyPageChanged( int pageNumber, int changedFlags )
                 delete w; 
             }
         }
+
+        // the generator may add the page's forms and media only once the
+        // page is about to be shown, so create the widgets that are missing
+        if ( pageNumber >= 0 && pageNumber < d->items.count() )
+        {
+            PageViewItem * item = d->items[ pageNumber ];
+            QList< VideoWidget * > newVideoWidgets;
+            if ( createPageItemWidgets( item, &newVideoWidgets ) && d->aToggleForms )
+                d->aToggleForms->setEnabled( true );
+            const QRect geom = item->croppedGeometry();
+            item->setWHZC( geom.width(), geom.height(), item->zoomFactor(), item->crop() );
+            item->moveTo( geom.left(), geom.top() );
+            item->setFormWidgetsVisible( d->m_formsVisible );
+            if ( pageNumber == (int)d->document->currentPage() )
+            {
+                Q_FOREACH ( VideoWidget *videoWidget, newVideoWidgets )
+                    videoWidget->pageEntered();
+            }
+        }
     }
 
     if ( changedFlags & DocumentObserver::BoundingBox )
@@ -42,6 +42,8 @@ class RenditionAction;
 }
 
 class FormWidgetIface;
+class VideoWidget;
+class PageViewItem;
 class PageViewPrivate;
 
 /**
@@ -189,6 +191,7 @@ Q_OBJECT
         void scrollTo( int x, int y );
 
         void toggleFormWidgets( bool on );
+        bool createPageItemWidgets( PageViewItem * item, QList< VideoWidget * > * newVideoWidgets = 0 );
 
         void resizeContentArea( const QSize & newSize );
         void updatePageStep();
@@ -99,6 +99,42 @@ struct PresentationFrame
         }
     }
 
+    // creates the video widgets of the page's media that are still missing
+    // and returns them
+    QList< VideoWidget * > createVideoWidgets( Okular::Document * document, QWidget * parent )
+    {
+        QList< VideoWidget * > created;
+        const QLinkedList< Okular::Annotation * > annotations = page->annotations();
+        QLinkedList< Okular::Annotation * >::const_iterator aIt = annotations.begin(), aEnd = annotations.end();
+        for ( ; aIt != aEnd; ++aIt )
+        {
+            Okular::Annotation * a = *aIt;
+            if ( a->subType() == Okular::Annotation::AMovie )
+            {
+                Okular::MovieAnnotation * movieAnn = static_cast< Okular::MovieAnnotation * >( a );
+                if ( videoWidgets.contains( movieAnn->movie() ) )
+                    continue;
+                VideoWidget * vw = new VideoWidget( movieAnn, movieAnn->movie(), document, parent );
+                videoWidgets.insert( movieAnn->movie(), vw );
+                vw->pageInitialized();
+                created.append( vw );
+            }
+            else if ( a->subType() == Okular::Annotation::AScreen )
+            {
+                const Okular::ScreenAnnotation * screenAnn = static_cast< Okular::ScreenAnnotation * >( a );
+                Okular::Movie *movie = GuiUtils::renditionMovieFromScreenAnnotation( screenAnn );
+                if ( movie && !videoWidgets.contains( movie ) )
+                {
+                    VideoWidget * vw = new VideoWidget( screenAnn, movie, document, parent );
+                    videoWidgets.insert( movie, vw );
+                    vw->pageInitialized();
+                    created.append( vw );
+                }
+            }
+        }
+        return created;
+    }
+
     const Okular::Page * page;
     QRect geometry;
     QHash< Okular::Movie *, VideoWidget * > videoWidgets;
@@ -311,30 +347,7 @@ void PresentationWidget::notifySetup( const QVector< Okular::Page * > & pageSet,
     {
         PresentationFrame * frame = new PresentationFrame();
         frame->page = *setIt;
-        const QLinkedList< Okular::Annotation * > annotations = (*setIt)->annotations();
-        QLinkedList< Okular::Annotation * >::const_iterator aIt = annotations.begin(), aEnd = annotations.end();
-        for ( ; aIt != aEnd; ++aIt )
-        {
-            Okular::Annotation * a = *aIt;
-            if ( a->subType() == Okular::Annotation::AMovie )
-            {
-                Okular::MovieAnnotation * movieAnn = static_cast< Okular::MovieAnnotation * >( a );
-                VideoWidget * vw = new VideoWidget( movieAnn, movieAnn->movie(), m_document, this );
-                frame->videoWidgets.insert( movieAnn->movie(), vw );
-                vw->pageInitialized();
-            }
-            else if ( a->subType() == Okular::Annotation::AScreen )
-            {
-                const Okular::ScreenAnnotation * screenAnn = static_cast< Okular::ScreenAnnotation * >( a );
-                Okular::Movie *movie = GuiUtils::renditionMovieFromScreenAnnotation( screenAnn );
-                if ( movie )
-                {
-                    VideoWidget * vw = new VideoWidget( screenAnn, movie, m_document, this );
-                    frame->videoWidgets.insert( movie, vw );
-                    vw->pageInitialized();
-                }
-            }
-        }
+        frame->createVideoWidgets( m_document, this );
         frame->recalcGeometry( m_width, m_height, screenRatio );
         // add the frame to the vector
         m_frames.push_back( frame );
@@ -371,6 +384,19 @@ void PresentationWidget::notifyPageChanged( int pageNumber, int changedFlags )
     if ( m_blockNotifications )
         return;
 
+    // the page's media may be added once the page is about to be shown
+    if ( ( changedFlags & DocumentObserver::Annotations ) && pageNumber >= 0 && pageNumber < m_frames.count() )
+    {
+        PresentationFrame * frame = m_frames[ pageNumber ];
+        const QList< VideoWidget * > created = frame->createVideoWidgets( m_document, this );
+        frame->recalcGeometry( m_width, m_height, (float)m_height / (float)m_width );
+        if ( pageNumber == m_frameIndex )
+        {
+            Q_FOREACH ( VideoWidget *vw, created )
+                vw->pageEntered();
+        }
+    }
+
     // check if it's the last requested pixmap. if so update the widget.
     if ( (changedFlags & ( DocumentObserver::Pixmap | DocumentObserver::Annotations | DocumentObserver::Highlights ) ) && pageNumber == m_frameIndex )
         generatePage( changedFlags & ( DocumentObserver::Annotations | DocumentObserver::Highlights ) );
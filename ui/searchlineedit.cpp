@@ -15,16 +15,18 @@
 
 // qt/kde includes
 #include <qapplication.h>
+#include <qlabel.h>
 #include <qlayout.h>
 #include <qtimer.h>
 #include <kcolorscheme.h>
+#include <klocale.h>
 #include <kpixmapsequence.h>
 #include <kpixmapsequencewidget.h>
 
 SearchLineEdit::SearchLineEdit( QWidget * parent, Okular::Document * document )
     : KLineEdit( parent ), m_document( document ), m_minLength( 0 ),
       m_caseSensitivity( Qt::CaseInsensitive ),
-      m_searchType( Okular::Document::AllDocument ), m_id( -1 ),
+      m_searchType( Okular::Document::AllDocument ), m_options( Okular::NoSearchOption ), m_id( -1 ),
       m_moveViewport( false ), m_changed( false ), m_fromStart( true ),
       m_searchRunning( false )
 {
@@ -40,6 +42,7 @@ SearchLineEdit::SearchLineEdit( QWidget * parent, Okular::Document * document )
     connect(this, SIGNAL(textChanged(QString)), this, SLOT(slotTextChanged(QString)));
     connect(this, SIGNAL(returnPressed(QString)), this, SLOT(slotReturnPressed(QString)));
     connect(document, SIGNAL(searchFinished(int,Okular::Document::SearchStatus)), this, SLOT(searchFinished(int,Okular::Document::SearchStatus)));
+    connect(document, SIGNAL(searchMatchesFound(int,int)), this, SLOT(slotSearchMatchesFound(int,int)));
 }
 
 void SearchLineEdit::clearText()
@@ -70,6 +73,12 @@ void SearchLineEdit::setSearchType( Okular::Document::SearchType type )
         m_changed = ( m_searchType != Okular::Document::NextMatch && m_searchType != Okular::Document::PreviousMatch );
 }
 
+void SearchLineEdit::setSearchOptions( Okular::SearchOptions options )
+{
+    m_options = options;
+    m_changed = true;
+}
+
 void SearchLineEdit::setSearchId( int id )
 {
     m_id = id;
@@ -100,6 +109,7 @@ void SearchLineEdit::resetSearch()
     // Clear highlights
     if ( m_id != -1 )
         m_document->resetSearch( m_id );
+    emit searchMatchesFound( 0 );
 
     // Make sure that the search will be reset at the next one
     m_changed = true;
@@ -212,10 +222,13 @@ void SearchLineEdit::startSearch()
         emit searchStarted();
         m_searchRunning = true;
         m_document->searchText( m_id, thistext, m_fromStart, m_caseSensitivity,
-                                m_searchType, m_moveViewport, m_color );
+                                m_searchType, m_moveViewport, m_color, false, m_options );
     }
     else
+    {
         m_document->resetSearch( m_id );
+        emit searchMatchesFound( 0 );
+    }
 }
 
 void SearchLineEdit::searchFinished( int id, Okular::Document::SearchStatus endStatus )
@@ -246,6 +259,15 @@ void SearchLineEdit::searchFinished( int id, Okular::Document::SearchStatus endS
     emit searchStopped();
 }
 
+void SearchLineEdit::slotSearchMatchesFound( int id, int matches )
+{
+    // ignore the searches not started by this search edit
+    if ( id != m_id )
+        return;
+
+    emit searchMatchesFound( matches );
+}
+
 
 SearchLineWidget::SearchLineWidget( QWidget * parent, Okular::Document * document )
     : QWidget( parent )
@@ -261,12 +283,17 @@ SearchLineWidget::SearchLineWidget( QWidget * parent, Okular::Document * documen
     layout->addWidget( m_anim );
     m_anim->hide();
 
+    m_matches = new QLabel( this );
+    layout->addWidget( m_matches );
+    m_matches->hide();
+
     m_timer = new QTimer( this );
     m_timer->setSingleShot( true );
     connect( m_timer, SIGNAL(timeout()), this, SLOT(slotTimedout()) );
 
     connect( m_edit, SIGNAL(searchStarted()), this, SLOT(slotSearchStarted()) );
     connect( m_edit, SIGNAL(searchStopped()), this, SLOT(slotSearchStopped()) );
+    connect( m_edit, SIGNAL(searchMatchesFound(int)), this, SLOT(slotSearchMatchesFound(int)) );
 }
 
 SearchLineEdit* SearchLineWidget::lineEdit() const
@@ -276,6 +303,7 @@ SearchLineEdit* SearchLineWidget::lineEdit() const
 
 void SearchLineWidget::slotSearchStarted()
 {
+    m_matches->hide();
     m_timer->start( 100 );
 }
 
@@ -285,6 +313,12 @@ void SearchLineWidget::slotSearchStopped()
     m_anim->hide();
 }
 
+void SearchLineWidget::slotSearchMatchesFound( int matches )
+{
+    m_matches->setText( i18np( "1 match", "%1 matches", matches ) );
+    m_matches->setVisible( matches > 0 );
+}
+
 void SearchLineWidget::slotTimedout()
 {
     if ( m_anim->sequence().isEmpty() )
@@ -15,6 +15,7 @@
 
 #include <klineedit.h>
 
+class QLabel;
 class QTimer;
 class KPixmapSequenceWidget;
 
@@ -32,6 +33,7 @@ class SearchLineEdit : public KLineEdit
         void setSearchCaseSensitivity( Qt::CaseSensitivity cs );
         void setSearchMinimumLength( int length );
         void setSearchType( Okular::Document::SearchType type );
+        void setSearchOptions( Okular::SearchOptions options );
         void setSearchId( int id );
         void setSearchColor( const QColor &color );
         void setSearchMoveViewport( bool move );
@@ -43,6 +45,7 @@ class SearchLineEdit : public KLineEdit
     signals:
         void searchStarted();
         void searchStopped();
+        void searchMatchesFound( int matches );
 
     public slots:
         void restartSearch();
@@ -58,6 +61,7 @@ class SearchLineEdit : public KLineEdit
         int m_minLength;
         Qt::CaseSensitivity m_caseSensitivity;
         Okular::Document::SearchType m_searchType;
+        Okular::SearchOptions m_options;
         int m_id;
         QColor m_color;
         bool m_moveViewport;
@@ -70,6 +74,7 @@ class SearchLineEdit : public KLineEdit
         void slotReturnPressed( const QString &text );
         void startSearch();
         void searchFinished( int id, Okular::Document::SearchStatus endStatus );
+        void slotSearchMatchesFound( int id, int matches );
 };
 
 class SearchLineWidget : public QWidget
@@ -83,10 +88,12 @@ class SearchLineWidget : public QWidget
     private slots:
         void slotSearchStarted();
         void slotSearchStopped();
+        void slotSearchMatchesFound( int matches );
         void slotTimedout();
 
     private:
         SearchLineEdit *m_edit;
+        QLabel *m_matches;
         KPixmapSequenceWidget* m_anim;
         QTimer *m_timer;
 };
@@ -10,6 +10,7 @@
 #include "searchwidget.h"
 
 // qt/kde includes
+#include <qlabel.h>
 #include <qlayout.h>
 #include <qmenu.h>
 #include <qaction.h>
@@ -44,16 +45,27 @@ SearchWidget::SearchWidget( QWidget * parent, Okular::Document * document )
     m_lineEdit->setSearchId( SW_SEARCH_ID );
     m_lineEdit->setSearchColor( qRgb( 0, 183, 255 ) );
     mainlay->addWidget( m_lineEdit );
+    connect( m_lineEdit, SIGNAL(searchStarted()), SLOT(slotSearchStarted()) );
+    connect( m_lineEdit, SIGNAL(searchMatchesFound(int)), SLOT(slotSearchMatchesFound(int)) );
+
+    // running count of the matches, updated while the pages are searched
+    m_matchesLabel = new QLabel( this );
+    mainlay->addWidget( m_matchesLabel );
+    m_matchesLabel->hide();
 
     // 3.1. create the popup menu for changing filtering features
     m_menu = new QMenu( this );
     m_caseSensitiveAction = m_menu->addAction( i18n("Case Sensitive") );
+    m_wholeWordsAction = m_menu->addAction( i18n("Whole Words Only") );
+    m_ignoreDiacriticsAction = m_menu->addAction( i18n("Ignore Accents") );
     m_menu->addSeparator();
     m_matchPhraseAction = m_menu->addAction( i18n("Match Phrase") );
     m_marchAllWordsAction = m_menu->addAction( i18n("Match All Words") );
     m_marchAnyWordsAction = m_menu->addAction( i18n("Match Any Word") );
 
     m_caseSensitiveAction->setCheckable( true );
+    m_wholeWordsAction->setCheckable( true );
+    m_ignoreDiacriticsAction->setCheckable( true );
     QActionGroup *actgrp = new QActionGroup( this );
     m_matchPhraseAction->setCheckable( true );
     m_matchPhraseAction->setActionGroup( actgrp );
@@ -87,6 +99,15 @@ void SearchWidget::slotMenuChaged( QAction * act )
     {
         m_lineEdit->setSearchCaseSensitivity( m_caseSensitiveAction->isChecked() ? Qt::CaseSensitive : Qt::CaseInsensitive );
     }
+    else if ( act == m_wholeWordsAction || act == m_ignoreDiacriticsAction )
+    {
+        Okular::SearchOptions options = Okular::NoSearchOption;
+        if ( m_wholeWordsAction->isChecked() )
+            options |= Okular::WholeWordsSearch;
+        if ( m_ignoreDiacriticsAction->isChecked() )
+            options |= Okular::IgnoreDiacriticsSearch;
+        m_lineEdit->setSearchOptions( options );
+    }
     else if ( act == m_matchPhraseAction )
     {
         m_lineEdit->setSearchType( Okular::Document::AllDocument );
@@ -106,4 +127,15 @@ void SearchWidget::slotMenuChaged( QAction * act )
     m_lineEdit->restartSearch();
 }
 
+void SearchWidget::slotSearchStarted()
+{
+    m_matchesLabel->hide();
+}
+
+void SearchWidget::slotSearchMatchesFound( int matches )
+{
+    m_matchesLabel->setText( i18np( "1 match", "%1 matches", matches ) );
+    m_matchesLabel->setVisible( matches > 0 );
+}
+
 #include "searchwidget.moc"
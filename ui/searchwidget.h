@@ -17,6 +17,7 @@ class Document;
 }
 
 class QAction;
+class QLabel;
 class QMenu;
 
 class SearchLineEdit;
@@ -38,11 +39,14 @@ class SearchWidget : public QWidget
 
     private:
         QMenu * m_menu;
-        QAction *m_matchPhraseAction, *m_caseSensitiveAction, * m_marchAllWordsAction, *m_marchAnyWordsAction;
+        QAction *m_matchPhraseAction, *m_caseSensitiveAction, * m_marchAllWordsAction, *m_marchAnyWordsAction, *m_wholeWordsAction, *m_ignoreDiacriticsAction;
         SearchLineEdit *m_lineEdit;
+        QLabel *m_matchesLabel;
 
     private slots:
         void slotMenuChaged( QAction * );
+        void slotSearchStarted();
+        void slotSearchMatchesFound( int matches );
 };
 
 #endif